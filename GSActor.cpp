@@ -7,6 +7,7 @@
 #include "DataDrivenShaderPlatformInfo.h"
 #include "Kismet/KismetSystemLibrary.h" 
 #include "GSShaderWorldSubsystem.h"
+#include "GSSplatKernels.h"
 
 #include "loader/ply/PlyAttributeCollection.h"
 
@@ -61,10 +62,12 @@ namespace PLY
 				attri->GetAttributeArray<float>("z", arr_z);
 				attri->GetAttributeArray<float>("opacity", arr_a);
 
+				GSKernels::ConvertPositions(arr_x.data(), arr_y.data(), arr_z.data(), GSData.NumParticles);	// m -> cm
+				GSKernels::ActivateOpacity(arr_a.data(), arr_a.data(), GSData.NumParticles);
+
 				GSData.pos.SetNumUninitialized(GSData.NumParticles);
 				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.pos[i] = FVector4f(arr_x[i], -arr_z[i], -arr_y[i], 0) * 100.f;	// m -> cm
-					GSData.pos[i].W = 1.f / (1.f + FMath::Exp(-arr_a[i]));
+					GSData.pos[i] = FVector4f(arr_x[i], arr_y[i], arr_z[i], arr_a[i]);
 				}
 			};
 
@@ -81,14 +84,12 @@ namespace PLY
 				attri->GetAttributeArray<float>("rot_2", arr_z);
 				attri->GetAttributeArray<float>("rot_3", arr_w);
 
+				// normalize
+				GSKernels::NormalizeQuaternions(arr_x.data(), arr_y.data(), arr_z.data(), arr_w.data(), GSData.NumParticles);
+
 				GSData.rot.SetNumUninitialized(GSData.NumParticles);
 				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					FVector4f rot = FVector4f(arr_x[i], arr_y[i], arr_z[i], arr_w[i]);
-					// normalize
-					float len = rot.Size();
-					rot /= len;
-
-					GSData.rot[i] = FVector4f(rot.X, rot.Y, rot.Z, rot.W);
+					GSData.rot[i] = FVector4f(arr_x[i], arr_y[i], arr_z[i], arr_w[i]);
 				}
 			};
 
@@ -103,9 +104,13 @@ namespace PLY
 				attri->GetAttributeArray<float>("scale_1", arr_y);
 				attri->GetAttributeArray<float>("scale_2", arr_z);
 				
+				GSKernels::ActivateScale(arr_x.data(), arr_x.data(), GSData.NumParticles);
+				GSKernels::ActivateScale(arr_y.data(), arr_y.data(), GSData.NumParticles);
+				GSKernels::ActivateScale(arr_z.data(), arr_z.data(), GSData.NumParticles);
+
 				GSData.scl.SetNumUninitialized(GSData.NumParticles);
 				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.scl[i] = FVector4f(FMath::Exp(arr_x[i]), FMath::Exp(arr_y[i]), FMath::Exp(arr_z[i]), 0.f);
+					GSData.scl[i] = FVector4f(arr_x[i], arr_y[i], arr_z[i], 0.f);
 				}
 			};
 
@@ -2,11 +2,23 @@
 
 
 #include "GSActor.h"
-#include <format>
 #include "LevelEditorViewport.h"
 #include "DataDrivenShaderPlatformInfo.h"
 #include "Kismet/KismetSystemLibrary.h" 
 #include "GSShaderWorldSubsystem.h"
+#include "GSPlyLoader.h"
+#include "GSSplatCooked.h"
+#include "GSSplatPacked.h"
+#include "GSSplatCompressed.h"
+#include "GSSplatDerivedData.h"
+#include "GSLoadArena.h"
+#include "GSBufferPool.h"
+#include "GSSortCpu.h"
+#include "GSQuadDraw.h"
+#include "Algo/Sort.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Tasks/Task.h"
 
 #include "loader/ply/PlyAttributeCollection.h"
 
@@ -16,260 +28,94 @@
 #include "Camera/CameraActor.h"
 #include "ID3D12DynamicRHI.h"
 #include "GPUSort.h"
+#include "CommonRenderResources.h"
+#include "UObject/UObjectIterator.h"
 
 
 DEFINE_LOG_CATEGORY(LogGSActor);
 DECLARE_GPU_STAT(GSActor);
+DECLARE_GPU_STAT(GSGeometryDraw);
+DECLARE_GPU_STAT(GSTileRaster);
+DECLARE_GPU_STAT(GSQuadDraw);
+
+static TAutoConsoleVariable<int32> CVarProgressiveChunkSize(
+	TEXT("r.GS.ProgressiveChunkSize"),
+	256 * 1024,
+	TEXT("Particles decoded and uploaded per step when AGSActor::bProgressiveLoad is set."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCullChunks(
+	TEXT("r.GS.Cull.Chunks"),
+	1,
+	TEXT("Splats are grouped in chunks at load time, and chunks outside the frustum are left out of the sort.\n")
+	TEXT("Needs r.GS.Sort.KeyBits below 32. Not used while paging."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarSortAsyncCompute(
+	TEXT("r.GS.Sort.AsyncCompute"),
+	1,
+	TEXT("Record the sort key generation and the incremental re-sorts on the async compute queue, behind the draw : each\n")
+	TEXT("frame draws the newest order completed. 0 sorts on the graphics queue ahead of the draw."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarSortCpu(
+	TEXT("r.GS.Sort.CPU"),
+	0,
+	TEXT("Sort on the CPU worker pool (GSSortCpu.h) and upload the order, for reference or where the GPU sort is unavailable.\n")
+	TEXT("Positions are kept in memory for the loads started while it is set. Sorts every splat, culling aside."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarSlicedLoadMinMB(
+	TEXT("r.GS.Ply.SlicedLoadMinMB"),
+	1024,
+	TEXT("PLY files at least this large are decoded and uploaded slice by slice (r.GS.ProgressiveChunkSize particles),\n")
+	TEXT("so the load only ever holds two slices in memory. Cooked, packed and compact loads are never sliced. 0 disables."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPagingPageSize(
+	TEXT("r.GS.Paging.PageSize"),
+	64 * 1024,
+	TEXT("Splats per page when AGSActor::bEnablePaging is set. Pages are the unit of residency."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPagingMaxInFlight(
+	TEXT("r.GS.Paging.MaxInFlight"),
+	2,
+	TEXT("Pages decoded concurrently in the background per actor."),
+	ECVF_Default);
+
+static const TCHAR* GSplatStreamVBNames[PLY::SplatStream_Count] = {
+	TEXT("FPositionRotationVB"), TEXT("FscaleVB"), TEXT("SH04VB"),
+	TEXT("R_SH1_4VB"), TEXT("G_SH1_4VB"), TEXT("B_SH1_4VB"),
+	TEXT("R_SH1_4VB"), TEXT("G_SH1_4VB"), TEXT("B_SH1_4VB"),
+	TEXT("R_SH1_4VB"), TEXT("G_SH1_4VB"), TEXT("B_SH1_4VB"),
+};
+
+// key generation and incremental re-sort : the kernels bind these RDG views, RDG transitions the buffers
+BEGIN_SHADER_PARAMETER_STRUCT(FGSSortKeysPassParameters, )
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<float>, PosRot)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, ChunkIndices)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint4>, VisibleChunks)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, PrevIndices)
+	SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, Keys)
+	SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, Indices)
+END_SHADER_PARAMETER_STRUCT()
+
+// SortGPUBuffers reads and writes both buffer pairs through SRVs and UAVs, moving each between SRVCompute and
+// UAVCompute around its passes : it takes and leaves them all in SRVCompute
+BEGIN_SHADER_PARAMETER_STRUCT(FGSRadixSortPassParameters, )
+	RDG_BUFFER_ACCESS_ARRAY(Buffers)
+END_SHADER_PARAMETER_STRUCT()
+
+// the tile rasterizer reads the sorted indices and blends into the scene color
+BEGIN_SHADER_PARAMETER_STRUCT(FGSTilePassParameters, )
+	RDG_BUFFER_ACCESS_ARRAY(Buffers)
+	RDG_TEXTURE_ACCESS(SceneColor, ERHIAccess::UAVCompute)
+END_SHADER_PARAMETER_STRUCT()
 
 //DECLARE_STATS_GROUP(TEXT("GSActor"), STATGROUP_GSActor, STATCAT_Advanced);
 //DECLARE_CYCLE_STAT(TEXT("GSActor Execute"), STAT_GSActor_Execute, STATGROUP_GSActor);
 
-//----------------------------------------------------------------------------------------------------------------------------
-namespace PLY
-{
-	struct FGaussSplatVertex
-	{
-		UINT NumParticles;
-		TResourceArray<float, VERTEXBUFFER_ALIGNMENT> posrot;
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> scl;
-
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> r_sh0;
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> g_sh0;
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> b_sh0;
-
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> r_sh1_4[3];
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> g_sh1_4[3];
-		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> b_sh1_4[3];
-	};
-
-	bool LoadPlyFile(const FString& Filename, FGaussSplatVertex& GSData)
-	{
-		bool bResult = false;
-		Ply3DGS::FAttributeCollection collection;
-
-
-		// position and rotation
-		auto SetPosRotFunc = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_px;
-				std::vector<float> arr_py;
-				std::vector<float> arr_pz;
-
-				std::vector<float> arr_rx;
-				std::vector<float> arr_ry;
-				std::vector<float> arr_rz;
-				std::vector<float> arr_rw;
-
-				attri->GetAttributeArray<float>("x", arr_px);
-				attri->GetAttributeArray<float>("y", arr_py);
-				attri->GetAttributeArray<float>("z", arr_pz);
-
-				attri->GetAttributeArray<float>("rot_0", arr_rx);
-				attri->GetAttributeArray<float>("rot_1", arr_ry);
-				attri->GetAttributeArray<float>("rot_2", arr_rz);
-				attri->GetAttributeArray<float>("rot_3", arr_rw);
-
-				GSData.posrot.SetNumUninitialized(GSData.NumParticles * 7);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.posrot[i * 7 + 0] = arr_px[i];
-					GSData.posrot[i * 7 + 1] = arr_py[i];
-					GSData.posrot[i * 7 + 2] = arr_pz[i];
-
-					GSData.posrot[i * 7 + 3] = arr_rx[i];
-					GSData.posrot[i * 7 + 4] = arr_ry[i];
-					GSData.posrot[i * 7 + 5] = arr_rz[i];
-					GSData.posrot[i * 7 + 6] = arr_rw[i];
-				}
-			};
-		
-		// scale
-		auto SetScaleFunc = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_x;
-				std::vector<float> arr_y;
-				std::vector<float> arr_z;
-				std::vector<float> arr_w;
-				
-				attri->GetAttributeArray<float>("scale_0", arr_x);
-				attri->GetAttributeArray<float>("scale_1", arr_y);
-				attri->GetAttributeArray<float>("scale_2", arr_z);
-				attri->GetAttributeArray<float>("opacity", arr_w);
-				
-				GSData.scl.SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.scl[i] = FVector4f(FMath::Exp(arr_x[i]), FMath::Exp(arr_y[i]), FMath::Exp(arr_z[i]), 1.f / (1.f + FMath::Exp(-arr_w[i])));
-				}
-			};
-
-		// r-color0
-		auto SetRColor0Func = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_r0;
-				std::vector<float> arr_r1;
-				std::vector<float> arr_r2;
-				std::vector<float> arr_r3;
-
-				attri->GetAttributeArray<float>("f_dc_0", arr_r0);
-				attri->GetAttributeArray<float>("f_rest_0", arr_r1);
-				attri->GetAttributeArray<float>("f_rest_1", arr_r2);
-				attri->GetAttributeArray<float>("f_rest_2", arr_r3);
-
-				GSData.r_sh0.SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.r_sh0[i] = FVector4f(arr_r0[i], arr_r1[i], arr_r2[i], arr_r3[i]);
-				}
-			};
-		// g-color0
-		auto SetGColor0Func = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_g0;
-				std::vector<float> arr_g1;
-				std::vector<float> arr_g2;
-				std::vector<float> arr_g3;
-
-				attri->GetAttributeArray<float>("f_dc_1", arr_g0);
-				attri->GetAttributeArray<float>("f_rest_15", arr_g1);
-				attri->GetAttributeArray<float>("f_rest_16", arr_g2);
-				attri->GetAttributeArray<float>("f_rest_17", arr_g3);
-
-				GSData.g_sh0.SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.g_sh0[i] = FVector4f(arr_g0[i], arr_g1[i], arr_g2[i], arr_g3[i]);
-				}
-			};
-		// b-color0
-		auto SetBColor0Func = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_b0;
-				std::vector<float> arr_b1;
-				std::vector<float> arr_b2;
-				std::vector<float> arr_b3;
-
-				attri->GetAttributeArray<float>("f_dc_2", arr_b0);
-				attri->GetAttributeArray<float>("f_rest_30", arr_b1);
-				attri->GetAttributeArray<float>("f_rest_31", arr_b2);
-				attri->GetAttributeArray<float>("f_rest_32", arr_b3);
-
-				GSData.b_sh0.SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.b_sh0[i] = FVector4f(arr_b0[i], arr_b1[i], arr_b2[i], arr_b3[i]);
-				}
-			};
-
-		// r-color1-4
-		auto SetR_Sh1_4Func = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_r0;
-				std::vector<float> arr_r1;
-				std::vector<float> arr_r2;
-				std::vector<float> arr_r3;
-
-				std::string StrR0 = std::format("f_rest_{}", 3 + _order * 4 + 0);
-				std::string StrR1 = std::format("f_rest_{}", 3 + _order * 4 + 1);
-				std::string StrR2 = std::format("f_rest_{}", 3 + _order * 4 + 2);
-				std::string StrR3 = std::format("f_rest_{}", 3 + _order * 4 + 3);
-
-				attri->GetAttributeArray<float>(StrR0, arr_r0);
-				attri->GetAttributeArray<float>(StrR1, arr_r1);
-				attri->GetAttributeArray<float>(StrR2, arr_r2);
-				attri->GetAttributeArray<float>(StrR3, arr_r3);
-
-				int32 idx = _order;
-				GSData.r_sh1_4[idx].SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.r_sh1_4[idx][i] = FVector4f(arr_r0[i], arr_r1[i], arr_r2[i], arr_r3[i]);
-				}
-			};
-
-		// g-color1-4
-		auto SetG_Sh1_4Func = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_g0;
-				std::vector<float> arr_g1;
-				std::vector<float> arr_g2;
-				std::vector<float> arr_g3;
-
-				std::string StrG0 = std::format("f_rest_{}", 18 + _order * 4 + 0);
-				std::string StrG1 = std::format("f_rest_{}", 18 + _order * 4 + 1);
-				std::string StrG2 = std::format("f_rest_{}", 18 + _order * 4 + 2);
-				std::string StrG3 = std::format("f_rest_{}", 18 + _order * 4 + 3);
-
-				attri->GetAttributeArray<float>(StrG0, arr_g0);
-				attri->GetAttributeArray<float>(StrG1, arr_g1);
-				attri->GetAttributeArray<float>(StrG2, arr_g2);
-				attri->GetAttributeArray<float>(StrG3, arr_g3);
-
-				int32 idx = _order;
-				GSData.g_sh1_4[idx].SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.g_sh1_4[idx][i] = FVector4f(arr_g0[i], arr_g1[i], arr_g2[i], arr_g3[i]);
-				}
-			};
-
-		// b-color1-4
-		auto SetB_Sh1_4Func = [&GSData](const Ply3DGS::FAttributeCollection* attri, int32 _order = -1)
-			{
-				std::vector<float> arr_b0;
-				std::vector<float> arr_b1;
-				std::vector<float> arr_b2;
-				std::vector<float> arr_b3;
-
-				std::string StrB0 = std::format("f_rest_{}", 33 + _order * 4 + 0);
-				std::string StrB1 = std::format("f_rest_{}", 33 + _order * 4 + 1);
-				std::string StrB2 = std::format("f_rest_{}", 33 + _order * 4 + 2);
-				std::string StrB3 = std::format("f_rest_{}", 33 + _order * 4 + 3);
-
-				attri->GetAttributeArray<float>(StrB0, arr_b0);
-				attri->GetAttributeArray<float>(StrB1, arr_b1);
-				attri->GetAttributeArray<float>(StrB2, arr_b2);
-				attri->GetAttributeArray<float>(StrB3, arr_b3);
-
-				int32 idx = _order;
-				GSData.b_sh1_4[idx].SetNumUninitialized(GSData.NumParticles);
-				for (UINT i = 0; i < GSData.NumParticles; ++i) {
-					GSData.b_sh1_4[idx][i] = FVector4f(arr_b0[i], arr_b1[i], arr_b2[i], arr_b3[i]);
-				}
-			};
-		
-
-		std::ifstream stream(*Filename, std::ios::in | std::ios::binary);
-		if (stream.is_open()) {
-			Ply3DGS::EPlyErrorCode error = collection.LoadFromStream(stream);
-			if (error == Ply3DGS::EPlyErrorCode::PLY_OK) {
-
-				GSData.NumParticles = collection.GetParticleCount();
-
-				TArray<TFunction<void(const Ply3DGS::FAttributeCollection*, int32)>> funcArr;
-			
-				for (int i = 0; i < 3; ++i) {
-					funcArr.Add(SetR_Sh1_4Func);
-					funcArr.Add(SetG_Sh1_4Func);
-					funcArr.Add(SetB_Sh1_4Func);
-				}
-
-				funcArr.Add(SetPosRotFunc);
-				funcArr.Add(SetScaleFunc);
-			
-				funcArr.Add(SetRColor0Func);
-				funcArr.Add(SetGColor0Func);
-				funcArr.Add(SetBColor0Func);
-
-			//	for (int Idx = 0; Idx < funcArr.Num(); ++Idx) {
-			//		funcArr[Idx](&collection, Idx / 3);
-			//	}
-
-				ParallelFor(funcArr.Num(), [&](int32 Idx)
-					{
-						funcArr[Idx](&collection, Idx/3);
-					});
-
-				bResult = true;
-			}
-		}
-		return bResult;
-	}
-}	// namespace ply
-
 
 //----------------------------------------------------------------------------------------------------------------------------
 /*
@@ -294,6 +140,12 @@ public:
 
 	using FParameters = FTriangleVSParameters;
 
+	// SH_DEGREE 0 - 3, the VS only declares the band streams it reads
+	class FSHDegreeDim : SHADER_PERMUTATION_RANGE_INT("SH_DEGREE", 0, PLY::MaxShDegree + 1);
+	// posrot.w - scl.y hold the 3D covariance instead of rotation and scale, see PLY::ConvertToCovariance
+	class FCovarianceDim : SHADER_PERMUTATION_BOOL("PRECOMPUTED_COVARIANCE");
+	using FPermutationDomain = TShaderPermutationDomain<FSHDegreeDim, FCovarianceDim>;
+
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
 		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
@@ -302,11 +154,81 @@ public:
 	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
 	{
 		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-		OutEnvironment.SetDefine(TEXT("FULL_SH"), 1);
+
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		OutEnvironment.SetDefine(TEXT("FULL_SH"), PermutationVector.Get<FSHDegreeDim>() == PLY::MaxShDegree ? 1 : 0);
 	}
 };
 IMPLEMENT_SHADER_TYPE(, FTriangleVS, TEXT("/GSRuntime/GaussianSplatting.usf"), TEXT("MainVS"), SF_Vertex);
 
+/*
+*  FTrianglePackedVS : same VS fetching the packed records of GSPacked by SV_VertexID, no vertex streams
+*/
+class FTrianglePackedVS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FTrianglePackedVS);
+	SHADER_USE_PARAMETER_STRUCT(FTrianglePackedVS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FTrianglePackedVSParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FTriangleVS::FParameters, Common)
+		SHADER_PARAMETER_SRV(StructuredBuffer<float4>, gSplats)
+		SHADER_PARAMETER(uint32, gSplatStride4)		// float4 per record
+	END_SHADER_PARAMETER_STRUCT()
+
+	using FParameters = FTrianglePackedVSParameters;
+	using FPermutationDomain = FTriangleVS::FPermutationDomain;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return FTriangleVS::ShouldCompilePermutation(Parameters);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FTriangleVS::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("PACKED_SPLATS"), 1);
+	}
+};
+IMPLEMENT_SHADER_TYPE(, FTrianglePackedVS, TEXT("/GSRuntime/GaussianSplatting.usf"), TEXT("MainVS"), SF_Vertex);
+
+/*
+*  FTriangleCompactVS : same VS dequantizing the GSCompressed::FGpuSplats chunks by SV_VertexID, no vertex streams
+*/
+class FTriangleCompactVS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FTriangleCompactVS);
+	SHADER_USE_PARAMETER_STRUCT(FTriangleCompactVS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FTriangleCompactVSParameters, )
+		SHADER_PARAMETER_STRUCT_INCLUDE(FTriangleVS::FParameters, Common)
+		SHADER_PARAMETER_SRV(StructuredBuffer<float>, gChunks)
+		SHADER_PARAMETER_SRV(StructuredBuffer<uint4>, gSplats)
+		SHADER_PARAMETER_SRV(StructuredBuffer<uint>, gShRest)
+		SHADER_PARAMETER(uint32, gChunkSize)
+		SHADER_PARAMETER(uint32, gChunkStride)		// floats per chunk
+		SHADER_PARAMETER(uint32, gShRestStride)		// uint per splat
+	END_SHADER_PARAMETER_STRUCT()
+
+	using FParameters = FTriangleCompactVSParameters;
+	using FPermutationDomain = FTriangleVS::FPermutationDomain;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		// rotation and scale only, there is no compact covariance
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		return !PermutationVector.Get<FTriangleVS::FCovarianceDim>() && FTriangleVS::ShouldCompilePermutation(Parameters);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FTriangleVS::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("COMPACT_SPLATS"), 1);
+	}
+};
+IMPLEMENT_SHADER_TYPE(, FTriangleCompactVS, TEXT("/GSRuntime/GaussianSplatting.usf"), TEXT("MainVS"), SF_Vertex);
+
 /*
 *  FTriangleGS
 */
@@ -327,7 +249,8 @@ class FTriangleGS : public FGlobalShader
 	//	static FName NAME_LocalVertexFactory(TEXT("FLocalVertexFactory"));
 	//	Parameters.VertexFactoryType == FindVertexFactoryType(NAME_LocalVertexFactory);
 
-		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+		// without geometry shaders the actor draws quads, see GSQuadDraw.h
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6) && RHISupportsGeometryShaders(Parameters.Platform);
 	}
 
 	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
@@ -347,6 +270,9 @@ class FTrianglePS : public FGlobalShader
 	SHADER_USE_PARAMETER_STRUCT(FTrianglePS, FGlobalShader)
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FTrianglePSParameters, )
+		// not bound, they order the draw against the sort passes
+		RDG_BUFFER_ACCESS(SortedIndices, ERHIAccess::VertexOrIndexBuffer)
+		RDG_BUFFER_ACCESS(PosRot, ERHIAccess::VertexOrIndexBuffer | ERHIAccess::SRVGraphics)
 		RENDER_TARGET_BINDING_SLOTS()
 	END_SHADER_PARAMETER_STRUCT()
 
@@ -404,29 +330,25 @@ public:
 		Offset += sizeof(FVector4f);
 		Elements.Add(FVertexElement(3, Offset, VET_Float4, 5, Stride));	// sh0_b
 
+		// one declaration per SH degree, with only the band streams it uses (r, g, b per band stream)
 		Stride = sizeof(FVector4f);
-		Elements.Add(FVertexElement(6, 0, VET_Float4, 6, Stride));
-		Elements.Add(FVertexElement(7, 0, VET_Float4, 7, Stride));
-		Elements.Add(FVertexElement(8, 0, VET_Float4, 8, Stride));
-	
-		Elements.Add(FVertexElement(9, 0, VET_Float4, 9, Stride));
-		Elements.Add(FVertexElement(10, 0, VET_Float4, 10, Stride));
-		Elements.Add(FVertexElement(11, 0, VET_Float4, 11, Stride));
-	
-		Elements.Add(FVertexElement(12, 0, VET_Float4, 12, Stride));
-		Elements.Add(FVertexElement(13, 0, VET_Float4, 13, Stride));
-		Elements.Add(FVertexElement(14, 0, VET_Float4, 14, Stride));
-
-
-		VertexDeclarationRHI = PipelineStateCache::GetOrCreateVertexDeclaration(Elements);
+		for (int32 Degree = 0; Degree <= PLY::MaxShDegree; ++Degree) {
+			FVertexDeclarationElementList DegreeElements = Elements;
+			for (int32 Slot = 6; Slot < 6 + PLY::GetNumShBandStreams(Degree) * 3; ++Slot) {
+				DegreeElements.Add(FVertexElement(Slot, 0, VET_Float4, Slot, Stride));
+			}
+			VertexDeclarationRHI[Degree] = PipelineStateCache::GetOrCreateVertexDeclaration(DegreeElements);
+		}
 	}
 	virtual void ReleaseRHI() override
 	{
-		VertexDeclarationRHI.SafeRelease();
+		for (FVertexDeclarationRHIRef& Declaration : VertexDeclarationRHI) {
+			Declaration.SafeRelease();
+		}
 	}
 
 public:
-	FVertexDeclarationRHIRef VertexDeclarationRHI;
+	FVertexDeclarationRHIRef VertexDeclarationRHI[PLY::MaxShDegree + 1];
 };
 TGlobalResource<FTriangleVertexDeclaration> GTriangleVertexDeclaration;
 
@@ -470,21 +392,24 @@ void FGSSortedIndexBuffer::InitRHI(FRHICommandListBase& RHICmdList)
 {
 	if (!NumElelments) return;
 
-	TResourceArray<UINT, INDEXBUFFER_ALIGNMENT> IndexBuffer;
-	uint32 NumIndices = NumElelments;
-	IndexBuffer.AddUninitialized(NumIndices);
-	for (UINT i = 0; i < NumElelments; ++i) {
-		IndexBuffer[i] = i;
-	}
+	const uint32 IndexBufferSize = NumElelments * sizeof(UINT);
 
 	for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex)
 	{
-		FRHIResourceCreateInfo CreateInfo(TEXT("GSSortedIndexBuffer"), &IndexBuffer);
-		IndexBuffers[BufferIndex] = RHICmdList.CreateIndexBuffer(
-			sizeof(UINT), 
-			IndexBuffer.GetResourceDataSize(), 
-			BUF_Static | BUF_ShaderResource | BUF_UnorderedAccess, 
-			CreateInfo);
+		IndexBuffers[BufferIndex] = GSBufferPool::Acquire(
+			RHICmdList,
+			GSBufferPool::EKind::Index,
+			IndexBufferSize,
+			BUF_Static | BUF_ShaderResource | BUF_UnorderedAccess,
+			TEXT("GSSortedIndexBuffer"));
+
+		// identity, a recycled buffer holds its previous owner's order
+		UINT* Indices = static_cast<UINT*>(RHICmdList.LockBuffer(IndexBuffers[BufferIndex], 0, IndexBufferSize, RLM_WriteOnly));
+		for (UINT i = 0; i < NumElelments; ++i) {
+			Indices[i] = i;
+		}
+		RHICmdList.UnlockBuffer(IndexBuffers[BufferIndex]);
+
 		IndexBufferSRVs[BufferIndex] = RHICmdList.CreateShaderResourceView(
 			IndexBuffers[BufferIndex],
 			/*Stride=*/ sizeof(uint32),
@@ -502,7 +427,7 @@ void FGSSortedIndexBuffer::ReleaseRHI()
 	{
 		IndexBufferUAVs[BufferIndex].SafeRelease();
 		IndexBufferSRVs[BufferIndex].SafeRelease();
-		IndexBuffers[BufferIndex].SafeRelease();
+		GSBufferPool::Release(IndexBuffers[BufferIndex]);
 	}
 }
 
@@ -520,11 +445,12 @@ void FGSSortedKeyBuffer::InitRHI(FRHICommandListBase& RHICmdList)
 
 	for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex)
 	{
-		FRHIResourceCreateInfo CreateInfo(TEXT("GSSortedKeyBuffer"));
-		KeyBuffers[BufferIndex] = RHICmdList.CreateVertexBuffer(
+		KeyBuffers[BufferIndex] = GSBufferPool::Acquire(
+			RHICmdList,
+			GSBufferPool::EKind::Vertex,
 			OffsetsBufferSize,
 			BUF_Static | BUF_ShaderResource | BUF_UnorderedAccess,
-			CreateInfo);
+			TEXT("GSSortedKeyBuffer"));
 		KeyBufferSRVs[BufferIndex] = RHICmdList.CreateShaderResourceView(
 			KeyBuffers[BufferIndex],
 			/*Stride=*/ sizeof(uint32),
@@ -542,7 +468,7 @@ void FGSSortedKeyBuffer::ReleaseRHI()
 	{
 		KeyBufferUAVs[BufferIndex].SafeRelease();
 		KeyBufferSRVs[BufferIndex].SafeRelease();
-		KeyBuffers[BufferIndex].SafeRelease();
+		GSBufferPool::Release(KeyBuffers[BufferIndex]);
 	}
 }
 
@@ -564,12 +490,30 @@ AGSActor::AGSActor()
 	RootComponent->SetWorldScale3D(FVector(1.0f));
 
 	WVPMat.SetIdentity();
-	PreWVPMat.SetIdentity();
 }
 
-AGSActor::~AGSActor()
+void AGSActor::BeginDestroy()
 {
-	ReleaseBuffers();
+	Super::BeginDestroy();
+
+	if (LoadCanceled) {
+		*LoadCanceled = true;
+	}
+
+	// The render commands enqueued so far may hold the actor, those after see an unreachable WeakSelf. Release on
+	// the render thread behind them and hold FinishDestroy until then.
+	AGSActor* self = this;
+	ENQUEUE_RENDER_COMMAND(AGSActor_ReleaseBuffers)(
+		[self](FRHICommandListImmediate& RHICmdList)
+		{
+			self->ReleaseBuffers();
+		});
+	ReleaseFence.BeginFence();
+}
+
+bool AGSActor::IsReadyForFinishDestroy()
+{
+	return Super::IsReadyForFinishDestroy() && ReleaseFence.IsFenceComplete();
 }
 
 bool AGSActor::ShouldTickIfViewportsOnly() const
@@ -581,25 +525,7 @@ void AGSActor::PostLoad()
 {
 	Super::PostLoad();
 
-//	if (!PlyFileName.IsEmpty()) {
-//		AGSActor* self = this;
-//		ENQUEUE_RENDER_COMMAND(AGSActor_PostLoad)(
-//			[self](FRHICommandListImmediate& RHICmdList)
-//			{
-//				self->ReleaseBuffers();
-//
-//				// create GS buffer form ply file
-//				self->CreateVBFromPlyFile(RHICmdList, self->PlyFileName);
-//				
-//				// initialize sorted index buffer 
-//				self->SortedIndexBuffer.NumElelments = self->NumParticles;
-//				self->SortedIndexBuffer.InitRHI(RHICmdList);
-//
-//				// initialize sorted key buffer 
-//				self->SortedKeyBuffer.NumElelments = self->NumParticles;
-//				self->SortedKeyBuffer.InitRHI(RHICmdList);	
-//			});
-//	}
+	LoadSplatsAsync();
 }
 
 void AGSActor::PreInitializeComponents()
@@ -644,6 +570,16 @@ void AGSActor::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEven
 	Super::PostEditChangeProperty(PropertyChangedEvent);
 	const FName memberPropertyName = PropertyChangedEvent.MemberProperty ? PropertyChangedEvent.MemberProperty->GetFName() : NAME_None;
 
+	if (memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, PlyFileName)
+		|| memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, MaxSHDegree)
+		|| memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, bPackedLayout)
+		|| memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, bPrecomputedCovariance)
+		|| memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, bCompactLayout)
+		|| memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, bEnablePaging)
+		|| memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, PagingBudgetMB)) {
+		LoadSplatsAsync();
+	}
+
 	if (memberPropertyName == GET_MEMBER_NAME_CHECKED(AGSActor, GSInfos)) {
 
 		UE_LOG(LogGSActor, Warning, TEXT("change value : GSInfos"));
@@ -721,7 +657,8 @@ void AGSActor::Tick(float DeltaTime)
 				{
 					self->CurrentFrame = (self->CurrentFrame + 1) % 300;
 					self->ReadAnimDataFromPly_RenderThread(RHICmdList, self->CurrentFrame);
-					self->PreWVPMat.SetIdentity();
+					self->ResortCount = 0;
+					self->SortSchedule.RequestSort();
 				});
 			PreFrame = CurrentFrame;
 
@@ -733,121 +670,941 @@ void AGSActor::Tick(float DeltaTime)
 
 	ElapsedTime += DeltaTime;
 
-	if (NumParticles != 0) {
-	//	FLevelEditorViewportClient* vp = GCurrentLevelEditingViewportClient;
-	//	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(vp->Viewport, vp->GetScene(), vp->EngineShowFlags));
-	//	FSceneView* View = vp->CalcSceneView(&ViewFamily);
-	//	FMatrix wvpMat = GetActorTransform().ToMatrixWithScale() * View->ViewMatrices.GetViewProjectionMatrix();
-	
-		if (WVPMat.Equals(PreWVPMat)) {
-			return;
+	UpdatePaging();
+
+	// the splats are sorted in Render, as RDG passes of the view they are drawn for
+}
+
+void AGSActor::ReleaseBuffers()
+{
+	check(IsInRenderingThread());
+
+	NumParticles = 0;
+	ParticleCapacity = 0;
+
+	// back to GSBufferPool, the next load of a similar size reuses them
+	RDGBuffers.Reset();
+	PosRotVBSRV.SafeRelease();
+	for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+		StreamSRVs[s].SafeRelease();
+		GSBufferPool::Release(GetStreamVB(s).VertexBufferRHI);
+	}
+	TileRasterizer.Release();
+
+	SortedIndexBuffer.ReleaseRHI();
+	SortedKeyBuffer.ReleaseRHI();
+	SortedIndexBuffer.NumElelments = 0;
+	SortedKeyBuffer.NumElelments = 0;
+	DepthKeyGen.Release();
+
+	CullingChunks.Reset();
+	VisibleChunks.Reset();
+	NumChunkIndices = 0;
+	SortBounds.Init();
+	ChunkIndexSRV.SafeRelease();
+	GSBufferPool::Release(ChunkIndexBuffer);
+	VisibleChunkSRV.SafeRelease();
+	GSBufferPool::Release(VisibleChunkBuffer);
+
+	ResortCount = 0;
+	ResortChunks.Reset();
+
+	CpuPositions.Empty();
+	CpuSortKeys.Empty();
+	CpuSortIndices.Empty();
+	CpuSortScratchKeys.Empty();
+	CpuSortScratchIndices.Empty();
+
+	GSBufferPool::Release(PoolScratchVB);
+	PoolPageSize = 0;
+
+	PackedSplatSRV.SafeRelease();
+	PackedSplatBuffer.SafeRelease();
+	bPackedUploaded = false;
+
+	CompactChunkSRV.SafeRelease();
+	CompactChunkBuffer.SafeRelease();
+	CompactSplatSRV.SafeRelease();
+	CompactSplatBuffer.SafeRelease();
+	CompactShRestSRV.SafeRelease();
+	CompactShRestBuffer.SafeRelease();
+	bCompactUploaded = false;
+}
+
+void AGSActor::LoadSplatsAsync()
+{
+	check(IsInGameThread());
+
+	if (PlyFileName.IsEmpty()) {
+		return;
+	}
+
+	const uint32 Generation = ++LoadGeneration;
+	LoadState = EGSLoadState::Loading;
+
+	if (LoadCanceled) {
+		*LoadCanceled = true;
+	}
+	LoadCanceled = MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(false);
+
+	PagedFile.Reset();
+	ResidentPages.Reset();
+	PagesInFlight.Reset();
+
+	if (bEnablePaging) {
+		LoadSplatsPaged(Generation);
+		return;
+	}
+
+	// cooked files are mapped and uploaded as is, nothing to stream
+	const bool bCooked = !GSCooked::FindCookedFile(PlyFileName).IsEmpty();
+	if (bProgressiveLoad && !bCooked) {
+		LoadSplatsProgressive(Generation, false);
+		return;
+	}
+
+	// too large to be decoded in one piece : a whole-file decode holds every stream twice at its peak (scratch + upload)
+	const int64 SlicedLoadMinBytes = (int64)CVarSlicedLoadMinMB.GetValueOnGameThread() * 1024 * 1024;
+	if (SlicedLoadMinBytes > 0 && !bCooked && !bPackedLayout && !bCompactLayout && !GSCompressed::IsCompressedFile(PlyFileName)
+		&& IFileManager::Get().FileSize(*PlyFileName) >= SlicedLoadMinBytes) {
+		LoadSplatsProgressive(Generation, true);
+		return;
+	}
+
+	TWeakObjectPtr<AGSActor> WeakSelf(this);
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakSelf, Generation, Filename = PlyFileName, ShDegree = MaxSHDegree, bPacked = bPackedLayout, bCovariance = bPrecomputedCovariance, bCompact = bCompactLayout, bCull = CVarCullChunks.GetValueOnGameThread() != 0]()
+		{
+			// decode stage : file read, parse and activation, off the render thread
+			TSharedRef<GSCooked::FSplatPayload, ESPMode::ThreadSafe> Payload = MakeShared<GSCooked::FSplatPayload, ESPMode::ThreadSafe>();
+			TSharedPtr<GSCompressed::FGpuSplats, ESPMode::ThreadSafe> Compact;
+			bool bLoaded = false;
+
+			if (bCompact) {
+				// quantized from the decoded source, a cooked mapping holds float streams only
+				GSLoadArena::FLoadScope LoadScope(Filename);
+				const GSLoadArena::FScratchRef Scratch = GSLoadArena::Acquire();
+				PLY::FGaussSplatVertex& GSData = Scratch->GSData;
+				bLoaded = GSDerivedData::LoadPlyFileCached(Filename, GSData, ShDegree);
+				if (bLoaded) {
+					Compact = MakeShared<GSCompressed::FGpuSplats, ESPMode::ThreadSafe>();
+					GSCompressed::BuildGpuSplats(GSData, ShDegree, *Compact);
+
+					const PLY::FSplatStreams Streams = PLY::GetStreams(GSData);
+					uint64 StreamBytes = 0;
+					for (FResourceArrayInterface* Stream : Streams.Streams) {
+						StreamBytes += Stream ? Stream->GetResourceDataSize() : 0;
+					}
+					UE_LOG(LogGSActor, Log, TEXT("compact : %u splats in %.1f MB of VRAM, %.1f MB as float streams"), GSData.NumParticles,
+						Compact->GetVramBytes() / (1024. * 1024.), StreamBytes / (1024. * 1024.));
+				}
+			}
+			else {
+				bLoaded = Payload->Load(Filename, ShDegree, bCovariance);
+			}
+			if (!bLoaded) {
+				UE_LOG(LogGSActor, Warning, TEXT("could not load \"%s\""), *Filename);
+			}
+
+			TSharedPtr<TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>, ESPMode::ThreadSafe> Packed;
+			if (bLoaded && bPacked && !Compact) {
+				Packed = MakeShared<TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>, ESPMode::ThreadSafe>();
+				GSPacked::Pack(Payload->GetStreams(), *Packed);
+			}
+
+			TSharedPtr<GSCull::FSplatChunks, ESPMode::ThreadSafe> Chunks;
+			if (bLoaded && bCull) {
+				Chunks = MakeShared<GSCull::FSplatChunks, ESPMode::ThreadSafe>();
+				if (Compact) {
+					GSCull::BuildChunks(*Compact, *Chunks);
+				}
+				else {
+					GSCull::BuildChunks(Payload->GetStreams(), 0, *Chunks);
+				}
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation, Payload, Packed, Compact, Chunks, bLoaded]()
+				{
+					AGSActor* self = WeakSelf.Get();
+					if (!self || Generation != self->LoadGeneration) {
+						return;		// destroyed, or superseded by a newer load
+					}
+
+					if (!bLoaded) {
+						self->LoadState = EGSLoadState::Failed;
+						self->OnSplatsLoaded.Broadcast(false);
+						return;
+					}
+
+					ENQUEUE_RENDER_COMMAND(AGSActor_UploadSplats)(
+						[self, WeakSelf, Generation, Payload, Packed, Compact, Chunks](FRHICommandListImmediate& RHICmdList)
+						{
+							// upload stage : the previous buffers are drawn until this point
+							self->ReleaseBuffers();
+							if (Compact) {
+								self->CreateCompactBuffers(RHICmdList, *Compact);
+							}
+							else if (Packed) {
+								self->CreatePackedBuffer(RHICmdList, Payload->GetStreams(), Packed.Get());
+							}
+							else {
+								self->CreateVBFromStreams(RHICmdList, Payload->GetStreams());
+							}
+							if (Chunks) {
+								self->AppendCullingChunks(RHICmdList, *Chunks);
+							}
+
+							// initialize sorted index buffer 
+							self->SortedIndexBuffer.NumElelments = self->NumParticles;
+							self->SortedIndexBuffer.InitRHI(RHICmdList);
+
+							// initialize sorted key buffer 
+							self->SortedKeyBuffer.NumElelments = self->NumParticles;
+							self->SortedKeyBuffer.InitRHI(RHICmdList);
+
+							// nothing is drawn until the new splats have been sorted once
+							self->SortedCount = 0;
+							self->SortSchedule.RequestSort();
+
+							AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation]()
+								{
+									AGSActor* self = WeakSelf.Get();
+									if (self && Generation == self->LoadGeneration) {
+										self->LoadState = EGSLoadState::Loaded;
+										self->OnSplatsLoaded.Broadcast(true);
+									}
+								});
+						});
+				});
+		});
+}
+
+void AGSActor::LoadSplatsProgressive(uint32 Generation, bool bSliced)
+{
+	TWeakObjectPtr<AGSActor> WeakSelf(this);
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakSelf, Generation, bSliced, Canceled = LoadCanceled, Filename = PlyFileName, ShDegree = MaxSHDegree, bCovariance = bPrecomputedCovariance,
+		bCull = CVarCullChunks.GetValueOnGameThread() != 0]()
+		{
+			UINT NumDecoded = 0;
+			auto OnChunk = [&](const PLY::FSplatChunkRef& Chunk, UINT NumTotal)
+				{
+					if (bCovariance) {
+						PLY::ConvertToCovariance(*Chunk);
+					}
+					const UINT Offset = NumDecoded;
+					NumDecoded += Chunk->NumParticles;
+
+					TSharedPtr<GSCull::FSplatChunks, ESPMode::ThreadSafe> CullChunks;
+					if (bCull) {
+						CullChunks = MakeShared<GSCull::FSplatChunks, ESPMode::ThreadSafe>();
+						GSCull::BuildChunks(PLY::GetStreams(*Chunk), Offset, *CullChunks);
+					}
+
+					AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation, Chunk, CullChunks, Offset, NumTotal]()
+						{
+							AGSActor* self = WeakSelf.Get();
+							if (!self || Generation != self->LoadGeneration) {
+								return;
+							}
+
+							ENQUEUE_RENDER_COMMAND(AGSActor_AppendSplats)(
+								[self, Chunk, CullChunks, Offset, NumTotal](FRHICommandListImmediate& RHICmdList)
+								{
+									// the previous splats are drawn until the first chunk is in
+									if (Offset == 0) {
+										self->ReleaseBuffers();
+										self->AllocateVBs(RHICmdList, NumTotal, Chunk->ShDegree, Chunk->bCovariance);
+									}
+									self->AppendStreams(RHICmdList, PLY::GetStreams(*Chunk));
+									if (CullChunks) {
+										self->AppendCullingChunks(RHICmdList, *CullChunks);
+									}
+
+									// sort again with the new splats, the previous order is drawn meanwhile
+									self->SortSchedule.RequestSort();
+								});
+						});
+
+					return !*Canceled;
+				};
+
+			// sliced : file order, a slice is decoded again once its upload has dropped it
+			const UINT ChunkSize = (UINT)CVarProgressiveChunkSize.GetValueOnAnyThread();
+			PLY::FSliceStats SliceStats;
+			const bool bLoaded = bSliced
+				? PLY::LoadPlyFileSliced(Filename, ChunkSize, ShDegree, OnChunk, &SliceStats, Canceled.Get())
+				: PLY::LoadPlyFileProgressive(Filename, ChunkSize, ShDegree, OnChunk);
+			if (bSliced) {
+				UE_LOG(LogGSActor, Log, TEXT("sliced load of \"%s\" : %u splats through %.1f MB of staging"), *Filename, NumDecoded, SliceStats.PeakStagingBytes / (1024. * 1024.));
+			}
+
+			if (!bLoaded && !*Canceled) {
+				UE_LOG(LogGSActor, Warning, TEXT("could not load \"%s\""), *Filename);
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation, bLoaded]()
+				{
+					AGSActor* self = WeakSelf.Get();
+					if (!self || Generation != self->LoadGeneration) {
+						return;
+					}
+
+					// queued behind the last chunk upload
+					ENQUEUE_RENDER_COMMAND(AGSActor_AppendSplatsDone)(
+						[WeakSelf, Generation, bLoaded](FRHICommandListImmediate& RHICmdList)
+						{
+							AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation, bLoaded]()
+								{
+									AGSActor* self = WeakSelf.Get();
+									if (self && Generation == self->LoadGeneration) {
+										self->LoadState = bLoaded ? EGSLoadState::Loaded : EGSLoadState::Failed;
+										self->OnSplatsLoaded.Broadcast(bLoaded);
+									}
+								});
+						});
+				});
+		});
+}
+
+void AGSActor::LoadSplatsPaged(uint32 Generation)
+{
+	TWeakObjectPtr<AGSActor> WeakSelf(this);
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakSelf, Generation, Filename = PlyFileName, ShDegree = MaxSHDegree, bCovariance = bPrecomputedCovariance]()
+		{
+			// partition only reads positions, pages are decoded on demand afterwards
+			TSharedRef<PLY::FPagedPlyFile, ESPMode::ThreadSafe> File = MakeShared<PLY::FPagedPlyFile, ESPMode::ThreadSafe>();
+			const bool bOpened = File->Open(Filename, (UINT)CVarPagingPageSize.GetValueOnAnyThread(), ShDegree);
+			if (!bOpened) {
+				UE_LOG(LogGSActor, Warning, TEXT("could not page \"%s\", paging needs a binary PLY source"), *Filename);
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation, File, bOpened, bCovariance]()
+				{
+					AGSActor* self = WeakSelf.Get();
+					if (!self || Generation != self->LoadGeneration) {
+						return;
+					}
+
+					if (!bOpened) {
+						self->LoadState = EGSLoadState::Failed;
+						self->OnSplatsLoaded.Broadcast(false);
+						return;
+					}
+
+					// streams and sort buffers of one page
+					const UINT PageSize = File->GetPageSize();
+					uint64 PageBytes = (uint64)PageSize * 4 * sizeof(uint32);
+					for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+						if (PLY::IsStreamUsed(s, File->GetShDegree())) {
+							PageBytes += (uint64)PageSize * PLY::GetStreamStride(s);
+						}
+					}
+					self->NumPoolSlots = FMath::Clamp<int32>((int32)(((uint64)self->PagingBudgetMB << 20) / PageBytes), 1, FMath::Max(File->GetNumPages(), 1));
+					self->PagedFile = File;
+
+					UE_LOG(LogGSActor, Log, TEXT("paging %u splats in %d pages, %d resident (%d MB)"),
+						File->GetNumParticles(), File->GetNumPages(), self->NumPoolSlots, (int32)((self->NumPoolSlots * PageBytes) >> 20));
+
+					FBox3f Bounds(ForceInit);
+					for (int32 Page = 0; Page < File->GetNumPages(); ++Page) {
+						Bounds += File->GetPageBounds(Page);
+					}
+
+					ENQUEUE_RENDER_COMMAND(AGSActor_AllocatePagePool)(
+						[self, PageSize, NumSlots = self->NumPoolSlots, ShDegree = File->GetShDegree(), bCovariance, Bounds](FRHICommandListImmediate& RHICmdList)
+						{
+							self->ReleaseBuffers();
+							self->SortBounds = Bounds;
+							self->AllocateVBs(RHICmdList, NumSlots * PageSize, ShDegree, bCovariance);
+							self->GrowSortBuffers(RHICmdList, NumSlots * PageSize);
+							self->PoolPageSize = PageSize;
+
+							self->PoolScratchVB = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, PageSize * PLY::GetStreamStride(PLY::SplatStream_Sh0), BUF_Static, TEXT("GSPoolScratchVB"));
+
+							self->SortedCount = 0;
+							self->SortSchedule.RequestSort();
+						});
+
+					self->LoadState = EGSLoadState::Loaded;
+					self->OnSplatsLoaded.Broadcast(true);
+				});
+		});
+}
+
+void AGSActor::UpdatePaging()
+{
+	const int32 MaxInFlight = FMath::Max(1, CVarPagingMaxInFlight.GetValueOnGameThread());
+	if (!PagedFile || PagesInFlight.Num() >= MaxInFlight) {
+		return;
+	}
+
+	// nearest NumPoolSlots pages to the camera, in actor local space
+	const FVector3f Camera = (FVector3f)GetActorTransform().InverseTransformPosition(ViewOrigin);
+	const int32 NumPages = PagedFile->GetNumPages();
+	PageDistances.SetNumUninitialized(NumPages);
+	TArray<int32> Pages;
+	Pages.SetNumUninitialized(NumPages);
+	for (int32 Page = 0; Page < NumPages; ++Page) {
+		PageDistances[Page] = PagedFile->GetPageBounds(Page).ComputeSquaredDistanceToPoint(Camera);
+		Pages[Page] = Page;
+	}
+	Algo::Sort(Pages, [this](int32 A, int32 B) { return PageDistances[A] < PageDistances[B]; });
+
+	TWeakObjectPtr<AGSActor> WeakSelf(this);
+	for (int32 Rank = 0; Rank < NumPoolSlots && PagesInFlight.Num() < MaxInFlight; ++Rank) {
+		const int32 Page = Pages[Rank];
+		if (ResidentPages.Contains(Page) || PagesInFlight.Contains(Page)) {
+			continue;
 		}
-		PreWVPMat = WVPMat;
 
-		AGSActor* self = this;
-		ENQUEUE_RENDER_COMMAND(AGSActor_Tick)(
-			[self](FRHICommandListImmediate& RHICmdList)
+		PagesInFlight.Add(Page);
+		UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakSelf, Generation = LoadGeneration, File = PagedFile, Page, bCovariance = bPrecomputedCovariance]()
 			{
-				self->SortedCount = self->SortKeyGen.Execute_RenderThread( RHICmdList
-																		 , self->NumParticles
-																		 , (FMatrix44f)self->WVPMat
-																		 , self->PosRotVBSRV
-																		 , self->SortedKeyBuffer.KeyBufferUAVs[0]
-																		 , self->SortedIndexBuffer.IndexBufferUAVs[0] );
-				FGPUSortBuffers SortBuffers;
-				for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex)
-				{
-					SortBuffers.RemoteKeySRVs[BufferIndex] = self->SortedKeyBuffer.KeyBufferSRVs[BufferIndex];
-					SortBuffers.RemoteKeyUAVs[BufferIndex] = self->SortedKeyBuffer.KeyBufferUAVs[BufferIndex];
-					SortBuffers.RemoteValueSRVs[BufferIndex] = self->SortedIndexBuffer.IndexBufferSRVs[BufferIndex];
-					SortBuffers.RemoteValueUAVs[BufferIndex] = self->SortedIndexBuffer.IndexBufferUAVs[BufferIndex];
+				TSharedRef<PLY::FGaussSplatVertex, ESPMode::ThreadSafe> Chunk = GSLoadArena::AcquireStreams();
+				File->DecodePage(Page, *Chunk);
+				if (bCovariance) {
+					PLY::ConvertToCovariance(*Chunk);
 				}
-	
-				self->ResultBufferIndex = SortGPUBuffers(RHICmdList, SortBuffers, 0, 0xFFFFFFFF, self->SortedCount, ERHIFeatureLevel::Type::SM6);
+
+				AsyncTask(ENamedThreads::GameThread, [WeakSelf, Generation, Page, Chunk]()
+					{
+						AGSActor* self = WeakSelf.Get();
+						if (self && Generation == self->LoadGeneration) {
+							self->OnPageDecoded(Page, Chunk);
+						}
+					});
 			});
-	
-	//	FString msg = FString::Printf(TEXT("%d"), SortedCount);
-	//	UKismetSystemLibrary::PrintString(this, msg, true, true, FColor::Cyan, 2.f, TEXT("None"));
 	}
 }
 
-void AGSActor::ReleaseBuffers()
+void AGSActor::OnPageDecoded(int32 Page, const TSharedRef<PLY::FGaussSplatVertex, ESPMode::ThreadSafe>& Chunk)
+{
+	PagesInFlight.Remove(Page);
+
+	const FVector3f Camera = (FVector3f)GetActorTransform().InverseTransformPosition(ViewOrigin);
+	auto GetDistance = [this, &Camera](int32 InPage) { return PagedFile->GetPageBounds(InPage).ComputeSquaredDistanceToPoint(Camera); };
+
+	int32 EvictSlot = INDEX_NONE;
+	if (ResidentPages.Num() == NumPoolSlots) {
+		// pool is full : replace the farthest resident page, when it is farther than this one
+		float FarthestDistance = GetDistance(Page);
+		for (int32 Slot = 0; Slot < ResidentPages.Num(); ++Slot) {
+			const float Distance = GetDistance(ResidentPages[Slot]);
+			if (Distance > FarthestDistance) {
+				FarthestDistance = Distance;
+				EvictSlot = Slot;
+			}
+		}
+		if (EvictSlot == INDEX_NONE) {
+			return;
+		}
+
+		// the last slot moves into the evicted one, see EvictPoolSlot
+		ResidentPages[EvictSlot] = ResidentPages.Last();
+		ResidentPages.Pop();
+	}
+	ResidentPages.Add(Page);
+
+	AGSActor* self = this;
+	ENQUEUE_RENDER_COMMAND(AGSActor_PageIn)(
+		[self, EvictSlot, Chunk](FRHICommandListImmediate& RHICmdList)
+		{
+			if (EvictSlot != INDEX_NONE) {
+				self->EvictPoolSlot(RHICmdList, EvictSlot);
+			}
+			self->AppendStreams(RHICmdList, PLY::GetStreams(*Chunk));
+
+			// sort the new resident set from scratch, the previous order is drawn meanwhile
+			self->ResortCount = 0;
+			self->SortSchedule.RequestSort();
+		});
+}
+
+void AGSActor::EvictPoolSlot(FRHICommandList& RHICmdList, int32 Slot)
+{
+	check(IsInRenderingThread());
+	check(PoolPageSize && NumParticles >= PoolPageSize);
+
+	const int32 LastSlot = NumParticles / PoolPageSize - 1;
+	NumParticles -= PoolPageSize;
+	if (CpuPositions.Num()) {
+		if (Slot != LastSlot) {
+			FMemory::Memcpy(&CpuPositions[Slot * PoolPageSize], &CpuPositions[LastSlot * PoolPageSize], PoolPageSize * sizeof(FVector3f));
+		}
+		CpuPositions.SetNum(NumParticles, false);
+	}
+	if (Slot == LastSlot) {
+		return;
+	}
+
+	// Keeps the resident pages contiguous, so key generation, sorting and drawing only see [0, NumParticles).
+	// A buffer cannot be copy source and destination at once, the move goes through PoolScratchVB.
+	for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+		if (!PLY::IsStreamUsed(s, ShDegree)) {
+			continue;
+		}
+
+		FRHIBuffer* VertexBuffer = GetStreamVB(s).VertexBufferRHI;
+		const uint64 SlotBytes = (uint64)PoolPageSize * PLY::GetStreamStride(s);
+
+		RHICmdList.Transition({
+			FRHITransitionInfo(VertexBuffer, ERHIAccess::Unknown, ERHIAccess::CopySrc),
+			FRHITransitionInfo(PoolScratchVB, ERHIAccess::Unknown, ERHIAccess::CopyDest) });
+		RHICmdList.CopyBufferRegion(PoolScratchVB, 0, VertexBuffer, LastSlot * SlotBytes, SlotBytes);
+
+		RHICmdList.Transition({
+			FRHITransitionInfo(VertexBuffer, ERHIAccess::CopySrc, ERHIAccess::CopyDest),
+			FRHITransitionInfo(PoolScratchVB, ERHIAccess::CopyDest, ERHIAccess::CopySrc) });
+		RHICmdList.CopyBufferRegion(VertexBuffer, Slot * SlotBytes, PoolScratchVB, 0, SlotBytes);
+
+		RHICmdList.Transition(FRHITransitionInfo(VertexBuffer, ERHIAccess::CopyDest, ERHIAccess::VertexOrIndexBuffer | ERHIAccess::SRVMask));
+
+		// moved outside any graph : RDG starts over from a new wrapper, which knows nothing of the state left here
+		RDGBuffers.Remove(VertexBuffer);
+	}
+}
+
+FVertexBuffer& AGSActor::GetStreamVB(int32 Stream)
+{
+	switch (Stream) {
+	case PLY::SplatStream_PosRot:	return PosRotVB;
+	case PLY::SplatStream_Scale:	return SclVB;
+	case PLY::SplatStream_Sh0:		return SH04VB;
+	}
+
+	const int32 Band = (Stream - PLY::SplatStream_Sh1_4) / 3;
+	switch ((Stream - PLY::SplatStream_Sh1_4) % 3) {
+	case 0:		return R_Sh1_4VB[Band];
+	case 1:		return G_Sh1_4VB[Band];
+	default:	return B_Sh1_4VB[Band];
+	}
+}
+
+void AGSActor::AllocateVBs(FRHICommandListBase& RHICmdList, UINT Capacity, int32 InShDegree, bool bInCovariance)
 {
+	check(IsInRenderingThread());
+
 	NumParticles = 0;
+	ParticleCapacity = Capacity;
+	ShDegree = InShDegree;
+	bCovariance = bInCovariance;
+	if (!Capacity) {
+		return;
+	}
+
+	for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+		if (!PLY::IsStreamUsed(s, ShDegree)) {
+			continue;
+		}
+		const EBufferUsageFlags Usage = BUF_Static | BUF_ShaderResource;	// PosRot for the sort keys, all of them for the tile rasterizer
+		GetStreamVB(s).VertexBufferRHI = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, Capacity * PLY::GetStreamStride(s), Usage, GSplatStreamVBNames[s]);
+	}
+	PosRotVBSRV = RHICmdList.CreateShaderResourceView(PosRotVB.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
+}
+
+void AGSActor::AppendStreams(FRHICommandListBase& RHICmdList, const PLY::FSplatStreams& Chunk)
+{
+	check(IsInRenderingThread());
+	check(NumParticles + Chunk.NumParticles <= ParticleCapacity);
+	check(Chunk.ShDegree == ShDegree);
+	check(Chunk.bCovariance == bCovariance);
+
+	if (!Chunk.NumParticles) {
+		return;
+	}
+
+	CaptureCpuPositions(Chunk.Streams[PLY::SplatStream_PosRot], Chunk.NumParticles);
+	for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+		if (!Chunk.Streams[s]) {
+			continue;
+		}
+		const uint32 Stride = PLY::GetStreamStride(s);
+		FBufferRHIRef& VertexBuffer = GetStreamVB(s).VertexBufferRHI;
+		void* Dst = RHICmdList.LockBuffer(VertexBuffer, NumParticles * Stride, Chunk.NumParticles * Stride, RLM_WriteOnly);
+		FMemory::Memcpy(Dst, Chunk.Streams[s]->GetResourceData(), Chunk.NumParticles * Stride);
+		RHICmdList.UnlockBuffer(VertexBuffer);
+	}
 
-	for (int i = 0; i < 3; ++i) {
-		R_Sh1_4VB[i].ReleaseRHI();
-		G_Sh1_4VB[i].ReleaseRHI();
-		B_Sh1_4VB[i].ReleaseRHI();
+	NumParticles += Chunk.NumParticles;
+	GrowSortBuffers(RHICmdList, NumParticles);
+}
+
+void AGSActor::GrowSortBuffers(FRHICommandListBase& RHICmdList, UINT NumRequired)
+{
+	if (NumRequired <= SortedIndexBuffer.NumElelments) {
+		return;
 	}
 
-	SclVB.ReleaseRHI();
-	SH04VB.ReleaseRHI();
-	PosRotVB.ReleaseRHI();
+	// geometric growth up to the VB capacity, a progressive load reallocates O(log n) times
+	const UINT NumElements = FMath::Max(NumRequired, FMath::Min(SortedIndexBuffer.NumElelments * 2, ParticleCapacity));
 
+	// both buffers restart as identity, so the SortedCount previous particles stay drawable until the next sort
+	for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex) {
+		RDGBuffers.Remove(SortedIndexBuffer.IndexBuffers[BufferIndex]);
+		RDGBuffers.Remove(SortedKeyBuffer.KeyBuffers[BufferIndex]);
+	}
 	SortedIndexBuffer.ReleaseRHI();
+	SortedIndexBuffer.NumElelments = NumElements;
+	SortedIndexBuffer.InitRHI(RHICmdList);
+
 	SortedKeyBuffer.ReleaseRHI();
+	SortedKeyBuffer.NumElelments = NumElements;
+	SortedKeyBuffer.InitRHI(RHICmdList);
+	ResortCount = 0;
 }
 
-bool AGSActor::CreateVBFromPlyFile(FRHICommandListBase& RHICmdList, const FString& Filename)
+void AGSActor::AppendCullingChunks(FRHICommandListBase& RHICmdList, const GSCull::FSplatChunks& Chunks)
 {
-	bool bResult = false;
 	check(IsInRenderingThread());
+	check(NumChunkIndices + Chunks.Indices.Num() <= ParticleCapacity);
 
-	PLY::FGaussSplatVertex GSData;
+	if (!ChunkIndexBuffer) {
+		ChunkIndexBuffer = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, ParticleCapacity * sizeof(uint32), BUF_Static | BUF_ShaderResource, TEXT("GSChunkIndices"));
+		ChunkIndexSRV = RHICmdList.CreateShaderResourceView(ChunkIndexBuffer, sizeof(uint32), PF_R32_UINT);
+	}
 
-	if (PLY::LoadPlyFile(Filename, GSData)) {
-		NumParticles = GSData.NumParticles;
+	if (Chunks.Indices.Num()) {
+		void* Dst = RHICmdList.LockBuffer(ChunkIndexBuffer, NumChunkIndices * sizeof(uint32), Chunks.Indices.Num() * sizeof(uint32), RLM_WriteOnly);
+		FMemory::Memcpy(Dst, Chunks.Indices.GetData(), Chunks.Indices.Num() * sizeof(uint32));
+		RHICmdList.UnlockBuffer(ChunkIndexBuffer);
+	}
 
-		// Pos and Rot VB
-		{
-			FRHIResourceCreateInfo CreateInfo(TEXT("FPositionRotationVB"), &GSData.posrot);
-			PosRotVB.VertexBufferRHI = RHICmdList.CreateVertexBuffer(GSData.posrot.GetResourceDataSize(), BUF_Static | BUF_ShaderResource, CreateInfo);
-			PosRotVBSRV = RHICmdList.CreateShaderResourceView(PosRotVB.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
-		}
+	for (GSCull::FChunk Chunk : Chunks.Chunks) {
+		Chunk.Begin += NumChunkIndices;
+		CullingChunks.Add(Chunk);
+		SortBounds += FBox3f(Chunk.Center - Chunk.Extent, Chunk.Center + Chunk.Extent);
+	}
+	NumChunkIndices += Chunks.Indices.Num();
+}
 
-		// scale VB
-		{
-			FRHIResourceCreateInfo CreateInfo(TEXT("FscaleVB"), &GSData.scl);
-			SclVB.VertexBufferRHI = RHICmdList.CreateVertexBuffer(GSData.scl.GetResourceDataSize(), BUF_Static, CreateInfo);
-		}
+uint32 AGSActor::UpdateVisibleChunks(FRHICommandList& RHICmdList)
+{
+	const uint32 NumVisible = GSCull::CullChunks(CullingChunks, GSCull::FFrustum((FMatrix44f)WVPMat), VisibleChunks);
+	if (!NumVisible) {
+		return 0;
+	}
+
+	const uint32 VisibleBytes = VisibleChunks.Num() * sizeof(GSCull::FVisibleChunk);
+	if (!VisibleChunkBuffer || VisibleChunkBuffer->GetSize() < VisibleBytes) {
+		VisibleChunkSRV.SafeRelease();
+		RDGBuffers.Remove(VisibleChunkBuffer);
+		GSBufferPool::Release(VisibleChunkBuffer);
+		VisibleChunkBuffer = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, CullingChunks.Num() * sizeof(GSCull::FVisibleChunk), BUF_Static | BUF_ShaderResource, TEXT("GSVisibleChunks"));
+		VisibleChunkSRV = RHICmdList.CreateShaderResourceView(VisibleChunkBuffer, sizeof(GSCull::FVisibleChunk), PF_R32G32B32A32_UINT);
+	}
+	void* Dst = RHICmdList.LockBuffer(VisibleChunkBuffer, 0, VisibleBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Dst, VisibleChunks.GetData(), VisibleBytes);
+	RHICmdList.UnlockBuffer(VisibleChunkBuffer);
 
-		// SH0 - 4 VB
-		{ 
-			TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> sh0;
-			sh0.SetNumUninitialized(NumParticles * 3);
+	return NumVisible;
+}
 
-			for (UINT i = 0; i < NumParticles; ++i) {
-				sh0[i * 3 + 0] = GSData.r_sh0[i];
-				sh0[i * 3 + 1] = GSData.g_sh0[i];
-				sh0[i * 3 + 2] = GSData.b_sh0[i];
-			}
+FRDGBufferRef AGSActor::RegisterRDGBuffer(FRDGBuilder& GraphBuilder, FRHIBuffer* Buffer, const TCHAR* Name)
+{
+	TRefCountPtr<FRDGPooledBuffer>& Pooled = RDGBuffers.FindOrAdd(Buffer);
+	if (!Pooled) {
+		FRDGBufferDesc Desc = FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), Buffer->GetSize() / sizeof(uint32));
+		Desc.Usage = Buffer->GetUsage();
+		Pooled = new FRDGPooledBuffer(Buffer, Desc, Desc.NumElements, Name);
+	}
+	return GraphBuilder.RegisterExternalBuffer(Pooled, Name);
+}
 
-			FRHIResourceCreateInfo CreateInfo(TEXT("SH04VB"), &sh0);
-			SH04VB.VertexBufferRHI = RHICmdList.CreateVertexBuffer(sh0.GetResourceDataSize(), BUF_Static, CreateInfo);
+void AGSActor::AddSortPasses(FRDGBuilder& GraphBuilder, bool bAsyncCompute)
+{
+	check(IsInRenderingThread());
+	AGSActor* self = this;
+
+	const FMatrix44f WVP = (FMatrix44f)WVPMat;
+	const int32 KeyBits = GSSort::GetKeyBits();
+	// a full sort generates its keys into the pair the draws do not read, the radix sort flips once per pass from there
+	const int32 SortStartIndex = 1 - ResultBufferIndex;
+	const int32 SortResultIndex = SortStartIndex ^ (GSSort::GetNumRadixPasses(KeyBits) & 1);
+
+	RDG_EVENT_SCOPE(GraphBuilder, "GSSort");
+
+	if (CVarSortCpu.GetValueOnRenderThread() && NumParticles && CpuPositions.Num() == (int32)NumParticles) {
+		SortOnCpu(GraphBuilder, WVP, FMath::Min(KeyBits, GSSort::MaxCpuKeyBits));
+		return;
+	}
+
+	FRDGBufferRef PosRot = RegisterRDGBuffer(GraphBuilder, PosRotVB.VertexBufferRHI, TEXT("GSPosRot"));
+	FRDGBufferRef Keys[2];
+	FRDGBufferRef Indices[2];
+	for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex) {
+		Keys[BufferIndex] = RegisterRDGBuffer(GraphBuilder, SortedKeyBuffer.KeyBuffers[BufferIndex], TEXT("GSSortedKeys"));
+		Indices[BufferIndex] = RegisterRDGBuffer(GraphBuilder, SortedIndexBuffer.IndexBuffers[BufferIndex], TEXT("GSSortedIndices"));
+	}
+
+	auto AllocKeysPassParameters = [&GraphBuilder, PosRot, &Keys, &Indices](int32 Dst, FRDGBufferRef PrevIndices, FRDGBufferRef ChunkIndices, FRDGBufferRef VisibleChunkList)
+	{
+		FGSSortKeysPassParameters* Parameters = GraphBuilder.AllocParameters<FGSSortKeysPassParameters>();
+		Parameters->PosRot = GraphBuilder.CreateSRV(PosRot, PF_R32_FLOAT);
+		Parameters->ChunkIndices = ChunkIndices ? GraphBuilder.CreateSRV(ChunkIndices, PF_R32_UINT) : nullptr;
+		Parameters->VisibleChunks = VisibleChunkList ? GraphBuilder.CreateSRV(VisibleChunkList, PF_R32G32B32A32_UINT) : nullptr;
+		Parameters->PrevIndices = PrevIndices ? GraphBuilder.CreateSRV(PrevIndices, PF_R32_UINT) : nullptr;
+		Parameters->Keys = GraphBuilder.CreateUAV(Keys[Dst], PF_R32_UINT);
+		Parameters->Indices = GraphBuilder.CreateUAV(Indices[Dst], PF_R32_UINT);
+		return Parameters;
+	};
+
+	// the engine radix sort records on a graphics command list, it stays on the graphics queue. Once the key
+	// generation is done it ping-pongs through the drawn pair too, so it waits for the draws.
+	auto AddRadixSortPass = [&](uint32 Count, bool bKeyGenCount)
+	{
+		FGSRadixSortPassParameters* Parameters = GraphBuilder.AllocParameters<FGSRadixSortPassParameters>();
+		for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex) {
+			Parameters->Buffers.Emplace(Keys[BufferIndex], ERHIAccess::SRVCompute);
+			Parameters->Buffers.Emplace(Indices[BufferIndex], ERHIAccess::SRVCompute);
 		}
 
-		for (int i = 0; i < 3; ++i) {
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("RadixSort %u", Count)
+			, Parameters
+			, ERDGPassFlags::Compute | ERDGPassFlags::NeverCull | ERDGPassFlags::NeverParallel
+			, [self, Keys, Indices, Count, bKeyGenCount, KeyBits, SortStartIndex, SortResultIndex](FRHICommandList& RHICmdList)
 			{
-				FRHIResourceCreateInfo CreateInfo(TEXT("R_SH1_4VB"), &GSData.r_sh1_4[i]);
-				R_Sh1_4VB[i].VertexBufferRHI = RHICmdList.CreateVertexBuffer(GSData.r_sh1_4[i].GetResourceDataSize(), BUF_Static, CreateInfo);
-			}
+				// views of the buffers RDG registered, both access kinds of each buffer within the one pass
+				FShaderResourceViewRHIRef SRVs[4];
+				FUnorderedAccessViewRHIRef UAVs[4];
+				FGPUSortBuffers SortBuffers;
+				for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex)
+				{
+					SRVs[BufferIndex] = RHICmdList.CreateShaderResourceView(Keys[BufferIndex]->GetRHI(), sizeof(uint32), PF_R32_UINT);
+					UAVs[BufferIndex] = RHICmdList.CreateUnorderedAccessView(Keys[BufferIndex]->GetRHI(), PF_R32_UINT);
+					SRVs[2 + BufferIndex] = RHICmdList.CreateShaderResourceView(Indices[BufferIndex]->GetRHI(), sizeof(uint32), PF_R32_UINT);
+					UAVs[2 + BufferIndex] = RHICmdList.CreateUnorderedAccessView(Indices[BufferIndex]->GetRHI(), PF_R32_UINT);
+
+					SortBuffers.RemoteKeySRVs[BufferIndex] = SRVs[BufferIndex];
+					SortBuffers.RemoteKeyUAVs[BufferIndex] = UAVs[BufferIndex];
+					SortBuffers.RemoteValueSRVs[BufferIndex] = SRVs[2 + BufferIndex];
+					SortBuffers.RemoteValueUAVs[BufferIndex] = UAVs[2 + BufferIndex];
+				}
+
+				// the 32 bit key generation pass before this one reports its own count
+				const uint32 SortCount = bKeyGenCount ? self->SortKeyGenCount : Count;
+				if (SortCount) {
+					const int32 ResultIndex = SortGPUBuffers(RHICmdList, SortBuffers, SortStartIndex, GSSort::GetKeyMask(KeyBits), SortCount, ERHIFeatureLevel::Type::SM6);
+					checkf(ResultIndex == SortResultIndex, TEXT("SortGPUBuffers sorted into buffer %d, the draws read %d"), ResultIndex, SortResultIndex);
+				}
+				// the order and its count switch together, the draws recorded before this pass keep the previous pair
+				if (bKeyGenCount) {
+					self->SortedCount = SortCount;
+					self->ResultBufferIndex = SortResultIndex;
+				}
+			});
+	};
 
+	if (KeyBits >= 32) {
+		// FGaussSplatSortKeyGen keys every particle on a graphics command list and returns how many to sort. That
+		// count is only known when the pass runs : the radix sort after it takes it from there, the draws from the
+		// next frame on. Render adds these passes behind the draws, SortedCount and ResultBufferIndex are left as
+		// they are until the radix pass runs.
+		const uint32 Count = NumParticles;
+		FGSSortKeysPassParameters* Parameters = AllocKeysPassParameters(SortStartIndex, nullptr, nullptr, nullptr);
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("SortKeys32")
+			, Parameters
+			, ERDGPassFlags::Compute | ERDGPassFlags::NeverCull | ERDGPassFlags::NeverParallel
+			, [self, Parameters, WVP, Count](FRHICommandList& RHICmdList)
 			{
-				FRHIResourceCreateInfo CreateInfo(TEXT("G_SH1_4VB"), &GSData.g_sh1_4[i]);
-				G_Sh1_4VB[i].VertexBufferRHI = RHICmdList.CreateVertexBuffer(GSData.g_sh1_4[i].GetResourceDataSize(), BUF_Static, CreateInfo);
-			}
+				self->SortKeyGenCount = self->SortKeyGen.Execute_RenderThread( RHICmdList
+																			 , Count
+																			 , WVP
+																			 , Parameters->PosRot->GetRHI()
+																			 , Parameters->Keys->GetRHI()
+																			 , Parameters->Indices->GetRHI() );
+			});
+		AddRadixSortPass(Count, true);
 
+		ResortCount = 0;
+		return;
+	}
+
+	DepthKeyGen.InitResources(GraphBuilder.RHICmdList);
+	const ERDGPassFlags KeyPassFlags = (bAsyncCompute ? ERDGPassFlags::AsyncCompute : ERDGPassFlags::Compute) | ERDGPassFlags::NeverCull;
+
+	// reduced keys span the visible depth range only, the sort skips the radix passes above KeyBits
+	const bool bCulling = CullingChunks.Num() && CVarCullChunks.GetValueOnRenderThread();
+	const uint32 NumToSort = bCulling ? UpdateVisibleChunks(GraphBuilder.RHICmdList) : NumParticles;
+	const uint32 NumVisibleChunks = bCulling ? VisibleChunks.Num() : 0;
+	FRDGBufferRef ChunkIndices = nullptr;
+	FRDGBufferRef VisibleChunkList = nullptr;
+	if (bCulling && NumToSort) {
+		ChunkIndices = RegisterRDGBuffer(GraphBuilder, ChunkIndexBuffer, TEXT("GSChunkIndices"));
+		VisibleChunkList = RegisterRDGBuffer(GraphBuilder, VisibleChunkBuffer, TEXT("GSVisibleChunks"));
+	}
+
+	// the previous order holds the same splats and the depth axis has barely turned : fix it up into the other buffer
+	const int32 NumPasses = GSSort::GetIncrementalPasses();
+	const bool bSameSplats = ResortCount == NumToSort && ResortKeyBits == KeyBits && ResortChunks.Num() == NumVisibleChunks
+		&& (!bCulling || !FMemory::Memcmp(ResortChunks.GetData(), VisibleChunks.GetData(), VisibleChunks.Num() * sizeof(GSCull::FVisibleChunk)));
+	if (NumPasses && NumToSort && bSameSplats && GSSort::GetDepthAxisAngle(FullSortWVP, WVP) <= GSSort::GetIncrementalMaxAngle()) {
+		const int32 Src = ResultBufferIndex;
+		const int32 Dst = 1 - Src;
+		FGSSortKeysPassParameters* Parameters = AllocKeysPassParameters(Dst, Indices[Src], ChunkIndices, VisibleChunkList);
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Resort %u", NumToSort)
+			, Parameters
+			, KeyPassFlags
+			, [self, Parameters, WVP, NumToSort, NumVisibleChunks, KeyBits, NumPasses](FRHIComputeCommandList& RHICmdList)
 			{
-				FRHIResourceCreateInfo CreateInfo(TEXT("B_SH0VB"), &GSData.b_sh1_4[i]);
-				B_Sh1_4VB[i].VertexBufferRHI = RHICmdList.CreateVertexBuffer(GSData.b_sh1_4[i].GetResourceDataSize(), BUF_Static, CreateInfo);
-			}
+				self->DepthKeyGen.Resort_RenderThread(RHICmdList, NumToSort, WVP, Parameters->PosRot->GetRHI(),
+					Parameters->ChunkIndices ? Parameters->ChunkIndices->GetRHI() : nullptr, Parameters->VisibleChunks ? Parameters->VisibleChunks->GetRHI() : nullptr,
+					NumVisibleChunks, Parameters->PrevIndices->GetRHI(), KeyBits, NumPasses, Parameters->Keys->GetRHI(), Parameters->Indices->GetRHI());
+			});
+
+		SortedCount = NumToSort;
+		ResultBufferIndex = Dst;
+		++SortSchedule.Stats.NumIncremental;
+		return;
+	}
+
+	if (NumToSort) {
+		FGSSortKeysPassParameters* Parameters = AllocKeysPassParameters(SortStartIndex, nullptr, ChunkIndices, VisibleChunkList);
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("SortKeys %u", NumToSort)
+			, Parameters
+			, KeyPassFlags
+			, [self, Parameters, WVP, NumToSort, bCulling, NumVisibleChunks, KeyBits](FRHIComputeCommandList& RHICmdList)
+			{
+				if (bCulling) {
+					self->DepthKeyGen.Execute_RenderThread(RHICmdList, WVP, Parameters->PosRot->GetRHI(), Parameters->ChunkIndices->GetRHI(), Parameters->VisibleChunks->GetRHI(),
+						NumVisibleChunks, NumToSort, KeyBits, Parameters->Keys->GetRHI(), Parameters->Indices->GetRHI());
+				}
+				else {
+					self->DepthKeyGen.Execute_RenderThread(RHICmdList, NumToSort, WVP, Parameters->PosRot->GetRHI(),
+						KeyBits, Parameters->Keys->GetRHI(), Parameters->Indices->GetRHI());
+				}
+			});
+		AddRadixSortPass(NumToSort, false);
+	}
+
+	SortedCount = NumToSort;
+	ResultBufferIndex = SortResultIndex;
+	ResortCount = NumToSort;
+	ResortKeyBits = KeyBits;
+	FullSortWVP = WVP;
+	if (bCulling) {
+		ResortChunks = VisibleChunks;
+	}
+	else {
+		ResortChunks.Reset();
+	}
+}
+
+void AGSActor::SortOnCpu(FRDGBuilder& GraphBuilder, const FMatrix44f& WVP, int32 KeyBits)
+{
+	check(IsInRenderingThread());
+
+	GSSort::GenerateKeys(CpuPositions, WVP, KeyBits, CpuSortKeys, CpuSortIndices);
+	GSSort::RadixSort(CpuSortKeys, CpuSortIndices, KeyBits, CpuSortScratchKeys, CpuSortScratchIndices);
+
+	// an upload pass of the graph, which copies the indices and orders the write against the draws
+	FRDGBufferRef Indices = RegisterRDGBuffer(GraphBuilder, SortedIndexBuffer.IndexBuffers[0], TEXT("GSSortedIndices"));
+	GraphBuilder.QueueBufferUpload(Indices, CpuSortIndices.GetData(), NumParticles * sizeof(uint32));
+
+	// the GPU keys are stale, its next sort starts over
+	SortedCount = NumParticles;
+	ResultBufferIndex = 0;
+	ResortCount = 0;
+}
+
+void AGSActor::CaptureCpuPositions(const FResourceArrayInterface* PosRot, uint32 Num)
+{
+	if (PosRot && CVarSortCpu.GetValueOnRenderThread()) {
+		GSSort::AppendPositions(static_cast<const float*>(PosRot->GetResourceData()), Num, CpuPositions);
+	}
+}
+
+bool AGSActor::CreateVBFromStreams(FRHICommandListBase& RHICmdList, const PLY::FSplatStreams& Streams)
+{
+	NumParticles = Streams.NumParticles;
+	ParticleCapacity = NumParticles;
+	ShDegree = Streams.ShDegree;
+	bCovariance = Streams.bCovariance;
+
+	// before the upload, which discards the streams
+	CpuPositions.Reset();
+	CaptureCpuPositions(Streams.Streams[PLY::SplatStream_PosRot], NumParticles);
+
+	// bands above ShDegree are neither allocated nor bound, SH0 is already interleaved
+	for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+		if (!Streams.Streams[s]) {
+			continue;
 		}
+		const EBufferUsageFlags Usage = BUF_Static | BUF_ShaderResource;	// PosRot for the sort keys, all of them for the tile rasterizer
+		GetStreamVB(s).VertexBufferRHI = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, Streams.Streams[s], Usage, GSplatStreamVBNames[s]);
+	}
+	PosRotVBSRV = RHICmdList.CreateShaderResourceView(PosRotVB.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
+
+	return true;
+}
+
+bool AGSActor::CreatePackedBuffer(FRHICommandListBase& RHICmdList, const PLY::FSplatStreams& Streams, FResourceArrayInterface* Packed)
+{
+	NumParticles = Streams.NumParticles;
+	ParticleCapacity = NumParticles;
+	ShDegree = Streams.ShDegree;
+	bCovariance = Streams.bCovariance;
+
+	// sort key generation reads positions from PosRotVBSRV
+	{
+		FResourceArrayInterface* Data = Streams.Streams[PLY::SplatStream_PosRot];
+		CpuPositions.Reset();
+		CaptureCpuPositions(Data, NumParticles);
+		PosRotVB.VertexBufferRHI = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, Data, BUF_Static | BUF_ShaderResource, TEXT("FPositionRotationVB"));
+		PosRotVBSRV = RHICmdList.CreateShaderResourceView(PosRotVB.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
+	}
 
-		bResult = true;
+	{
+		FRHIResourceCreateInfo CreateInfo(TEXT("GSPackedSplats"), Packed);
+		PackedSplatBuffer = RHICmdList.CreateStructuredBuffer(sizeof(FVector4f), Packed->GetResourceDataSize(), BUF_Static | BUF_ShaderResource, CreateInfo);
+		PackedSplatSRV = RHICmdList.CreateShaderResourceView(PackedSplatBuffer);
 	}
 
-	return bResult;
+	bPackedUploaded = true;
+	return true;
+}
+
+bool AGSActor::CreateCompactBuffers(FRHICommandListBase& RHICmdList, GSCompressed::FGpuSplats& Compact)
+{
+	NumParticles = Compact.NumParticles;
+	ParticleCapacity = NumParticles;
+	ShDegree = Compact.ShDegree;
+	bCovariance = false;
+
+	// sort key generation reads positions from PosRotVBSRV
+	{
+		CpuPositions.Reset();
+		CaptureCpuPositions(&Compact.posrot, NumParticles);
+		PosRotVB.VertexBufferRHI = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, &Compact.posrot, BUF_Static | BUF_ShaderResource, TEXT("FPositionRotationVB"));
+		PosRotVBSRV = RHICmdList.CreateShaderResourceView(PosRotVB.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
+	}
+
+	{
+		FRHIResourceCreateInfo CreateInfo(TEXT("GSCompactChunks"), &Compact.Chunks);
+		CompactChunkBuffer = RHICmdList.CreateStructuredBuffer(sizeof(float), Compact.Chunks.GetResourceDataSize(), BUF_Static | BUF_ShaderResource, CreateInfo);
+		CompactChunkSRV = RHICmdList.CreateShaderResourceView(CompactChunkBuffer);
+	}
+
+	{
+		FRHIResourceCreateInfo CreateInfo(TEXT("GSCompactSplats"), &Compact.Splats);
+		CompactSplatBuffer = RHICmdList.CreateStructuredBuffer(sizeof(GSCompressed::FPackedSplat), Compact.Splats.GetResourceDataSize(), BUF_Static | BUF_ShaderResource, CreateInfo);
+		CompactSplatSRV = RHICmdList.CreateShaderResourceView(CompactSplatBuffer);
+	}
+
+	// degree 0 has no rest coefficients, one zero uint keeps the SRV valid
+	if (Compact.ShRest.Num() == 0) {
+		Compact.ShRest.Add(0);
+	}
+	{
+		FRHIResourceCreateInfo CreateInfo(TEXT("GSCompactShRest"), &Compact.ShRest);
+		CompactShRestBuffer = RHICmdList.CreateStructuredBuffer(sizeof(uint32), Compact.ShRest.GetResourceDataSize(), BUF_Static | BUF_ShaderResource, CreateInfo);
+		CompactShRestSRV = RHICmdList.CreateShaderResourceView(CompactShRestBuffer);
+	}
+
+	bCompactUploaded = true;
+	return true;
 }
 
 void AGSActor::ReadAnimDataFromPly_RenderThread(FRHICommandListBase& RHICmdList, int32 _frameNo)
@@ -872,6 +1629,14 @@ void AGSActor::ReadAnimDataFromPly_RenderThread(FRHICommandListBase& RHICmdList,
 			void* VertexBufferData = RHICmdList.LockBuffer(VertexBuffer.VertexBufferRHI, 0, _size, RLM_WriteOnly);
 			FMemory::Memcpy(VertexBufferData, collection.GetData(), _size);
 			RHICmdList.UnlockBuffer(VertexBuffer.VertexBufferRHI);
+
+			if (CpuPositions.Num()) {
+				CpuPositions.Reset();
+				GSSort::AppendPositions(reinterpret_cast<const float*>(collection.GetData()), NumParticles, CpuPositions);
+			}
+
+			// the chunk boxes were built for the loaded positions, sort everything from now on
+			CullingChunks.Reset();
 		}
 	
 	}
@@ -884,40 +1649,45 @@ void AGSActor::Render(FRDGBuilder& GraphBuilder, const FSceneView& inView, const
 	AGSActor* self = this;
 
 
-//	FMatrix wvpMat = GetActorTransform().ToMatrixWithScale() * inView.ViewMatrices.GetViewProjectionMatrix();
-//	AddPass(GraphBuilder
-//		, RDG_EVENT_NAME("RadixSort")
-//		, [self, wvpMat](FRHICommandList& RHICmdList)
-//		{
-//			self->SortedCount = self->SortKeyGen.Execute_RenderThread(RHICmdList
-//				, self->NumParticles
-//				, (FMatrix44f)wvpMat
-//				, self->PosVBSRV
-//				, self->SortedKeyBuffer.KeyBufferUAVs[0]
-//				, self->SortedIndexBuffer.IndexBufferUAVs[0]);
-//
-//			FGPUSortBuffers SortBuffers;
-//			for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex)
-//			{
-//				SortBuffers.RemoteKeySRVs[BufferIndex] = self->SortedKeyBuffer.KeyBufferSRVs[BufferIndex];
-//				SortBuffers.RemoteKeyUAVs[BufferIndex] = self->SortedKeyBuffer.KeyBufferUAVs[BufferIndex];
-//				SortBuffers.RemoteValueSRVs[BufferIndex] = self->SortedIndexBuffer.IndexBufferSRVs[BufferIndex];
-//				SortBuffers.RemoteValueUAVs[BufferIndex] = self->SortedIndexBuffer.IndexBufferUAVs[BufferIndex];
-//			}
-//
-//			self->ResultBufferIndex = SortGPUBuffers(RHICmdList, SortBuffers, 0, 0xFFFFFFFF, self->SortedCount, ERHIFeatureLevel::Type::SM6);
-//		});
-//
-
-
-	WVPMat = GetActorTransform().ToMatrixWithScale() * inView.ViewMatrices.GetViewProjectionMatrix();
-
-	if (NumParticles == 0 || SortedCount == 0)
+	// without the TAA jitter, which would otherwise re-sort a still view every frame
+	WVPMat = GetActorTransform().ToMatrixWithScale() * inView.ViewMatrices.GetViewMatrix() * inView.ViewMatrices.GetProjectionNoAAMatrix();
+	ViewOrigin = inView.ViewMatrices.GetViewOrigin();
+
+	// sort when SortSchedule says so : the view or the actor moved enough, or a load or page-in asked for it. On async
+	// compute the passes go behind the draw, which uses the order of the previous sort and overlaps with this one.
+	// 32 bit keys go behind the draw too : their count is only known once the passes run, the draws take it next frame.
+	const bool bSort = NumParticles != 0 && SortSchedule.Update((FMatrix44f)WVPMat, SortBounds);
+	const bool bAsyncSort = (CVarSortAsyncCompute.GetValueOnRenderThread() && GSupportsEfficientAsyncCompute) || GSSort::GetKeyBits() >= 32;
+	if (bSort && !bAsyncSort) {
+		AddSortPasses(GraphBuilder, false);
+	}
+
+	if (NumParticles == 0 || SortedCount == 0) {
+		if (bSort && bAsyncSort) {
+			AddSortPasses(GraphBuilder, true);
+		}
 		return;
+	}
 
 	RDG_EVENT_SCOPE(GraphBuilder, "GSActor");
 	RDG_GPU_STAT_SCOPE(GraphBuilder, GSActor);
 
+	if (RenderMode == EGSRenderMode::TileCompute && EnumHasAnyFlags(SceneTexture.Texture->Desc.Flags, TexCreate_UAV)) {
+		RenderTiles(GraphBuilder, inView, SceneTexture);
+		if (bSort && bAsyncSort) {
+			AddSortPasses(GraphBuilder, true);
+		}
+		return;
+	}
+
+	if (RenderMode == EGSRenderMode::QuadCompute || !RHISupportsGeometryShaders(inView.GetShaderPlatform())) {
+		RenderQuads(GraphBuilder, inView, SceneTexture);
+		if (bSort && bAsyncSort) {
+			AddSortPasses(GraphBuilder, true);
+		}
+		return;
+	}
+
 	const FViewInfo& ViewInfo = static_cast<const FViewInfo&>(inView);
 	const FSceneTextures& SceneTextures = ViewInfo.GetSceneTextures();
 
@@ -939,22 +1709,52 @@ void AGSActor::Render(FRDGBuilder& GraphBuilder, const FSceneView& inView, const
 
 	FTrianglePS::FParameters* PSParams = GraphBuilder.AllocParameters<FTrianglePS::FParameters>();
 	PSParams->RenderTargets[0] = FRenderTargetBinding(SceneTexture.Texture, ERenderTargetLoadAction::ELoad);
+	PSParams->SortedIndices = RegisterRDGBuffer(GraphBuilder, SortedIndexBuffer.IndexBuffers[ResultBufferIndex], TEXT("GSSortedIndices"));
+	PSParams->PosRot = RegisterRDGBuffer(GraphBuilder, PosRotVB.VertexBufferRHI, TEXT("GSPosRot"));
 //	PSParams->RenderTargets[0] = FRenderTargetBinding(SceneTextures.GBufferC, ERenderTargetLoadAction::ELoad);
 //	PSParams->RenderTargets.DepthStencil = FDepthStencilBinding(SceneTextures.Depth.Target, ERenderTargetLoadAction::ELoad, FExclusiveDepthStencil::DepthRead_StencilNop);
 
 
 	const FGlobalShaderMap* ViewShaderMap = static_cast<const FViewInfo&>(inView).ShaderMap;
-	TShaderMapRef<FTriangleVS> VertexShader(ViewShaderMap);
+	FTriangleVS::FPermutationDomain VSPermutation;
+	VSPermutation.Set<FTriangleVS::FSHDegreeDim>(ShDegree);
+	VSPermutation.Set<FTriangleVS::FCovarianceDim>(bCovariance);
+	TShaderMapRef<FTriangleVS> VertexShader(ViewShaderMap, VSPermutation);
+	TShaderMapRef<FTrianglePackedVS> PackedVertexShader(ViewShaderMap, VSPermutation);
+	TShaderMapRef<FTriangleCompactVS> CompactVertexShader(ViewShaderMap, VSPermutation);
+
+	FTrianglePackedVS::FParameters* PackedVSParams = nullptr;
+	if (bPackedUploaded) {
+		PackedVSParams = GraphBuilder.AllocParameters<FTrianglePackedVS::FParameters>();
+		PackedVSParams->Common = *VSParams;
+		PackedVSParams->gSplats = PackedSplatSRV;
+		PackedVSParams->gSplatStride4 = GSPacked::GetRecordStride(ShDegree) / sizeof(FVector4f);
+	}
+
+	FTriangleCompactVS::FParameters* CompactVSParams = nullptr;
+	if (bCompactUploaded) {
+		CompactVSParams = GraphBuilder.AllocParameters<FTriangleCompactVS::FParameters>();
+		CompactVSParams->Common = *VSParams;
+		CompactVSParams->gChunks = CompactChunkSRV;
+		CompactVSParams->gSplats = CompactSplatSRV;
+		CompactVSParams->gShRest = CompactShRestSRV;
+		CompactVSParams->gChunkSize = GSCompressed::ChunkSize;
+		CompactVSParams->gChunkStride = GSCompressed::ChunkStride;
+		CompactVSParams->gShRestStride = GSCompressed::GetShRestStride(ShDegree);
+	}
 	TShaderMapRef<FTrianglePS> PixelShader(ViewShaderMap);
 	TShaderMapRef<FTriangleGS> GeometryShader(ViewShaderMap);
 
-	ERDGPassFlags::Readback;
+	// the newest order recorded so far, the async sort below only writes the other buffer or waits for this draw
+	const int32 DrawBufferIndex = ResultBufferIndex;
+	const UINT DrawCount = SortedCount;
 
+	RDG_GPU_STAT_SCOPE(GraphBuilder, GSGeometryDraw);
 	GraphBuilder.AddPass(
 		RDG_EVENT_NAME("Gaussian Splatting")
 		, PSParams
 		, ERDGPassFlags::Raster
-		, [self, ViewRect, VertexShader, GeometryShader, PixelShader, VSParams, GSParams, PSParams](FRHICommandList& RHICmdList)
+		, [self, ViewRect, VertexShader, PackedVertexShader, CompactVertexShader, GeometryShader, PixelShader, VSParams, PackedVSParams, CompactVSParams, GSParams, PSParams, DrawBufferIndex, DrawCount](FRHICommandList& RHICmdList)
 		{
 			RHICmdList.SetViewport((float)ViewRect.Min.X, (float)ViewRect.Min.Y, 0.0f, (float)ViewRect.Max.X, (float)ViewRect.Max.Y, 1.0f);
 
@@ -971,8 +1771,18 @@ void AGSActor::Render(FRDGBuilder& GraphBuilder, const FSceneView& inView, const
 			GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
 		//	GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_DepthNearOrEqual>::GetRHI();
 		
-			GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GTriangleVertexDeclaration.VertexDeclarationRHI;
-			GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+			if (CompactVSParams) {
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = CompactVertexShader.GetVertexShader();
+			}
+			else if (PackedVSParams) {
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = PackedVertexShader.GetVertexShader();
+			}
+			else {
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GTriangleVertexDeclaration.VertexDeclarationRHI[self->ShDegree];
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+			}
 			GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
 			GraphicsPSOInit.BoundShaderState.SetGeometryShader(GeometryShader.GetGeometryShader());
 
@@ -980,27 +1790,166 @@ void AGSActor::Render(FRDGBuilder& GraphBuilder, const FSceneView& inView, const
 	
 			SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
 			SetShaderParameters(RHICmdList, PixelShader, PixelShader.GetPixelShader(), *PSParams);
-			SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), *VSParams);
 			SetShaderParameters(RHICmdList, GeometryShader, GeometryShader.GetGeometryShader(), *GSParams);
 
-			RHICmdList.SetStreamSource(0, self->PosRotVB.VertexBufferRHI, 0);	// pos rot
-			RHICmdList.SetStreamSource(2, self->SclVB.VertexBufferRHI, 0);		// scale
-			RHICmdList.SetStreamSource(3, self->SH04VB.VertexBufferRHI, 0);		// sh0-4
+			if (CompactVSParams) {
+				// quantized splat and its chunk ranges, fetched through the sorted index
+				SetShaderParameters(RHICmdList, CompactVertexShader, CompactVertexShader.GetVertexShader(), *CompactVSParams);
+			}
+			else if (PackedVSParams) {
+				// one record per splat, fetched through the sorted index
+				SetShaderParameters(RHICmdList, PackedVertexShader, PackedVertexShader.GetVertexShader(), *PackedVSParams);
+			}
+			else {
+				SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), *VSParams);
+
+				RHICmdList.SetStreamSource(0, self->PosRotVB.VertexBufferRHI, 0);	// pos rot
+				RHICmdList.SetStreamSource(2, self->SclVB.VertexBufferRHI, 0);		// scale
+				RHICmdList.SetStreamSource(3, self->SH04VB.VertexBufferRHI, 0);		// sh0-4
 
-			for (int i = 0; i < 3; ++i) {
-				RHICmdList.SetStreamSource(6+i*3+0, self->R_Sh1_4VB[i].VertexBufferRHI, 0);
-				RHICmdList.SetStreamSource(6+i*3+1, self->G_Sh1_4VB[i].VertexBufferRHI, 0);
-				RHICmdList.SetStreamSource(6+i*3+2, self->B_Sh1_4VB[i].VertexBufferRHI, 0);
+				for (int i = 0; i < PLY::GetNumShBandStreams(self->ShDegree); ++i) {
+					RHICmdList.SetStreamSource(6+i*3+0, self->R_Sh1_4VB[i].VertexBufferRHI, 0);
+					RHICmdList.SetStreamSource(6+i*3+1, self->G_Sh1_4VB[i].VertexBufferRHI, 0);
+					RHICmdList.SetStreamSource(6+i*3+2, self->B_Sh1_4VB[i].VertexBufferRHI, 0);
+				}
 			}
 
 			RHICmdList.DrawIndexedPrimitive(
-				self->SortedIndexBuffer.IndexBuffers[self->ResultBufferIndex],
+				self->SortedIndexBuffer.IndexBuffers[DrawBufferIndex],
 				/*BaseVertexIndex=*/ 0,
 				/*MinIndex=*/ 0,
 				/*NumVertices=*/ self->NumParticles,
 				/*StartIndex=*/ 0,
-				/*NumPrimitives=*/ self->SortedCount,
+				/*NumPrimitives=*/ DrawCount,
 				/*NumInstances=*/ 1);
 		});
 
+	if (bSort && bAsyncSort) {
+		AddSortPasses(GraphBuilder, true);
+	}
+
+}
+
+void AGSActor::RenderTiles(FRDGBuilder& GraphBuilder, const FSceneView& inView, const FScreenPassTexture& SceneTexture)
+{
+	check(IsInRenderingThread());
+	AGSActor* self = this;
+
+	RDG_GPU_STAT_SCOPE(GraphBuilder, GSTileRaster);
+
+	const GSTile::FView View = GetTileView(inView, SceneTexture.ViewRect);
+
+	// as the point list draw : the newest order recorded so far
+	const int32 DrawBufferIndex = ResultBufferIndex;
+	const UINT DrawCount = SortedCount;
+	const uint32 NumEntries = TileRasterizer.Prepare_RenderThread(GraphBuilder.RHICmdList, DrawCount, View.ViewRect);
+	if (!NumEntries) {
+		return;
+	}
+
+	const GSTile::FSplatSource Source = GetTileSplatSource(GraphBuilder.RHICmdList);
+
+	FGSTilePassParameters* Parameters = GraphBuilder.AllocParameters<FGSTilePassParameters>();
+	Parameters->Buffers.Emplace(RegisterRDGBuffer(GraphBuilder, SortedIndexBuffer.IndexBuffers[ResultBufferIndex], TEXT("GSSortedIndices")), ERHIAccess::SRVCompute);
+	Parameters->Buffers.Emplace(RegisterRDGBuffer(GraphBuilder, PosRotVB.VertexBufferRHI, TEXT("GSPosRot")), ERHIAccess::SRVCompute);
+	Parameters->SceneColor = SceneTexture.Texture;
+
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("Gaussian Splatting Tiles %u", DrawCount)
+		, Parameters
+		, ERDGPassFlags::Compute | ERDGPassFlags::NeverCull
+		, [self, Source, View, Parameters, DrawBufferIndex, DrawCount, NumEntries](FRHICommandList& RHICmdList)
+		{
+			self->TileRasterizer.Execute_RenderThread(RHICmdList, Source, View,
+				self->SortedIndexBuffer.IndexBufferSRVs[DrawBufferIndex], DrawCount, NumEntries, Parameters->SceneColor->GetRHI());
+		});
 }
+
+void AGSActor::RenderQuads(FRDGBuilder& GraphBuilder, const FSceneView& inView, const FScreenPassTexture& SceneTexture)
+{
+	check(IsInRenderingThread());
+
+	RDG_GPU_STAT_SCOPE(GraphBuilder, GSQuadDraw);
+
+	// as the point list draw : the newest order recorded so far
+	const int32 DrawBufferIndex = ResultBufferIndex;
+	const UINT DrawCount = SortedCount;
+
+	GSQuad::AddPasses(GraphBuilder, GetTileSplatSource(GraphBuilder.RHICmdList), GetTileView(inView, SceneTexture.ViewRect),
+		RegisterRDGBuffer(GraphBuilder, SortedIndexBuffer.IndexBuffers[DrawBufferIndex], TEXT("GSSortedIndices")),
+		RegisterRDGBuffer(GraphBuilder, PosRotVB.VertexBufferRHI, TEXT("GSPosRot")),
+		SortedIndexBuffer.IndexBufferSRVs[DrawBufferIndex], DrawCount, SceneTexture.Texture);
+}
+
+GSTile::FView AGSActor::GetTileView(const FSceneView& inView, const FIntRect& ViewRect) const
+{
+	// the matrices of the VS, the projection without TAA jitter as the sort uses
+	GSTile::FView View;
+	View.Local2World = (FMatrix44f)GetActorTransform().ToMatrixWithScale();
+	View.TranslatedWorld2View = (FMatrix44f)inView.ViewMatrices.GetTranslatedViewMatrix();
+	View.View2Clip = (FMatrix44f)inView.ViewMatrices.GetProjectionNoAAMatrix();
+	View.PreViewTranslation = (FVector3f)inView.ViewMatrices.GetPreViewTranslation();
+	View.ViewRect = ViewRect;
+	return View;
+}
+
+GSTile::FSplatSource AGSActor::GetTileSplatSource(FRHICommandListBase& RHICmdList)
+{
+	GSTile::FSplatSource Source;
+	Source.ShDegree = ShDegree;
+	Source.bCovariance = bCovariance;
+	Source.Streams[PLY::SplatStream_PosRot] = PosRotVBSRV;
+
+	if (bCompactUploaded) {
+		Source.Layout = GSTile::ESplatLayout::Compact;
+		Source.CompactChunks = CompactChunkSRV;
+		Source.CompactSplats = CompactSplatSRV;
+		Source.CompactShRest = CompactShRestSRV;
+	}
+	else if (bPackedUploaded) {
+		Source.Layout = GSTile::ESplatLayout::Packed;
+		Source.PackedSplats = PackedSplatSRV;
+		Source.PackedStride4 = GSPacked::GetRecordStride(ShDegree) / sizeof(FVector4f);
+	}
+	else {
+		for (int32 s = PLY::SplatStream_PosRot + 1; s < PLY::SplatStream_Count; ++s) {
+			if (!PLY::IsStreamUsed(s, ShDegree)) {
+				continue;
+			}
+			if (!StreamSRVs[s]) {
+				StreamSRVs[s] = RHICmdList.CreateShaderResourceView(GetStreamVB(s).VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
+			}
+			Source.Streams[s] = StreamSRVs[s];
+		}
+	}
+	return Source;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  GS.Sort.Stats [reset]
+*/
+static FAutoConsoleCommand GSSortStatsCommand(
+	TEXT("GS.Sort.Stats"),
+	TEXT("GS.Sort.Stats [reset] : sorts per actor, how many were incremental, and the view changes skipped under the thresholds or deferred by the budget."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const bool bReset = Args.Num() > 0 && Args[0].Equals(TEXT("reset"), ESearchCase::IgnoreCase);
+
+			// the counters belong to the render thread
+			FlushRenderingCommands();
+
+			for (TObjectIterator<AGSActor> It; It; ++It) {
+				if (It->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject)) {
+					continue;
+				}
+
+				GSSort::FSortStats& Stats = It->GetSortStats_RenderThread();
+				UE_LOG(LogGSActor, Display, TEXT("%s : %u sorts (%u incremental), %u view changes skipped, %u sorts deferred"),
+					*It->GetName(), Stats.NumSorts, Stats.NumIncremental, Stats.NumSkipped, Stats.NumDeferred);
+				if (bReset) {
+					Stats = GSSort::FSortStats();
+				}
+			}
+		}));
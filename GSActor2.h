@@ -6,12 +6,40 @@
 #include "GameFramework/Actor.h"
 #include "ScreenPass.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "RenderCommandFence.h"
 #include "Sort/GaussSplatSortKeyGen.h"
+#include "GSSortKeys.h"
+#include "GSSortScheduler.h"
+#include "GSSplatCulling.h"
+#include "GSTileRaster.h"
 #include "GSparticles.h"
+#include <atomic>
 #include "GSActor.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogGSActor, Log, All);
 
+namespace PLY { struct FSplatStreams; struct FGaussSplatVertex; class FPagedPlyFile; }
+namespace GSCompressed { struct FGpuSplats; }
+
+UENUM(BlueprintType)
+enum class EGSLoadState : uint8
+{
+	Unloaded,
+	Loading,	// decoding on a worker, previous splats (if any) are still drawn
+	Loaded,
+	Failed,
+};
+
+UENUM(BlueprintType)
+enum class EGSRenderMode : uint8
+{
+	Geometry,		// a point per splat expanded by the geometry shader, blended back to front by the ROPs
+	TileCompute,	// binned into screen tiles and blended front to back in compute, see GSTileRaster.h
+	QuadCompute,	// projected in compute, drawn as instanced quads without geometry shader, see GSQuadDraw.h
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FGSOnSplatsLoaded, bool, bSuccess);
+
 
 class FGaussSplatIndexBuffer : public FIndexBuffer
 {
@@ -63,7 +91,10 @@ class GSRUNTIME_API AGSActor : public AActor
 public:	
 	// Sets default values for this actor's properties
 	AGSActor();
-	virtual ~AGSActor();
+
+	// the buffers belong to the render thread, they are released there before the actor goes away
+	virtual void BeginDestroy() override;
+	virtual bool IsReadyForFinishDestroy() override;
 
 	virtual bool ShouldTickIfViewportsOnly() const override;
 protected:
@@ -101,9 +132,66 @@ public:
 		return (int)(fCurrentSecond * FRAME_RATE);
 	}
 
+	// Decodes PlyFileName on a worker thread, then swaps the GPU buffers on the render thread.
+	UFUNCTION(BlueprintCallable, Category = "3DGS")
+	void LoadSplatsAsync();
+
+	UFUNCTION(BlueprintCallable, Category = "3DGS")
+	EGSLoadState GetLoadState() const
+	{
+		return LoadState;
+	}
+
+	// render thread data, see GS.Sort.Stats
+	GSSort::FSortStats& GetSortStats_RenderThread()
+	{
+		return SortSchedule.Stats;
+	}
+
 private:
+	// render thread, every buffer and the state that refers to them
 	void ReleaseBuffers();
-	bool CreateVBFromPlyFile(FRHICommandListBase& RHICmdList, const FString& Filename);
+	bool CreateVBFromStreams(FRHICommandListBase& RHICmdList, const PLY::FSplatStreams& Streams);
+	bool CreatePackedBuffer(FRHICommandListBase& RHICmdList, const PLY::FSplatStreams& Streams, FResourceArrayInterface* Packed);
+	bool CreateCompactBuffers(FRHICommandListBase& RHICmdList, GSCompressed::FGpuSplats& Compact);
+
+	// progressive loading : empty VBs for NumTotal particles, then chunks appended at NumParticles
+	// bSliced : PLY::LoadPlyFileSliced instead, bounded staging memory for files too large to decode at once
+	void LoadSplatsProgressive(uint32 Generation, bool bSliced);
+	void AllocateVBs(FRHICommandListBase& RHICmdList, UINT Capacity, int32 InShDegree, bool bInCovariance);
+	void AppendStreams(FRHICommandListBase& RHICmdList, const PLY::FSplatStreams& Chunk);
+	void GrowSortBuffers(FRHICommandListBase& RHICmdList, UINT NumRequired);
+	FVertexBuffer& GetStreamVB(int32 Stream);
+
+	// chunk culling : chunks built on the loading thread, their splat indices appended at NumChunkIndices
+	void AppendCullingChunks(FRHICommandListBase& RHICmdList, const GSCull::FSplatChunks& Chunks);
+	uint32 UpdateVisibleChunks(FRHICommandList& RHICmdList);
+
+	// sort passes for WVPMat, ahead of the draw or on async compute behind it : incremental re-sort of the previous
+	// order when possible, full sort otherwise. Key generation and re-sorts write the pair the draws do not read and
+	// can overlap them, the radix sort of a full sort stays on the graphics queue.
+	void AddSortPasses(FRDGBuilder& GraphBuilder, bool bAsyncCompute);
+	FRDGBufferRef RegisterRDGBuffer(FRDGBuilder& GraphBuilder, FRHIBuffer* Buffer, const TCHAR* Name);
+
+	// r.GS.Sort.CPU : the order of CpuPositions for WVP into the first sort buffer, uploaded by the graph. Positions
+	// are appended from the PosRot streams before they are uploaded.
+	void SortOnCpu(FRDGBuilder& GraphBuilder, const FMatrix44f& WVP, int32 KeyBits);
+	void CaptureCpuPositions(const FResourceArrayInterface* PosRot, uint32 Num);
+
+	// EGSRenderMode::TileCompute : the sorted splats through TileRasterizer, in place of the point list draw
+	void RenderTiles(FRDGBuilder& GraphBuilder, const FSceneView& inView, const FScreenPassTexture& SceneTexture);
+	GSTile::FSplatSource GetTileSplatSource(FRHICommandListBase& RHICmdList);
+	GSTile::FView GetTileView(const FSceneView& inView, const FIntRect& ViewRect) const;
+
+	// EGSRenderMode::QuadCompute, and Geometry on platforms without geometry shaders : the sorted splats through
+	// GSQuad, in place of the point list draw
+	void RenderQuads(FRDGBuilder& GraphBuilder, const FSceneView& inView, const FScreenPassTexture& SceneTexture);
+
+	// out-of-core paging : resident pages fill pool slots [0, NumParticles / PoolPageSize) in any order
+	void LoadSplatsPaged(uint32 Generation);
+	void UpdatePaging();
+	void OnPageDecoded(int32 Page, const TSharedRef<PLY::FGaussSplatVertex, ESPMode::ThreadSafe>& Chunk);
+	void EvictPoolSlot(FRHICommandList& RHICmdList, int32 Slot);
 
 
 	void ReadAnimDataFromPly_RenderThread(FRHICommandListBase& RHICmdList, int32 _frameNo);
@@ -112,6 +200,42 @@ public:
 	UPROPERTY(EditAnywhere, Category = "3DGS")
 	FString PlyFileName;
 
+	// Stream the splats in, most important first, instead of waiting for the whole file. See r.GS.ProgressiveChunkSize.
+	UPROPERTY(EditAnywhere, Category = "3DGS")
+	bool bProgressiveLoad = false;
+
+	// Keep only the pages nearest to the camera resident, within PagingBudgetMB. For captures that do not fit in VRAM.
+	UPROPERTY(EditAnywhere, Category = "3DGS|Paging")
+	bool bEnablePaging = false;
+
+	// GPU memory of the page pool, vertex streams and sort buffers
+	UPROPERTY(EditAnywhere, Category = "3DGS|Paging", meta = (EditCondition = "bEnablePaging", ClampMin = "16"))
+	int32 PagingBudgetMB = 1024;
+
+	// Draw from one packed, cache line aligned record per splat (GSPacked) instead of 13 vertex streams.
+	// Applies to whole-file loads, progressive and paged loads keep the streams.
+	UPROPERTY(EditAnywhere, Category = "3DGS")
+	bool bPackedLayout = false;
+
+	// Keep the splats quantized in VRAM (GSCompressed chunks, dequantized by the VS), about 2.5x less memory than
+	// the float streams. Applies to whole-file loads, takes precedence over bPackedLayout and bPrecomputedCovariance.
+	UPROPERTY(EditAnywhere, Category = "3DGS")
+	bool bCompactLayout = false;
+
+	// Compute the 3D covariance of every splat once at load time and upload it in place of rotation and scale,
+	// instead of rebuilding it in the VS every frame.
+	UPROPERTY(EditAnywhere, Category = "3DGS")
+	bool bPrecomputedCovariance = false;
+
+	// How the splats are drawn. TileCompute needs a scene color with UAV access and falls back to Geometry without.
+	// Geometry falls back to QuadCompute on platforms without geometry shaders.
+	UPROPERTY(EditAnywhere, Category = "3DGS")
+	EGSRenderMode RenderMode = EGSRenderMode::Geometry;
+
+	// Highest spherical harmonics band decoded, uploaded and evaluated. 0 keeps the base color only.
+	UPROPERTY(EditAnywhere, Category = "3DGS", meta = (ClampMin = "0", ClampMax = "3", DisplayName = "Max SH Degree"))
+	int32 MaxSHDegree = 3;
+
 	UPROPERTY(EditAnywhere, Category = "3DGS|Animation")
 	bool bPlayAnimation = false;
 
@@ -127,13 +251,19 @@ public:
 	UPROPERTY(EditAnywhere, Category = "3DGS", meta = (DisplayName = "GS List"))
 	TArray<FGaussSplatInfo> GSInfos;
 
+	// broadcast on the game thread once an async load has been uploaded, or has failed
+	UPROPERTY(BlueprintAssignable, Category = "3DGS")
+	FGSOnSplatsLoaded OnSplatsLoaded;
+
 
 private:
 	FMatrix WVPMat;
-	FMatrix PreWVPMat;
 	
 	UINT NumParticles = 0;
+	UINT ParticleCapacity = 0;		// VB size in particles, above NumParticles while a progressive load is running
 	UINT SortedCount = 0;
+	int32 ShDegree = 3;		// of the uploaded streams, selects the bound VBs and the VS permutation
+	bool bCovariance = false;	// uploaded streams hold PLY::ConvertToCovariance output, selects the VS permutation
 
 	FVertexBuffer PosRotVB;
 	FVertexBuffer SclVB;
@@ -145,11 +275,27 @@ private:
 
 	FShaderResourceViewRHIRef PosRotVBSRV;
 
+	// bPackedLayout : records for the VS, PosRotVB stays for sort key generation
+	FBufferRHIRef PackedSplatBuffer;
+	FShaderResourceViewRHIRef PackedSplatSRV;
+	bool bPackedUploaded = false;
+
+	// bCompactLayout : GSCompressed::FGpuSplats for the VS, PosRotVB stays for sort key generation
+	FBufferRHIRef CompactChunkBuffer;
+	FShaderResourceViewRHIRef CompactChunkSRV;
+	FBufferRHIRef CompactSplatBuffer;
+	FShaderResourceViewRHIRef CompactSplatSRV;
+	FBufferRHIRef CompactShRestBuffer;
+	FShaderResourceViewRHIRef CompactShRestSRV;
+	bool bCompactUploaded = false;
+
 	FGSSortedIndexBuffer SortedIndexBuffer;
 	FGSSortedKeyBuffer SortedKeyBuffer;
 	
 	FGaussSplatSortKeyGen SortKeyGen;
+	GSSort::FDepthKeyGen DepthKeyGen;		// r.GS.Sort.KeyBits below 32
 	int32 ResultBufferIndex = 0;
+	uint32 SortKeyGenCount = 0;		// returned by the last FGaussSplatSortKeyGen pass, for the radix sort pass after it
 
 	const int32 FRAME_RATE = 30;
 	double fCurrentSecond = 0.;
@@ -157,4 +303,58 @@ private:
 	
 	int PreFrame = 0;
 	double fPlaySecond = 0.03333333f * 300;
+
+	std::atomic<EGSLoadState> LoadState = EGSLoadState::Unloaded;
+	uint32 LoadGeneration = 0;	// game thread only, drops results of superseded loads
+	TSharedPtr<std::atomic<bool>, ESPMode::ThreadSafe> LoadCanceled;	// stops the decode of a superseded load
+	FRenderCommandFence ReleaseFence;	// behind the render commands holding the actor, see BeginDestroy
+
+	// paging, game thread
+	TSharedPtr<PLY::FPagedPlyFile, ESPMode::ThreadSafe> PagedFile;
+	TArray<int32> ResidentPages;	// page in each pool slot, mirrors the render thread
+	TArray<int32> PagesInFlight;
+	TArray<float> PageDistances;
+	int32 NumPoolSlots = 0;
+	FVector ViewOrigin = FVector::ZeroVector;	// written by Render
+
+	// paging, render thread
+	UINT PoolPageSize = 0;
+	FBufferRHIRef PoolScratchVB;
+
+	// chunk culling, render thread. Empty when paging, or once animation frames have moved the splats.
+	TArray<GSCull::FChunk> CullingChunks;
+	TArray<GSCull::FVisibleChunk> VisibleChunks;
+	uint32 NumChunkIndices = 0;
+	FBufferRHIRef ChunkIndexBuffer;
+	FShaderResourceViewRHIRef ChunkIndexSRV;
+	FBufferRHIRef VisibleChunkBuffer;
+	FShaderResourceViewRHIRef VisibleChunkSRV;
+
+	// when to sort, render thread. SortBounds : local splat bounds, from the culling chunks or the pages
+	GSSort::FSortSchedule SortSchedule;
+	FBox3f SortBounds = FBox3f(ForceInit);
+
+	// incremental re-sort, render thread. The order of the last sort is re-sorted while the same splats are sorted
+	// and the view stays within r.GS.Sort.Incremental.MaxAngle of FullSortWVP.
+	uint32 ResortCount = 0;		// entries of that order, 0 when there is none to start from
+	int32 ResortKeyBits = 0;
+	FMatrix44f FullSortWVP;
+	TArray<GSCull::FVisibleChunk> ResortChunks;	// visible chunks of that order, empty without culling
+
+	// CPU sort, render thread. CpuPositions mirrors [0, NumParticles) of PosRotVB, empty unless r.GS.Sort.CPU was
+	// set at load time.
+	TArray<FVector3f> CpuPositions;
+	TArray<uint32> CpuSortKeys;
+	TArray<uint32> CpuSortIndices;
+	TArray<uint32> CpuSortScratchKeys;
+	TArray<uint32> CpuSortScratchIndices;
+
+	// tile rasterizer, render thread. StreamSRVs : views of the vertex streams, made on its first use.
+	GSTile::FTileRasterizer TileRasterizer;
+	FShaderResourceViewRHIRef StreamSRVs[PLY::SplatStream_Count];
+
+	// RDG wrappers of the buffers the sort and the draw share, render thread. RDG tracks their state through these
+	// and fences the async sort against the draw. Dropped whenever the wrapped buffer goes back to GSBufferPool, or
+	// is transitioned outside a graph (EvictPoolSlot).
+	TMap<FRHIBuffer*, TRefCountPtr<FRDGPooledBuffer>> RDGBuffers;
 };
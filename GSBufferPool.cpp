@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSBufferPool.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "Stats/Stats.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogGSBufferPool, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("GSBufferPool"), STATGROUP_GSBufferPool, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Buffers in use"), STAT_GSBufferPoolNumInUse, STATGROUP_GSBufferPool);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Idle buffers"), STAT_GSBufferPoolNumFree, STATGROUP_GSBufferPool);
+DECLARE_MEMORY_STAT(TEXT("In use"), STAT_GSBufferPoolInUseBytes, STATGROUP_GSBufferPool);
+DECLARE_MEMORY_STAT(TEXT("Idle"), STAT_GSBufferPoolFreeBytes, STATGROUP_GSBufferPool);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Reuse rate"), STAT_GSBufferPoolReuseRate, STATGROUP_GSBufferPool);
+
+static TAutoConsoleVariable<int32> CVarBufferPoolMaxFreeMB(
+	TEXT("r.GS.BufferPool.MaxFreeMB"),
+	512,
+	TEXT("Idle splat and sort buffers kept for reuse, in MB. 0 frees buffers as soon as they are released."),
+	ECVF_Default);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	using namespace GSBufferPool;
+
+	constexpr uint32 MinBucketSize = 64 * 1024;
+
+	struct FKey
+	{
+		EKind Kind;
+		EBufferUsageFlags Usage;
+		uint32 Size;
+
+		bool operator==(const FKey& Other) const
+		{
+			return Kind == Other.Kind && Usage == Other.Usage && Size == Other.Size;
+		}
+		friend uint32 GetTypeHash(const FKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash((uint8)Key.Kind), GetTypeHash((uint32)Key.Usage)), GetTypeHash(Key.Size));
+		}
+	};
+
+	struct FFreeBuffer
+	{
+		FKey Key;
+		FBufferRHIRef Buffer;
+	};
+
+	FCriticalSection PoolLock;
+	TArray<FFreeBuffer> FreeBuffers;		// least recently released first
+	TMap<FRHIBuffer*, FKey> InUse;
+	uint64 FreeBytes = 0;
+	uint64 InUseBytes = 0;
+	uint64 NumAcquired = 0;
+	uint64 NumReused = 0;
+
+	// PoolLock held
+	void UpdateStats()
+	{
+		SET_DWORD_STAT(STAT_GSBufferPoolNumInUse, InUse.Num());
+		SET_DWORD_STAT(STAT_GSBufferPoolNumFree, FreeBuffers.Num());
+		SET_MEMORY_STAT(STAT_GSBufferPoolInUseBytes, InUseBytes);
+		SET_MEMORY_STAT(STAT_GSBufferPoolFreeBytes, FreeBytes);
+		SET_FLOAT_STAT(STAT_GSBufferPoolReuseRate, NumAcquired ? (float)NumReused / NumAcquired : 0.f);
+	}
+
+	// PoolLock held
+	void EvictDownTo(uint64 MaxFreeBytes)
+	{
+		int32 NumEvicted = 0;
+		while (NumEvicted < FreeBuffers.Num() && FreeBytes > MaxFreeBytes) {
+			FreeBytes -= FreeBuffers[NumEvicted++].Key.Size;
+		}
+		FreeBuffers.RemoveAt(0, NumEvicted, false);
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSBufferPool
+{
+	uint32 GetBucketSize(uint32 Size)
+	{
+		if (Size <= MinBucketSize) {
+			return MinBucketSize;
+		}
+
+		// quarter steps of the power of two below
+		const uint64 Step = (1ull << FMath::FloorLog2(Size)) / 4;
+		const uint64 Bucket = Align((uint64)Size, Step);
+		return Bucket <= MAX_uint32 ? (uint32)Bucket : Size;
+	}
+
+	FBufferRHIRef Acquire(FRHICommandListBase& RHICmdList, EKind Kind, uint32 Size, EBufferUsageFlags Usage, const TCHAR* Name)
+	{
+		check(IsInRenderingThread());
+
+		const FKey Key = { Kind, Usage, GetBucketSize(Size) };
+		FBufferRHIRef Buffer;
+		{
+			FScopeLock Lock(&PoolLock);
+			++NumAcquired;
+
+			// most recently released first, the likeliest to still be resident
+			for (int32 i = FreeBuffers.Num() - 1; i >= 0; --i) {
+				if (FreeBuffers[i].Key == Key) {
+					Buffer = MoveTemp(FreeBuffers[i].Buffer);
+					FreeBuffers.RemoveAt(i, 1, false);
+					FreeBytes -= Key.Size;
+					++NumReused;
+					break;
+				}
+			}
+		}
+
+		if (!Buffer) {
+			FRHIResourceCreateInfo CreateInfo(Name);
+			Buffer = Kind == EKind::Index
+				? RHICmdList.CreateIndexBuffer(sizeof(uint32), Key.Size, Usage, CreateInfo)
+				: RHICmdList.CreateVertexBuffer(Key.Size, Usage, CreateInfo);
+		}
+
+		FScopeLock Lock(&PoolLock);
+		InUse.Add(Buffer.GetReference(), Key);
+		InUseBytes += Key.Size;
+		UpdateStats();
+		return Buffer;
+	}
+
+	FBufferRHIRef Acquire(FRHICommandListBase& RHICmdList, EKind Kind, FResourceArrayInterface* Data, EBufferUsageFlags Usage, const TCHAR* Name)
+	{
+		const uint32 Size = Data->GetResourceDataSize();
+		FBufferRHIRef Buffer = Acquire(RHICmdList, Kind, Size, Usage, Name);
+
+		void* Dst = RHICmdList.LockBuffer(Buffer, 0, Size, RLM_WriteOnly);
+		FMemory::Memcpy(Dst, Data->GetResourceData(), Size);
+		RHICmdList.UnlockBuffer(Buffer);
+
+		Data->Discard();
+		return Buffer;
+	}
+
+	void Release(FBufferRHIRef& Buffer)
+	{
+		if (!Buffer) {
+			return;
+		}
+
+		FScopeLock Lock(&PoolLock);
+		FKey Key;
+		if (InUse.RemoveAndCopyValue(Buffer.GetReference(), Key)) {
+			InUseBytes -= Key.Size;
+
+			const uint64 MaxFreeBytes = (uint64)FMath::Max(CVarBufferPoolMaxFreeMB.GetValueOnAnyThread(), 0) << 20;
+			if (Key.Size <= MaxFreeBytes) {
+				EvictDownTo(MaxFreeBytes - Key.Size);
+				FreeBuffers.Add({ Key, MoveTemp(Buffer) });
+				FreeBytes += Key.Size;
+			}
+			UpdateStats();
+		}
+		Buffer.SafeRelease();
+	}
+
+	void Trim()
+	{
+		FScopeLock Lock(&PoolLock);
+		EvictDownTo(0);
+		UpdateStats();
+	}
+
+	FStats GetStats()
+	{
+		FScopeLock Lock(&PoolLock);
+		FStats Stats;
+		Stats.NumAcquired = NumAcquired;
+		Stats.NumReused = NumReused;
+		Stats.NumInUse = InUse.Num();
+		Stats.InUseBytes = InUseBytes;
+		Stats.NumFree = FreeBuffers.Num();
+		Stats.FreeBytes = FreeBytes;
+		return Stats;
+	}
+}	// namespace GSBufferPool
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  GS.BufferPool.Stats, GS.BufferPool.Trim
+*/
+static FAutoConsoleCommand GSBufferPoolStatsCommand(
+	TEXT("GS.BufferPool.Stats"),
+	TEXT("Prints the splat buffers in use and idle, and how many acquires were served without an RHI allocation."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const GSBufferPool::FStats Stats = GSBufferPool::GetStats();
+			UE_LOG(LogGSBufferPool, Display, TEXT("%d buffers in use (%.1f MB), %d idle (%.1f MB), %llu of %llu acquires reused (%.0f %%)"),
+				Stats.NumInUse, Stats.InUseBytes / (1024. * 1024.), Stats.NumFree, Stats.FreeBytes / (1024. * 1024.),
+				Stats.NumReused, Stats.NumAcquired, Stats.GetReuseRate() * 100.);
+		}));
+
+static FAutoConsoleCommand GSBufferPoolTrimCommand(
+	TEXT("GS.BufferPool.Trim"),
+	TEXT("Frees the idle splat buffers."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			GSBufferPool::Trim();
+		}));
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Recycled GPU buffers
+*
+*  Splat attribute streams and sort scratch are drawn from size buckets (four per power of two, so at most 25 %
+*  larger than asked) and go back to the pool instead of being destroyed. Reloading an actor, or spawning one the
+*  size of an actor just gone, then gets its buffers without an RHI allocation. Idle buffers are kept up to
+*  r.GS.BufferPool.MaxFreeMB, the least recently released go first. Shared by every actor of every world, see
+*  GS.BufferPool.Stats.
+*
+*  A recycled buffer keeps the previous owner's contents. Writes go through the RHI command list, so they land
+*  after the GPU work still reading them.
+*/
+namespace GSBufferPool
+{
+	enum class EKind : uint8
+	{
+		Vertex,
+		Index,		// 32 bit
+	};
+
+	// bucket a request of Size bytes is served from
+	uint32 GetBucketSize(uint32 Size);
+
+	// Render thread. At least Size bytes, uninitialized.
+	FBufferRHIRef Acquire(FRHICommandListBase& RHICmdList, EKind Kind, uint32 Size, EBufferUsageFlags Usage, const TCHAR* Name);
+
+	// Acquire, then Data copied to its start
+	FBufferRHIRef Acquire(FRHICommandListBase& RHICmdList, EKind Kind, FResourceArrayInterface* Data, EBufferUsageFlags Usage, const TCHAR* Name);
+
+	// Any thread. Buffer goes back to the pool and is reset, views of it must be released first.
+	// Buffers that do not come from Acquire are only released.
+	void Release(FBufferRHIRef& Buffer);
+
+	// frees the idle buffers
+	void Trim();
+
+	struct FStats
+	{
+		uint64 NumAcquired = 0;
+		uint64 NumReused = 0;		// acquires served by an idle buffer
+		int32 NumInUse = 0;
+		uint64 InUseBytes = 0;
+		int32 NumFree = 0;
+		uint64 FreeBytes = 0;
+
+		double GetReuseRate() const { return NumAcquired ? (double)NumReused / NumAcquired : 0.; }
+	};
+
+	FStats GetStats();
+}	// namespace GSBufferPool
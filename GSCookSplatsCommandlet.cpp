@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSCookSplatsCommandlet.h"
+#include "GSSplatCooked.h"
+#include "GSSplatCompressed.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+
+UGSCookSplatsCommandlet::UGSCookSplatsCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGSCookSplatsCommandlet::Main(const FString& Params)
+{
+	FString Input;
+	FString Output;
+	if (!FParse::Value(*Params, TEXT("Input="), Input)) {
+		UE_LOG(LogGSLoader, Error, TEXT("usage : -run=GSCookSplats -Input=<file.ply | directory> [-Output=<file>] [-Compress]"));
+		return 1;
+	}
+	FParse::Value(*Params, TEXT("Output="), Output);
+	const bool bCompress = FParse::Param(*Params, TEXT("Compress"));
+
+	TArray<FString> Sources;
+	if (IFileManager::Get().DirectoryExists(*Input)) {
+		IFileManager::Get().FindFilesRecursive(Sources, *Input, TEXT("*.ply"), true, false);
+		Output.Reset();
+	}
+	else {
+		Sources.Add(Input);
+	}
+
+	int32 NumFailed = 0;
+	for (const FString& Source : Sources) {
+		const FString Cooked = !Output.IsEmpty() ? Output
+			: bCompress ? GSCompressed::GetCompressedFilename(Source) : GSCooked::GetCookedFilename(Source);
+
+		const double Start = FPlatformTime::Seconds();
+		GSCompressed::FErrorReport Report;
+		if (bCompress ? GSCompressed::CompressPlyFile(Source, Cooked, &Report) : GSCooked::CookPlyFile(Source, Cooked)) {
+			UE_LOG(LogGSLoader, Display, TEXT("cooked \"%s\" -> \"%s\" (%.2f s)"), *Source, *Cooked, FPlatformTime::Seconds() - Start);
+			if (bCompress) {
+				Report.Log(FPaths::GetCleanFilename(Source));
+			}
+		}
+		else {
+			++NumFailed;
+		}
+	}
+
+	return NumFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GSCookSplatsCommandlet.generated.h"
+
+/*
+*  Offline cooker : PLY -> .gsplat, or -> .gsplatz with -Compress
+*  UnrealEditor-Cmd <Project> -run=GSCookSplats -Input=<file.ply | directory> [-Output=<file>] [-Compress]
+*/
+UCLASS()
+class GSRUNTIME_API UGSCookSplatsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGSCookSplatsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,277 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSLoadArena.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/ScopeLock.h"
+#include "Stats/Stats.h"
+#include <atomic>
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Heap allocations per load"), STAT_GSLoaderAllocationsPerLoad, STATGROUP_GSLoader);
+DECLARE_MEMORY_STAT(TEXT("Pooled load scratch"), STAT_GSLoaderPooledBytes, STATGROUP_GSLoader);
+
+static TAutoConsoleVariable<int32> CVarLoadArenaPoolSize(
+	TEXT("r.GS.LoadArena.PoolSize"),
+	2,
+	TEXT("Idle load scratches (arena and upload streams) kept for the next load. 0 frees them after every load."),
+	ECVF_Default);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	using namespace GSLoadArena;
+
+	std::atomic<uint64> NumAllocations{ 0 };
+	std::atomic<uint32> NumLoads{ 0 };
+	std::atomic<uint32> LastLoadAllocations{ 0 };
+
+	// FLoadScopes open on this thread, and the allocations made while one was
+	thread_local uint32 ThreadScopeDepth = 0;
+	thread_local uint64 ThreadAllocations = 0;
+
+	/*
+	*  GMalloc proxy counting the calls of the threads inside an FLoadScope. Everything else goes straight to the
+	*  wrapped allocator, which owns all the memory : a block may be freed on either side of the swap.
+	*/
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountCall();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountCall();
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count) {
+				CountCall();
+			}
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count) {
+				CountCall();
+			}
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+	private:
+		FORCEINLINE void CountCall() const
+		{
+			if (ThreadScopeDepth) {
+				++ThreadAllocations;
+				++NumAllocations;
+			}
+		}
+
+		FMalloc* Inner;
+	};
+
+	// once, never removed : blocks allocated through the proxy may outlive any scope
+	void InstallCountingMalloc()
+	{
+		static FMalloc* const Counting = []()
+			{
+				FMalloc* Proxy = new FCountingMalloc(GMalloc);
+				GMalloc = Proxy;
+				return Proxy;
+			}();
+	}
+
+	FCriticalSection PoolLock;
+	TArray<FScratch*> Pool;
+
+	uint64 GetPooledBytes(const FScratch& Scratch)
+	{
+		const PLY::FGaussSplatVertex& GSData = Scratch.GSData;
+		uint64 Bytes = Scratch.Arena.GetReservedBytes();
+		Bytes += GSData.posrot.GetAllocatedSize() + GSData.scl.GetAllocatedSize() + GSData.sh0.GetAllocatedSize();
+		for (int32 i = 0; i < 3; ++i) {
+			Bytes += GSData.r_sh1_4[i].GetAllocatedSize() + GSData.g_sh1_4[i].GetAllocatedSize() + GSData.b_sh1_4[i].GetAllocatedSize();
+		}
+		return Bytes;
+	}
+
+	void Release(FScratch* Scratch)
+	{
+		Scratch->Arena.Reset();
+
+		FScopeLock Lock(&PoolLock);
+		if (Pool.Num() < CVarLoadArenaPoolSize.GetValueOnAnyThread()) {
+			Pool.Add(Scratch);
+			INC_MEMORY_STAT_BY(STAT_GSLoaderPooledBytes, GetPooledBytes(*Scratch));
+		}
+		else {
+			delete Scratch;
+		}
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSLoadArena
+{
+	/*
+	*  FArena
+	*/
+	FArena::~FArena()
+	{
+		Trim();
+	}
+
+	void* FArena::Alloc(SIZE_T Size, uint32 Alignment)
+	{
+		for (; CurrentBlock < Blocks.Num(); ++CurrentBlock, Offset = 0) {
+			const FBlock& Block = Blocks[CurrentBlock];
+			const SIZE_T Begin = Align(Offset, (SIZE_T)Alignment);
+			if (Begin + Size <= Block.Size) {
+				Offset = Begin + Size;
+				return Block.Data + Begin;
+			}
+		}
+
+		// large requests get a block of their own, and keep it for the next load of the same size
+		FBlock Block;
+		Block.Size = FMath::Max<SIZE_T>(Align(Size, (SIZE_T)4096), BlockSize);
+		Block.Data = static_cast<uint8*>(FMemory::Malloc(Block.Size, FMath::Max<uint32>(Alignment, 64)));
+
+		CurrentBlock = Blocks.Add(Block);
+		Offset = Size;
+		return Block.Data;
+	}
+
+	void FArena::Reset()
+	{
+		CurrentBlock = 0;
+		Offset = 0;
+	}
+
+	void FArena::Trim()
+	{
+		for (const FBlock& Block : Blocks) {
+			FMemory::Free(Block.Data);
+		}
+		Blocks.Empty();
+		Reset();
+	}
+
+	SIZE_T FArena::GetReservedBytes() const
+	{
+		SIZE_T Bytes = 0;
+		for (const FBlock& Block : Blocks) {
+			Bytes += Block.Size;
+		}
+		return Bytes;
+	}
+
+
+	FScratchRef Acquire()
+	{
+		FScratch* Scratch = nullptr;
+		{
+			FScopeLock Lock(&PoolLock);
+			if (Pool.Num()) {
+				Scratch = Pool.Pop(false);
+				DEC_MEMORY_STAT_BY(STAT_GSLoaderPooledBytes, GetPooledBytes(*Scratch));
+			}
+		}
+		if (!Scratch) {
+			Scratch = new FScratch();
+		}
+		return FScratchRef(Scratch, [](FScratch* InScratch) { Release(InScratch); });
+	}
+
+	PLY::FSplatChunkRef AcquireStreams()
+	{
+		const FScratchRef Scratch = Acquire();
+		return PLY::FSplatChunkRef(Scratch, &Scratch->GSData);
+	}
+
+
+	/*
+	*  FLoadScope
+	*/
+	FLoadScope::FLoadScope(const FString& InName)
+		: Name(InName)
+	{
+		InstallCountingMalloc();
+		++ThreadScopeDepth;
+		StartCount = ThreadAllocations;
+	}
+
+	FLoadScope::~FLoadScope()
+	{
+		const uint32 Count = GetNumAllocations();
+		--ThreadScopeDepth;
+		++NumLoads;
+		LastLoadAllocations = Count;
+		SET_DWORD_STAT(STAT_GSLoaderAllocationsPerLoad, Count);
+		UE_LOG(LogGSLoader, Verbose, TEXT("\"%s\" : %u heap allocations"), *Name, Count);
+	}
+
+	uint32 FLoadScope::GetNumAllocations() const
+	{
+		return (uint32)(ThreadAllocations - StartCount);
+	}
+
+	FStats GetStats()
+	{
+		FStats Stats;
+		Stats.NumLoads = NumLoads;
+		Stats.LastLoadAllocations = LastLoadAllocations;
+		Stats.TotalAllocations = NumAllocations;
+
+		FScopeLock Lock(&PoolLock);
+		Stats.NumPooled = Pool.Num();
+		for (const FScratch* Scratch : Pool) {
+			Stats.PooledBytes += GetPooledBytes(*Scratch);
+		}
+		return Stats;
+	}
+}	// namespace GSLoadArena
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  GS.LoadArena.Stats
+*/
+static FAutoConsoleCommand GSLoadArenaStatsCommand(
+	TEXT("GS.LoadArena.Stats"),
+	TEXT("Prints loads, heap allocations of the last load and the pooled load scratch."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const GSLoadArena::FStats Stats = GSLoadArena::GetStats();
+			UE_LOG(LogGSLoader, Display, TEXT("%u loads, %u heap allocations in the last one, %llu in total, %d pooled scratches (%.1f MB)"),
+				Stats.NumLoads, Stats.LastLoadAllocations, Stats.TotalAllocations, Stats.NumPooled, Stats.PooledBytes / (1024. * 1024.));
+		}));
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GSPlyLoader.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Reusable load scratch
+*
+*  A load draws its temporaries from a linear FArena and decodes into pooled upload streams. Both keep their
+*  memory when the load is done, so reloading a file of the same size (PostLoad, property edits, animation frames)
+*  does not go back to the heap. FLoadScope counts the GMalloc calls a load makes (STAT_GSLoaderAllocationsPerLoad,
+*  GS.LoadArena.Stats).
+*/
+namespace GSLoadArena
+{
+	/*
+	*  Bump allocator over retained blocks. Not thread-safe : allocate on the loading thread, fill from any.
+	*/
+	class FArena
+	{
+	public:
+		static constexpr SIZE_T BlockSize = 16 << 20;
+
+		FArena() = default;
+		~FArena();
+		FArena(const FArena&) = delete;
+		FArena& operator=(const FArena&) = delete;
+
+		// uninitialized, valid until Reset
+		void* Alloc(SIZE_T Size, uint32 Alignment = 64);
+
+		template<typename T>
+		TArrayView64<T> AllocArray(int64 Num)
+		{
+			return TArrayView64<T>(static_cast<T*>(Alloc(Num * sizeof(T), FMath::Max<uint32>(alignof(T), 64))), Num);
+		}
+
+		// forgets every allocation, keeps the blocks
+		void Reset();
+
+		// frees the blocks
+		void Trim();
+
+		SIZE_T GetReservedBytes() const;
+
+	private:
+		struct FBlock
+		{
+			uint8* Data = nullptr;
+			SIZE_T Size = 0;
+		};
+
+		TArray<FBlock> Blocks;
+		int32 CurrentBlock = 0;
+		SIZE_T Offset = 0;
+	};
+
+	struct FScratch
+	{
+		FArena Arena;
+		PLY::FGaussSplatVertex GSData;
+	};
+	using FScratchRef = TSharedRef<FScratch, ESPMode::ThreadSafe>;
+
+	// An idle scratch from the pool, or a new one. It returns to the pool when the last reference goes,
+	// up to r.GS.LoadArena.PoolSize idle ones are kept.
+	FScratchRef Acquire();
+
+	// Acquire, viewed as its upload streams
+	PLY::FSplatChunkRef AcquireStreams();
+
+	/*
+	*  GMalloc calls of the constructing thread from construction to destruction make one load. The first scope
+	*  wraps GMalloc in a counting proxy, which then stays. Decode batches the load hands to task workers are not
+	*  counted, they only fill streams sized up front.
+	*/
+	class FLoadScope
+	{
+	public:
+		explicit FLoadScope(const FString& InName);
+		~FLoadScope();
+
+		// so far
+		uint32 GetNumAllocations() const;
+
+	private:
+		FString Name;
+		uint64 StartCount;
+	};
+
+	struct FStats
+	{
+		uint32 NumLoads = 0;
+		uint32 LastLoadAllocations = 0;
+		uint64 TotalAllocations = 0;
+		int32 NumPooled = 0;
+		uint64 PooledBytes = 0;
+	};
+
+	FStats GetStats();
+}	// namespace GSLoadArena
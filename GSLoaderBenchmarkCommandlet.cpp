@@ -0,0 +1,558 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSLoaderBenchmarkCommandlet.h"
+#include "GSPlyLoader.h"
+#include "GSSplatKernels.h"
+#include "Algo/Find.h"
+#include "Async/Async.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonWriter.h"
+#include <atomic>
+#include <fstream>
+
+#include "loader/ply/PlyAttributeCollection.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	/*
+	*  Wall time and memory of one stage
+	*/
+	struct FStageResult
+	{
+		FString Name;
+		double Seconds = 0.;
+		uint64 Bytes = 0;			// bytes consumed by the stage
+		uint64 WorkingSetBytes = 0;	// buffers the stage allocates
+		uint64 PeakUsedBytes = 0;	// growth of the process at its peak during the stage
+	};
+
+	/*
+	*  Peak UsedPhysical over a stage, above what the process held when the stage began. The process wide
+	*  PeakUsedPhysical would carry the peak of the stages before, so a thread of its own samples UsedPhysical,
+	*  off the task workers the stages run on.
+	*/
+	class FPeakMemorySampler
+	{
+	public:
+		FPeakMemorySampler()
+			: BaseUsedPhysical(FPlatformMemory::GetStats().UsedPhysical)
+			, PeakUsedPhysical(BaseUsedPhysical)
+		{
+			Sampling = Async(EAsyncExecution::Thread, [this]()
+				{
+					while (!bStop) {
+						Sample();
+						FPlatformProcess::Sleep(0.001f);
+					}
+				});
+		}
+
+		~FPeakMemorySampler()
+		{
+			Stop();
+		}
+
+		void Stop()
+		{
+			if (Sampling.IsValid()) {
+				bStop = true;
+				Sampling.Wait();
+				Sampling.Reset();
+				Sample();
+			}
+		}
+
+		uint64 GetPeakUsedBytes() const
+		{
+			return PeakUsedPhysical - BaseUsedPhysical;
+		}
+
+	private:
+		void Sample()
+		{
+			const uint64 Used = FPlatformMemory::GetStats().UsedPhysical;
+			uint64 Peak = PeakUsedPhysical;
+			while (Used > Peak && !PeakUsedPhysical.compare_exchange_weak(Peak, Used)) {
+			}
+		}
+
+		const uint64 BaseUsedPhysical;
+		std::atomic<uint64> PeakUsedPhysical;
+		std::atomic<bool> bStop{ false };
+		TFuture<void> Sampling;
+	};
+
+	class FStageTimer
+	{
+	public:
+		FStageTimer(TArray<FStageResult>& InResults, const TCHAR* Name, uint64 Bytes)
+			: Results(InResults)
+		{
+			Result.Name = Name;
+			Result.Bytes = Bytes;
+			Start = FPlatformTime::Seconds();
+		}
+
+		~FStageTimer()
+		{
+			Result.Seconds = FPlatformTime::Seconds() - Start;
+			Memory.Stop();
+			Result.PeakUsedBytes = Memory.GetPeakUsedBytes();
+			Results.Add(Result);
+		}
+
+		FStageResult Result;
+
+	private:
+		TArray<FStageResult>& Results;
+		FPeakMemorySampler Memory;
+		double Start;
+	};
+
+	template<typename ArrayType>
+	uint64 GetAllocatedBytes(const ArrayType& Array)
+	{
+		return (uint64)Array.Num() * sizeof(typename ArrayType::ElementType);
+	}
+
+	// the vertex streams of a load, as uploaded
+	uint64 GetStreamBytes(PLY::FGaussSplatVertex& GSData)
+	{
+		uint64 Bytes = 0;
+		for (FResourceArrayInterface* Stream : PLY::GetStreams(GSData).Streams) {
+			Bytes += Stream ? Stream->GetResourceDataSize() : 0;
+		}
+		return Bytes;
+	}
+
+	/*
+	*  Attributes pulled out of the vertex records, one array per PLY property group
+	*/
+	struct FExtractedAttributes
+	{
+		TArray<float> Position;		// x, y, z
+		TArray<float> Rotation;		// rot_0 - rot_3
+		TArray<float> Scale[3];
+		TArray<float> Opacity;
+		TArray<float> Dc;			// f_dc_0 - 2
+		TArray<float> Rest;			// f_rest_*, NumShRest per channel
+
+		uint64 GetAllocatedBytes() const
+		{
+			uint64 Bytes = ::GetAllocatedBytes(Position) + ::GetAllocatedBytes(Rotation) + ::GetAllocatedBytes(Opacity)
+				+ ::GetAllocatedBytes(Dc) + ::GetAllocatedBytes(Rest);
+			for (const TArray<float>& S : Scale) {
+				Bytes += ::GetAllocatedBytes(S);
+			}
+			return Bytes;
+		}
+	};
+
+	bool ExtractAttributes(const PLY::FPlyHeader& Header, const uint8* VertexData, int32 ShDegree, FExtractedAttributes& Out)
+	{
+		auto Offset = [&Header](const std::string& Name)
+			{
+				const PLY::FPlyProperty* Property = Header.Find(Name);
+				return Property && Property->bIsFloat ? Property->Offset : -1;
+			};
+		auto Read = [](const uint8* Record, int32 InOffset)
+			{
+				float Value;
+				FMemory::Memcpy(&Value, Record + InOffset, sizeof(float));
+				return Value;
+			};
+
+		// f_rest_* are channel major, as many per channel as the file's own degree has
+		const int32 FileRest = Header.Properties.FilterByPredicate([](const PLY::FPlyProperty& Property) { return Property.Name.rfind("f_rest_", 0) == 0; }).Num() / 3;
+		const int32 NumRest = PLY::GetNumShRest(ShDegree);
+		const int32 Num = (int32)Header.NumVertices;
+
+		int32 PosRot[7] = { Offset("x"), Offset("y"), Offset("z"), Offset("rot_0"), Offset("rot_1"), Offset("rot_2"), Offset("rot_3") };
+		int32 Scale[3] = { Offset("scale_0"), Offset("scale_1"), Offset("scale_2") };
+		int32 Dc[3] = { Offset("f_dc_0"), Offset("f_dc_1"), Offset("f_dc_2") };
+		const int32 Opacity = Offset("opacity");
+		TArray<int32> Rest;
+		for (int32 c = 0; c < 3; ++c) {
+			for (int32 j = 0; j < NumRest; ++j) {
+				Rest.Add(j < FileRest ? Offset("f_rest_" + std::to_string(c * FileRest + j)) : -1);
+			}
+		}
+		if (Opacity < 0 || Algo::Find(PosRot, -1) || Algo::Find(Scale, -1) || Algo::Find(Dc, -1)) {
+			return false;
+		}
+
+		Out.Position.SetNumUninitialized(Num * 3);
+		Out.Rotation.SetNumUninitialized(Num * 4);
+		Out.Opacity.SetNumUninitialized(Num);
+		Out.Dc.SetNumUninitialized(Num * 3);
+		Out.Rest.SetNumUninitialized((int64)Num * Rest.Num());
+		for (TArray<float>& S : Out.Scale) {
+			S.SetNumUninitialized(Num);
+		}
+
+		for (int32 i = 0; i < Num; ++i) {
+			const uint8* Record = VertexData + (int64)i * Header.Stride;
+			for (int32 k = 0; k < 3; ++k) {
+				Out.Position[i * 3 + k] = Read(Record, PosRot[k]);
+				Out.Scale[k][i] = Read(Record, Scale[k]);
+				Out.Dc[i * 3 + k] = Read(Record, Dc[k]);
+			}
+			for (int32 k = 0; k < 4; ++k) {
+				Out.Rotation[i * 4 + k] = Read(Record, PosRot[3 + k]);
+			}
+			Out.Opacity[i] = Read(Record, Opacity);
+			for (int32 k = 0; k < Rest.Num(); ++k) {
+				Out.Rest[(int64)i * Rest.Num() + k] = Rest[k] >= 0 ? Read(Record, Rest[k]) : 0.f;
+			}
+		}
+		return true;
+	}
+
+	// rest coefficient j of channel c, zero above the extracted degree
+	FORCEINLINE float GetRest(const FExtractedAttributes& In, int32 NumRest, int32 i, int32 c, int32 j)
+	{
+		return j < NumRest ? In.Rest[(int64)i * NumRest * 3 + c * NumRest + j] : 0.f;
+	}
+
+	// slice of the LoadPlyFileSliced stage, small enough for the default sizes to need several
+	constexpr UINT SlicedStageSize = 64 * 1024;
+
+	// process memory the sliced stage may take besides its window and mapped slice : allocator and task overhead
+	constexpr uint64 SlicedStageSlackBytes = 16 * 1024 * 1024;
+
+	/*
+	*  One size / degree run, stage by stage, the way the fused loader does it in a single pass
+	*/
+	bool RunStages(const FString& Filename, int32 ShDegree, TArray<FStageResult>& Stages, uint32& OutNumParticles)
+	{
+		const uint64 FileSize = IFileManager::Get().FileSize(*Filename);
+
+		{
+			TArray64<uint8> FileData;
+			FStageTimer Timer(Stages, TEXT("FileRead"), FileSize);
+			if (!FFileHelper::LoadFileToArray(FileData, *Filename)) {
+				return false;
+			}
+			Timer.Result.WorkingSetBytes = FileData.Num();
+		}
+
+		Ply3DGS::FAttributeCollection Collection;
+		PLY::FPlyHeader Header;
+		{
+			FStageTimer Timer(Stages, TEXT("LoadFromStream"), FileSize);
+			std::ifstream Stream(*Filename, std::ios::in | std::ios::binary);
+			if (!Stream.is_open() || Collection.LoadFromStream(Stream) != Ply3DGS::EPlyErrorCode::PLY_OK) {
+				return false;
+			}
+
+			std::string HeaderText;
+			Stream.clear();
+			Stream.seekg(0);
+			for (std::string Line; std::getline(Stream, Line); ) {
+				HeaderText += Line + '\n';
+				if (Line.rfind("end_header", 0) == 0) {
+					break;
+				}
+			}
+			if (!Header.Parse(reinterpret_cast<const uint8*>(HeaderText.data()), HeaderText.size())) {
+				return false;
+			}
+			Timer.Result.WorkingSetBytes = Header.NumVertices * Header.Stride;
+		}
+
+		const int32 Num = (int32)Header.NumVertices;
+		const int32 NumRest = PLY::GetNumShRest(ShDegree);
+		OutNumParticles = Num;
+
+		FExtractedAttributes Attributes;
+		{
+			FStageTimer Timer(Stages, TEXT("AttributeExtraction"), Header.NumVertices * Header.Stride);
+			if (!ExtractAttributes(Header, reinterpret_cast<const uint8*>(Collection.GetData()), ShDegree, Attributes)) {
+				return false;
+			}
+			Timer.Result.WorkingSetBytes = Attributes.GetAllocatedBytes();
+		}
+
+		{
+			FStageTimer Timer(Stages, TEXT("Activation"), (uint64)Num * 4 * sizeof(float));
+			for (TArray<float>& S : Attributes.Scale) {
+				GSKernels::ActivateScale(S.GetData(), S.GetData(), Num);
+			}
+			GSKernels::ActivateOpacity(Attributes.Opacity.GetData(), Attributes.Opacity.GetData(), Num);
+		}
+
+		PLY::FGaussSplatVertex GSData;
+		PLY::AllocateStreams(GSData, Num, ShDegree);
+		{
+			FStageTimer Timer(Stages, TEXT("Sh0Interleave"), (uint64)Num * 12 * sizeof(float));
+			for (int32 i = 0; i < Num; ++i) {
+				for (int32 c = 0; c < 3; ++c) {
+					GSData.sh0[i * 3 + c] = FVector4f(Attributes.Dc[i * 3 + c], GetRest(Attributes, NumRest, i, c, 0), GetRest(Attributes, NumRest, i, c, 1), GetRest(Attributes, NumRest, i, c, 2));
+				}
+			}
+			Timer.Result.WorkingSetBytes = GetAllocatedBytes(GSData.sh0);
+		}
+
+		{
+			FStageTimer Timer(Stages, TEXT("BufferPacking"), Attributes.GetAllocatedBytes());
+			const int32 NumBandStreams = PLY::GetNumShBandStreams(ShDegree);
+			for (int32 i = 0; i < Num; ++i) {
+				for (int32 k = 0; k < 3; ++k) {
+					GSData.posrot[i * 7 + k] = Attributes.Position[i * 3 + k];
+				}
+				for (int32 k = 0; k < 4; ++k) {
+					GSData.posrot[i * 7 + 3 + k] = Attributes.Rotation[i * 4 + k];
+				}
+				GSData.scl[i] = FVector4f(Attributes.Scale[0][i], Attributes.Scale[1][i], Attributes.Scale[2][i], Attributes.Opacity[i]);
+
+				for (int32 band = 0; band < NumBandStreams; ++band) {
+					const int32 j = 3 + band * 4;
+					TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>* Streams[3] = { &GSData.r_sh1_4[band], &GSData.g_sh1_4[band], &GSData.b_sh1_4[band] };
+					for (int32 c = 0; c < 3; ++c) {
+						(*Streams[c])[i] = FVector4f(GetRest(Attributes, NumRest, i, c, j), GetRest(Attributes, NumRest, i, c, j + 1),
+							GetRest(Attributes, NumRest, i, c, j + 2), GetRest(Attributes, NumRest, i, c, j + 3));
+					}
+				}
+			}
+
+			Timer.Result.WorkingSetBytes = GetStreamBytes(GSData);
+		}
+
+		// the production paths end to end, for comparison with the sum of the stages
+		{
+			PLY::FGaussSplatVertex Fused;
+			FStageTimer Timer(Stages, TEXT("LoadPlyFileStream"), FileSize);
+			if (!PLY::LoadPlyFileStream(Filename, Fused, ShDegree)) {
+				return false;
+			}
+			Timer.Result.WorkingSetBytes = GetStreamBytes(Fused);
+		}
+		{
+			PLY::FGaussSplatVertex Fused;
+			FStageTimer Timer(Stages, TEXT("LoadPlyFileMapped"), FileSize);
+			if (!PLY::LoadPlyFileMapped(Filename, Fused, ShDegree)) {
+				return false;
+			}
+			Timer.Result.WorkingSetBytes = GetStreamBytes(Fused);
+		}
+
+		// bounded memory : the staging the loader accounts for stays within its window, whatever the splat count.
+		// The process growth, sampled at every slice, is reported against the window and a mapped slice but does
+		// not fail the run, other threads allocate too.
+		{
+			const uint64 BaseUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+			uint64 PeakUsedPhysical = BaseUsedPhysical;
+
+			FStageTimer Timer(Stages, TEXT("LoadPlyFileSliced"), FileSize);
+			PLY::FSliceStats SliceStats;
+			UINT NumSliced = 0;
+			auto OnSlice = [&](const PLY::FSplatChunkRef& Slice, UINT NumTotal)
+				{
+					NumSliced += Slice->NumParticles;
+					PeakUsedPhysical = FMath::Max<uint64>(PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+					return true;
+				};
+			if (!PLY::LoadPlyFileSliced(Filename, SlicedStageSize, ShDegree, OnSlice, &SliceStats)) {
+				return false;
+			}
+			const uint64 UsedBytes = PeakUsedPhysical - BaseUsedPhysical;
+			Timer.Result.WorkingSetBytes = UsedBytes;
+
+			const uint64 WindowBytes = PLY::GetSliceWindowBytes(SlicedStageSize, ShDegree);
+			if (NumSliced != OutNumParticles || SliceStats.PeakStagingBytes > WindowBytes || SliceStats.MaxSliceAllocations >= PLY::SplatStream_Count) {
+				UE_LOG(LogGSLoader, Error, TEXT("sliced load of \"%s\" : %u of %u splats, %llu staging bytes for a %llu byte window, %u allocations, %u per reused slice"),
+					*Filename, NumSliced, OutNumParticles, SliceStats.PeakStagingBytes, WindowBytes, SliceStats.NumAllocations, SliceStats.MaxSliceAllocations);
+				return false;
+			}
+
+			const uint64 BoundBytes = WindowBytes + (uint64)SlicedStageSize * Header.Stride + SlicedStageSlackBytes;
+			UE_LOG(LogGSLoader, Display, TEXT("sliced load of \"%s\" : the process grew by %llu bytes, %llu expected at most%s"),
+				*Filename, UsedBytes, BoundBytes, UsedBytes > BoundBytes ? TEXT(", over") : TEXT(""));
+		}
+
+		return true;
+	}
+
+	TArray<int32> ParseIntList(const FString& Params, const TCHAR* Key, const TArray<int32>& Default)
+	{
+		FString Value;
+		if (!FParse::Value(*Params, Key, Value, false)) {
+			return Default;
+		}
+
+		TArray<FString> Items;
+		Value.ParseIntoArray(Items, TEXT(","));
+
+		TArray<int32> Result;
+		for (const FString& Item : Items) {
+			Result.Add(FCString::Atoi(*Item));
+		}
+		return Result;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+UGSLoaderBenchmarkCommandlet::UGSLoaderBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+bool UGSLoaderBenchmarkCommandlet::WriteSyntheticPly(const FString& Filename, int32 NumSplats, int32 ShDegree, int32 Seed)
+{
+	const int32 NumRest = PLY::GetNumShRest(ShDegree) * 3;
+
+	FString Header = FString::Printf(TEXT("ply\nformat binary_little_endian 1.0\nelement vertex %d\n"), NumSplats);
+	for (const TCHAR* Name : { TEXT("x"), TEXT("y"), TEXT("z"), TEXT("nx"), TEXT("ny"), TEXT("nz"), TEXT("f_dc_0"), TEXT("f_dc_1"), TEXT("f_dc_2") }) {
+		Header += FString::Printf(TEXT("property float %s\n"), Name);
+	}
+	for (int32 k = 0; k < NumRest; ++k) {
+		// channel major, NumRest / 3 per channel
+		Header += FString::Printf(TEXT("property float f_rest_%d\n"), k);
+	}
+	for (const TCHAR* Name : { TEXT("opacity"), TEXT("scale_0"), TEXT("scale_1"), TEXT("scale_2"), TEXT("rot_0"), TEXT("rot_1"), TEXT("rot_2"), TEXT("rot_3") }) {
+		Header += FString::Printf(TEXT("property float %s\n"), Name);
+	}
+	Header += TEXT("end_header\n");
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer) {
+		UE_LOG(LogGSLoader, Error, TEXT("could not create \"%s\""), *Filename);
+		return false;
+	}
+	FTCHARToUTF8 HeaderUtf8(*Header);
+	Writer->Serialize(const_cast<ANSICHAR*>(HeaderUtf8.Get()), HeaderUtf8.Length());
+
+	// a scene-like distribution : clustered positions, mostly small splats, opacity logits around 0
+	FRandomStream Random(Seed);
+	constexpr int32 BlockSize = 64 * 1024;
+	const int32 NumFloats = 9 + NumRest + 8;
+	TArray<float> Block;
+
+	for (int32 Begin = 0; Begin < NumSplats; Begin += BlockSize) {
+		const int32 Count = FMath::Min(BlockSize, NumSplats - Begin);
+		Block.SetNumUninitialized(Count * NumFloats);
+
+		for (int32 i = 0; i < Count; ++i) {
+			float* Record = &Block[i * NumFloats];
+			const FVector3f Cluster = FVector3f(Random.FRandRange(-50.f, 50.f), Random.FRandRange(-5.f, 5.f), Random.FRandRange(-50.f, 50.f));
+			Record[0] = Cluster.X + Random.FRandRange(-1.f, 1.f);
+			Record[1] = Cluster.Y + Random.FRandRange(-1.f, 1.f);
+			Record[2] = Cluster.Z + Random.FRandRange(-1.f, 1.f);
+			Record[3] = Record[4] = Record[5] = 0.f;
+			for (int32 k = 0; k < 3; ++k) {
+				Record[6 + k] = Random.FRandRange(-2.f, 2.f);
+			}
+			for (int32 k = 0; k < NumRest; ++k) {
+				Record[9 + k] = Random.FRandRange(-0.3f, 0.3f);
+			}
+			float* Tail = Record + 9 + NumRest;
+			Tail[0] = Random.FRandRange(-4.f, 6.f);
+			for (int32 k = 0; k < 3; ++k) {
+				Tail[1 + k] = Random.FRandRange(-7.f, -2.f);
+			}
+			const FQuat4f Rotation(FVector3f(Random.GetUnitVector()), Random.FRandRange(0.f, UE_TWO_PI));
+			Tail[4] = Rotation.W;
+			Tail[5] = Rotation.X;
+			Tail[6] = Rotation.Y;
+			Tail[7] = Rotation.Z;
+		}
+
+		Writer->Serialize(Block.GetData(), (int64)Block.Num() * sizeof(float));
+	}
+
+	return Writer->Close() && !Writer->IsError();
+}
+
+int32 UGSLoaderBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TArray<int32> Sizes = ParseIntList(Params, TEXT("Sizes="), { 100000, 1000000, 5000000, 20000000 });
+	const TArray<int32> ShDegrees = ParseIntList(Params, TEXT("ShDegrees="), { 0, 1, 2, 3 });
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FString Dir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("GSLoaderBenchmark"));
+	FParse::Value(*Params, TEXT("Dir="), Dir);
+	FString Output = FPaths::Combine(Dir, TEXT("report.json"));
+	FParse::Value(*Params, TEXT("Output="), Output);
+	const bool bKeep = FParse::Param(*Params, TEXT("Keep"));
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("seed"), Seed);
+	Writer->WriteValue(TEXT("platform"), FString(FPlatformProperties::IniPlatformName()));
+	Writer->WriteValue(TEXT("cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	Writer->WriteValue(TEXT("workers"), FTaskGraphInterface::Get().GetNumWorkerThreads());
+	Writer->WriteArrayStart(TEXT("runs"));
+
+	int32 NumFailed = 0;
+	for (int32 ShDegree : ShDegrees) {
+		for (int32 NumSplats : Sizes) {
+			ShDegree = FMath::Clamp(ShDegree, 0, PLY::MaxShDegree);
+			const FString Filename = FPaths::Combine(Dir, FString::Printf(TEXT("synthetic_%d_sh%d_seed%d.ply"), NumSplats, ShDegree, Seed));
+
+			if (!IFileManager::Get().FileExists(*Filename) && !WriteSyntheticPly(Filename, NumSplats, ShDegree, Seed)) {
+				++NumFailed;
+				continue;
+			}
+
+			TArray<FStageResult> Stages;
+			uint32 NumParticles = 0;
+			const bool bSucceeded = RunStages(Filename, ShDegree, Stages, NumParticles);
+			if (!bSucceeded) {
+				UE_LOG(LogGSLoader, Error, TEXT("benchmark of \"%s\" failed"), *Filename);
+				++NumFailed;
+			}
+
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("splats"), NumSplats);
+			Writer->WriteValue(TEXT("shDegree"), ShDegree);
+			Writer->WriteValue(TEXT("fileBytes"), (int64)IFileManager::Get().FileSize(*Filename));
+			Writer->WriteValue(TEXT("succeeded"), bSucceeded);
+			Writer->WriteArrayStart(TEXT("stages"));
+			for (const FStageResult& Stage : Stages) {
+				const double Seconds = FMath::Max(Stage.Seconds, 1e-9);
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("name"), Stage.Name);
+				Writer->WriteValue(TEXT("seconds"), Stage.Seconds);
+				Writer->WriteValue(TEXT("splatsPerSecond"), NumParticles / Seconds);
+				Writer->WriteValue(TEXT("megabytesPerSecond"), Stage.Bytes / Seconds / (1024. * 1024.));
+				Writer->WriteValue(TEXT("workingSetBytes"), (int64)Stage.WorkingSetBytes);
+				Writer->WriteValue(TEXT("peakUsedBytes"), (int64)Stage.PeakUsedBytes);
+				Writer->WriteObjectEnd();
+
+				UE_LOG(LogGSLoader, Display, TEXT("%9d splats  SH%d  %-20s %8.3f s  %7.2f Msplats/s"),
+					NumSplats, ShDegree, *Stage.Name, Stage.Seconds, NumParticles / Seconds / 1e6);
+			}
+			Writer->WriteArrayEnd();
+			Writer->WriteObjectEnd();
+
+			if (!bKeep) {
+				IFileManager::Get().Delete(*Filename);
+			}
+		}
+	}
+
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	if (!FFileHelper::SaveStringToFile(Json, *Output)) {
+		UE_LOG(LogGSLoader, Error, TEXT("could not write \"%s\""), *Output);
+		return 1;
+	}
+	UE_LOG(LogGSLoader, Display, TEXT("benchmark report written to \"%s\""), *Output);
+
+	return NumFailed == 0 ? 0 : 1;
+}
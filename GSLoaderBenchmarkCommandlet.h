@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GSLoaderBenchmarkCommandlet.generated.h"
+
+/*
+*  Loader benchmark : generates deterministic synthetic PLY files and times every load stage, GPU free
+*  UnrealEditor-Cmd <Project> -run=GSLoaderBenchmark -nullrhi [-Sizes=100000,1000000,5000000,20000000]
+*      [-ShDegrees=0,1,2,3] [-Seed=1] [-Dir=<scratch dir>] [-Output=<report.json>] [-Keep]
+*/
+UCLASS()
+class GSRUNTIME_API UGSLoaderBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGSLoaderBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	// Binary little endian 3DGS PLY with NumSplats records and SH up to ShDegree, identical for identical arguments.
+	static bool WriteSyntheticPly(const FString& Filename, int32 NumSplats, int32 ShDegree, int32 Seed);
+};
@@ -0,0 +1,1121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSPlyLoader.h"
+#include "GSSplatKernels.h"
+#include "GSSplatCompressed.h"
+#include "GSLoadArena.h"
+#include "GSLoaderBenchmarkCommandlet.h"
+#include "GSSplatCulling.h"
+#include <format>
+#include <fstream>
+#include <sstream>
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "Tasks/Task.h"
+
+#include "loader/ply/PlyAttributeCollection.h"
+
+
+DEFINE_LOG_CATEGORY(LogGSLoader);
+
+static TAutoConsoleVariable<int32> CVarPlyMemoryMapped(
+	TEXT("r.GS.Ply.MemoryMapped"),
+	1,
+	TEXT("0: load PLY files through std::ifstream and FAttributeCollection\n")
+	TEXT("1: memory-map PLY files and decode the vertex records in place (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPlyVerifyMappedLoad(
+	TEXT("r.GS.Ply.VerifyMappedLoad"),
+	0,
+	TEXT("When set, every memory-mapped PLY load is repeated through the stream path and compared bit for bit."),
+	ECVF_Default);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// smallest particle range worth a ParallelFor task
+	constexpr int32 MinDecodeBatchSize = 4 * 1024;
+
+	// particles gathered per GSKernels activation call
+	constexpr int32 ActivationTileSize = 256;
+
+	FORCEINLINE float ReadFloat(const uint8* Record, int32 Offset)
+	{
+		float Value;
+		FMemory::Memcpy(&Value, Record + Offset, sizeof(float));
+		return Value;
+	}
+
+	/*
+	*  Byte offsets of every attribute the actor consumes, resolved once per file
+	*/
+	struct FVertexLayout
+	{
+		int32 Stride = 0;
+		int32 PosRot[7];
+		int32 Scale[3];
+		int32 Opacity = 0;
+		int32 Dc[3];
+		int32 Rest[45];		// channel * 15 + j
+		int32 NumRest = 0;	// per channel, min of the requested and the stored degree
+
+		// f_rest_* beyond NumShRest per channel are not looked up
+		bool Resolve(const PLY::FPlyHeader& Header, int32 NumShRest)
+		{
+			auto ResolveOne = [&Header](const std::string& Name, int32& OutOffset)
+				{
+					const PLY::FPlyProperty* Property = Header.Find(Name);
+					if (!Property || !Property->bIsFloat) {
+						return false;
+					}
+					OutOffset = Property->Offset;
+					return true;
+				};
+
+			static const char* PosRotNames[7] = { "x", "y", "z", "rot_0", "rot_1", "rot_2", "rot_3" };
+			for (int32 i = 0; i < 7; ++i) {
+				if (!ResolveOne(PosRotNames[i], PosRot[i])) return false;
+			}
+			for (int32 i = 0; i < 3; ++i) {
+				if (!ResolveOne(std::format("scale_{}", i), Scale[i])) return false;
+				if (!ResolveOne(std::format("f_dc_{}", i), Dc[i])) return false;
+			}
+			if (!ResolveOne("opacity", Opacity)) return false;
+			// channel major, as many per channel as the degree the file was trained with; missing bands decode as zero
+			const int32 FileRest = Header.Properties.FilterByPredicate([](const PLY::FPlyProperty& Property) { return Property.Name.rfind("f_rest_", 0) == 0; }).Num() / 3;
+			NumRest = FMath::Min(NumShRest, FileRest);
+			for (int32 i = 0; i < 45; ++i) {
+				Rest[i] = 0;
+				const int32 Channel = i / 15;
+				const int32 j = i % 15;
+				if (j < NumRest && !ResolveOne(std::format("f_rest_{}", Channel * FileRest + j), Rest[i])) return false;
+			}
+
+			Stride = Header.Stride;
+			return true;
+		}
+	};
+
+	// Position, rotation and SH need no activation and are copied straight from the record.
+	// Coefficients above GSData.ShDegree are not read, the slots they share with used ones are zeroed.
+	FORCEINLINE void DecodeVertexRecord(const FVertexLayout& Layout, const uint8* Record, UINT i, PLY::FGaussSplatVertex& GSData)
+	{
+		const int32 NumBandStreams = PLY::GetNumShBandStreams(GSData.ShDegree);
+
+		// rest coefficient j of a channel
+		auto Rest = [&](int32 Channel, int32 j)
+			{
+				return j < Layout.NumRest ? ReadFloat(Record, Layout.Rest[Channel * 15 + j]) : 0.f;
+			};
+
+		for (int32 k = 0; k < 7; ++k) {
+			GSData.posrot[i * 7 + k] = ReadFloat(Record, Layout.PosRot[k]);
+		}
+
+		for (int32 c = 0; c < 3; ++c) {
+			GSData.sh0[i * 3 + c] = FVector4f(ReadFloat(Record, Layout.Dc[c]), Rest(c, 0), Rest(c, 1), Rest(c, 2));
+		}
+
+		for (int32 band = 0; band < NumBandStreams; ++band) {
+			const int32 j = 3 + band * 4;
+			GSData.r_sh1_4[band][i] = FVector4f(Rest(0, j), Rest(0, j + 1), Rest(0, j + 2), Rest(0, j + 3));
+			GSData.g_sh1_4[band][i] = FVector4f(Rest(1, j), Rest(1, j + 1), Rest(1, j + 2), Rest(1, j + 3));
+			GSData.b_sh1_4[band][i] = FVector4f(Rest(2, j), Rest(2, j + 1), Rest(2, j + 2), Rest(2, j + 3));
+		}
+	}
+
+	// Decodes [Begin, End) from the raw vertex block into GSData[i - OutBase].
+	// Particle i is record Order[i] when an order is given, record i otherwise.
+	void DecodeVertexRange(const FVertexLayout& Layout, const uint8* VertexData, const uint32* Order, UINT Begin, UINT End, UINT OutBase, PLY::FGaussSplatVertex& GSData)
+	{
+		for (UINT TileBegin = Begin; TileBegin < End; TileBegin += ActivationTileSize) {
+			const UINT TileEnd = FMath::Min<UINT>(TileBegin + ActivationTileSize, End);
+			const int32 TileCount = TileEnd - TileBegin;
+			const UINT OutBegin = TileBegin - OutBase;
+
+			// scale and opacity are gathered per tile and activated in batches
+			alignas(32) float ScaleX[ActivationTileSize];
+			alignas(32) float ScaleY[ActivationTileSize];
+			alignas(32) float ScaleZ[ActivationTileSize];
+			alignas(32) float Opacity[ActivationTileSize];
+
+			for (UINT i = TileBegin; i < TileEnd; ++i) {
+				const uint8* Record = VertexData + (int64)(Order ? Order[i] : i) * Layout.Stride;
+				const int32 t = i - TileBegin;
+				ScaleX[t] = ReadFloat(Record, Layout.Scale[0]);
+				ScaleY[t] = ReadFloat(Record, Layout.Scale[1]);
+				ScaleZ[t] = ReadFloat(Record, Layout.Scale[2]);
+				Opacity[t] = ReadFloat(Record, Layout.Opacity);
+				DecodeVertexRecord(Layout, Record, OutBegin + t, GSData);
+			}
+
+			GSKernels::ActivateScale(ScaleX, ScaleX, TileCount);
+			GSKernels::ActivateScale(ScaleY, ScaleY, TileCount);
+			GSKernels::ActivateScale(ScaleZ, ScaleZ, TileCount);
+			GSKernels::ActivateOpacity(Opacity, Opacity, TileCount);
+
+			for (int32 t = 0; t < TileCount; ++t) {
+				GSData.scl[OutBegin + t] = FVector4f(ScaleX[t], ScaleY[t], ScaleZ[t], Opacity[t]);
+			}
+		}
+	}
+
+	// Single pass over the vertex block : every record is read once and scattered to all streams.
+	// Work is split over particle ranges so it scales with the worker count.
+	// Decodes particles [Begin, Begin + NumParticles) of Order (or of the file when Order is null) into GSData[0, NumParticles).
+	void DecodeVertexBlock(const FVertexLayout& Layout, const uint8* VertexData, const uint32* Order, UINT Begin, UINT NumParticles, int32 ShDegree, PLY::FGaussSplatVertex& GSData)
+	{
+		PLY::AllocateStreams(GSData, NumParticles, ShDegree);
+
+		const int32 NumWorkers = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+		// whole activation tiles only, so the output does not depend on the worker count
+		const int32 BatchSize = Align(FMath::Max<int32>(MinDecodeBatchSize, FMath::DivideAndRoundUp<int32>(NumParticles, NumWorkers * 4)), ActivationTileSize);
+		const int32 NumBatches = FMath::DivideAndRoundUp<int32>(NumParticles, BatchSize);
+
+		ParallelFor(NumBatches, [&](int32 BatchIdx)
+			{
+				const UINT BatchBegin = BatchIdx * BatchSize;
+				const UINT BatchEnd = FMath::Min<UINT>(BatchBegin + BatchSize, NumParticles);
+				DecodeVertexRange(Layout, VertexData, Order, Begin + BatchBegin, Begin + BatchEnd, Begin, GSData);
+			});
+	}
+
+	// log(sigmoid(opacity) * scale_0 * scale_1 * scale_2) : large, opaque splats rank first
+	FORCEINLINE float GetImportance(const FVertexLayout& Layout, const uint8* Record)
+	{
+		const float Opacity = ReadFloat(Record, Layout.Opacity);
+		const float LogSigmoid = FMath::Min(Opacity, 0.f) - FMath::Loge(1.f + FMath::Exp(-FMath::Abs(Opacity)));
+		return LogSigmoid + ReadFloat(Record, Layout.Scale[0]) + ReadFloat(Record, Layout.Scale[1]) + ReadFloat(Record, Layout.Scale[2]);
+	}
+
+	// Counting sort on a quantized importance, descending. Reads 4 floats per record and keeps file order
+	// within a bucket, so the result is deterministic and linear in the particle count.
+	// Scratch and OutOrder come from Arena.
+	TArrayView64<uint32> ComputeImportanceOrder(const FVertexLayout& Layout, const uint8* VertexData, UINT NumParticles, GSLoadArena::FArena& Arena)
+	{
+		constexpr int32 NumBuckets = 4096;
+
+		const TArrayView64<float> Importance = Arena.AllocArray<float>(NumParticles);
+		ParallelFor(FMath::DivideAndRoundUp<int32>(NumParticles, MinDecodeBatchSize), [&](int32 BatchIdx)
+			{
+				const UINT Begin = BatchIdx * MinDecodeBatchSize;
+				const UINT End = FMath::Min<UINT>(Begin + MinDecodeBatchSize, NumParticles);
+				for (UINT i = Begin; i < End; ++i) {
+					Importance[i] = GetImportance(Layout, VertexData + (int64)i * Layout.Stride);
+				}
+			});
+
+		float MinValue = MAX_flt;
+		float MaxValue = -MAX_flt;
+		for (float Value : Importance) {
+			if (FMath::IsFinite(Value)) {
+				MinValue = FMath::Min(MinValue, Value);
+				MaxValue = FMath::Max(MaxValue, Value);
+			}
+		}
+		const float Scale = MaxValue > MinValue ? (NumBuckets - 1) / (MaxValue - MinValue) : 0.f;
+
+		// non finite values go last
+		auto GetBucket = [&](float Value)
+			{
+				return FMath::IsFinite(Value) ? FMath::Clamp((int32)((MaxValue - Value) * Scale), 0, NumBuckets - 1) : NumBuckets - 1;
+			};
+
+		uint32 Offsets[NumBuckets + 1] = {};
+		for (float Value : Importance) {
+			++Offsets[GetBucket(Value) + 1];
+		}
+		for (int32 b = 0; b < NumBuckets; ++b) {
+			Offsets[b + 1] += Offsets[b];
+		}
+
+		const TArrayView64<uint32> OutOrder = Arena.AllocArray<uint32>(NumParticles);
+		for (UINT i = 0; i < NumParticles; ++i) {
+			OutOrder[Offsets[GetBucket(Importance[i])]++] = i;
+		}
+		return OutOrder;
+	}
+
+	/*
+	*  Mapped PLY with a resolved layout, the region stays valid while the object is alive
+	*/
+	struct FMappedPly
+	{
+		// the region has to be released before the handle, keep this declaration order
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+		PLY::FPlyHeader Header;
+		FVertexLayout Layout;
+		const uint8* VertexData = nullptr;
+
+		bool Open(const FString& Filename, int32 ShDegree)
+		{
+			if (!OpenHeader(Filename, ShDegree)) {
+				return false;
+			}
+			MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+			if (!MappedRegion) {
+				return false;
+			}
+
+			VertexData = MappedRegion->GetMappedPtr() + Header.DataOffset;
+			return true;
+		}
+
+		// Header and layout only, the vertex block is then mapped a range at a time by MapVertices
+		bool OpenHeader(const FString& Filename, int32 ShDegree)
+		{
+			MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+			if (!MappedFile) {
+				return false;
+			}
+
+			// a few KB of text ahead of the vertex block
+			constexpr int64 MaxHeaderSize = 64 * 1024;
+			const int64 FileSize = MappedFile->GetFileSize();
+			{
+				TUniquePtr<IMappedFileRegion> HeaderRegion(MappedFile->MapRegion(0, FMath::Min(FileSize, MaxHeaderSize)));
+				if (!HeaderRegion || !Header.Parse(HeaderRegion->GetMappedPtr(), HeaderRegion->GetMappedSize())) {
+					return false;
+				}
+			}
+			if (Header.DataOffset + (int64)(Header.NumVertices * Header.Stride) > FileSize) {
+				return false;
+			}
+			return Layout.Resolve(Header, PLY::GetNumShRest(ShDegree));
+		}
+
+		// records [Begin, Begin + Num) of an OpenHeader file, valid until the next call. The previous range is
+		// unmapped first, so the process only keeps one range of the file resident.
+		const uint8* MapVertices(UINT Begin, UINT Num)
+		{
+			MappedRegion.Reset();
+			MappedRegion.Reset(MappedFile->MapRegion(Header.DataOffset + (int64)Begin * Header.Stride, (int64)Num * Header.Stride));
+			return MappedRegion ? MappedRegion->GetMappedPtr() : nullptr;
+		}
+	};
+
+	/*
+	*  Staging slice of LoadPlyFileSliced. The references handed out share a deleter which triggers Released
+	*  instead of deleting, and keeps the slot alive past the load.
+	*/
+	struct FSliceSlot
+	{
+		PLY::FGaussSplatVertex GSData;
+		FEvent* Released = FPlatformProcess::GetSynchEventFromPool(false);
+		bool bInFlight = false;
+
+		~FSliceSlot()
+		{
+			FPlatformProcess::ReturnSynchEventToPool(Released);
+		}
+	};
+
+	FORCEINLINE uint32 Part1By2(uint32 X)
+	{
+		X &= 0x3FF;
+		X = (X | (X << 16)) & 0x30000FF;
+		X = (X | (X << 8)) & 0x300F00F;
+		X = (X | (X << 4)) & 0x30C30C3;
+		X = (X | (X << 2)) & 0x9249249;
+		return X;
+	}
+
+	template<typename ArrayType>
+	bool IsSameStream(const ArrayType& A, const ArrayType& B)
+	{
+		return A.Num() == B.Num() && FMemory::Memcmp(A.GetData(), B.GetData(), A.GetResourceDataSize()) == 0;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace PLY
+{
+	bool FPlyHeader::Parse(const uint8* Data, int64 Size)
+	{
+		NumVertices = 0;
+		Stride = 0;
+		DataOffset = 0;
+		Properties.Reset();
+
+		bool bBinaryLittleEndian = false;
+		bool bSeenVertex = false;
+		bool bInVertex = false;
+
+		int64 LineStart = 0;
+		while (LineStart < Size) {
+			int64 LineEnd = LineStart;
+			while (LineEnd < Size && Data[LineEnd] != '\n') {
+				++LineEnd;
+			}
+			if (LineEnd >= Size) {
+				return false;
+			}
+
+			std::string Line(reinterpret_cast<const char*>(Data + LineStart), LineEnd - LineStart);
+			if (!Line.empty() && Line.back() == '\r') {
+				Line.pop_back();
+			}
+			LineStart = LineEnd + 1;
+
+			std::istringstream Tokens(Line);
+			std::string Keyword;
+			Tokens >> Keyword;
+
+			if (Keyword == "format") {
+				std::string Format;
+				Tokens >> Format;
+				bBinaryLittleEndian = (Format == "binary_little_endian");
+			}
+			else if (Keyword == "element") {
+				std::string Name;
+				uint64 Count = 0;
+				Tokens >> Name >> Count;
+				if (Name == "vertex") {
+					bSeenVertex = bInVertex = true;
+					NumVertices = Count;
+				}
+				else if (!bSeenVertex) {
+					// vertex block would not start at the end of the header
+					return false;
+				}
+				else {
+					bInVertex = false;
+				}
+			}
+			else if (Keyword == "property" && bInVertex) {
+				std::string Type, Name;
+				Tokens >> Type >> Name;
+
+				FPlyProperty Property;
+				Property.Name = Name;
+				Property.Offset = Stride;
+				Property.bIsFloat = (Type == "float" || Type == "float32");
+
+				if (Type == "char" || Type == "uchar" || Type == "int8" || Type == "uint8") Property.Size = 1;
+				else if (Type == "short" || Type == "ushort" || Type == "int16" || Type == "uint16") Property.Size = 2;
+				else if (Type == "int" || Type == "uint" || Type == "int32" || Type == "uint32" || Property.bIsFloat) Property.Size = 4;
+				else if (Type == "double" || Type == "float64") Property.Size = 8;
+				else return false;	// list properties have no fixed stride
+
+				Stride += Property.Size;
+				Properties.Add(MoveTemp(Property));
+			}
+			else if (Keyword == "end_header") {
+				DataOffset = LineStart;
+				return bBinaryLittleEndian && bSeenVertex && Stride > 0 && NumVertices * 7 <= (uint64)MAX_int32;
+			}
+		}
+		return false;
+	}
+
+	const FPlyProperty* FPlyHeader::Find(const std::string& Name) const
+	{
+		return Properties.FindByPredicate([&Name](const FPlyProperty& Property) { return Property.Name == Name; });
+	}
+
+
+	bool LoadPlyFile(const FString& Filename, FGaussSplatVertex& GSData, int32 ShDegree)
+	{
+		if (GSCompressed::IsCompressedFile(Filename)) {
+			return GSCompressed::LoadFile(Filename, GSData, ShDegree);
+		}
+
+		if (CVarPlyMemoryMapped.GetValueOnAnyThread() != 0) {
+			if (LoadPlyFileMapped(Filename, GSData, ShDegree)) {
+				if (CVarPlyVerifyMappedLoad.GetValueOnAnyThread() != 0) {
+					FGaussSplatVertex Reference;
+					if (!LoadPlyFileStream(Filename, Reference, ShDegree) || !IsIdentical(GSData, Reference)) {
+						UE_LOG(LogGSLoader, Error, TEXT("memory-mapped load of \"%s\" does not match the stream loader"), *Filename);
+					}
+					else {
+						UE_LOG(LogGSLoader, Log, TEXT("memory-mapped load of \"%s\" verified (%u particles)"), *Filename, GSData.NumParticles);
+					}
+				}
+				return true;
+			}
+			UE_LOG(LogGSLoader, Warning, TEXT("could not map \"%s\", falling back to the stream loader"), *Filename);
+		}
+		return LoadPlyFileStream(Filename, GSData, ShDegree);
+	}
+
+	bool LoadPlyFileMapped(const FString& Filename, FGaussSplatVertex& GSData, int32 ShDegree)
+	{
+		FMappedPly Ply;
+		if (!Ply.Open(Filename, ShDegree)) {
+			return false;
+		}
+
+		DecodeVertexBlock(Ply.Layout, Ply.VertexData, nullptr, 0, (UINT)Ply.Header.NumVertices, ShDegree, GSData);
+		return true;
+	}
+
+	bool LoadPlyFileProgressive(const FString& Filename, UINT ChunkSize, int32 ShDegree, TFunctionRef<bool(const FSplatChunkRef& Chunk, UINT NumTotal)> OnChunk)
+	{
+		GSLoadArena::FLoadScope LoadScope(Filename);
+
+		if (GSCompressed::IsCompressedFile(Filename)) {
+			// Morton ordered, no importance to go by : one chunk
+			FSplatChunkRef Chunk = GSLoadArena::AcquireStreams();
+			if (!GSCompressed::LoadFile(Filename, *Chunk, ShDegree)) {
+				return false;
+			}
+			return OnChunk(Chunk, Chunk->NumParticles);
+		}
+
+		FMappedPly Ply;
+		if (!Ply.Open(Filename, ShDegree)) {
+			return false;
+		}
+
+		const UINT NumTotal = (UINT)Ply.Header.NumVertices;
+		const GSLoadArena::FScratchRef Scratch = GSLoadArena::Acquire();
+		const TArrayView64<uint32> Order = ComputeImportanceOrder(Ply.Layout, Ply.VertexData, NumTotal, Scratch->Arena);
+
+		// chunks come from the pool too, they return to it once uploaded
+		ChunkSize = Align(FMath::Max<UINT>(ChunkSize, ActivationTileSize), ActivationTileSize);
+		for (UINT Begin = 0; Begin < NumTotal; Begin += ChunkSize) {
+			FSplatChunkRef Chunk = GSLoadArena::AcquireStreams();
+			DecodeVertexBlock(Ply.Layout, Ply.VertexData, Order.GetData(), Begin, FMath::Min(ChunkSize, NumTotal - Begin), ShDegree, *Chunk);
+			if (!OnChunk(Chunk, NumTotal)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64 GetSliceWindowBytes(UINT SliceSize, int32 ShDegree)
+	{
+		SliceSize = Align(FMath::Max<UINT>(SliceSize, ActivationTileSize), ActivationTileSize);
+
+		uint64 SliceBytes = 0;
+		for (int32 s = 0; s < SplatStream_Count; ++s) {
+			// large allocations are rounded up to whole pages by the allocator
+			SliceBytes += IsStreamUsed(s, ShDegree) ? Align((uint64)SliceSize * GetStreamStride(s), 64 * 1024) : 0;
+		}
+		return NumSliceStaging * SliceBytes;
+	}
+
+	bool LoadPlyFileSliced(const FString& Filename, UINT SliceSize, int32 ShDegree, TFunctionRef<bool(const FSplatChunkRef& Slice, UINT NumTotal)> OnSlice, FSliceStats* OutStats,
+		const std::atomic<bool>* Canceled)
+	{
+		GSLoadArena::FLoadScope LoadScope(Filename);
+
+		FMappedPly Ply;
+		if (!Ply.OpenHeader(Filename, ShDegree)) {
+			return false;
+		}
+
+		// not pooled : the window is the whole budget, it goes once the load and the last upload are done
+		using FSliceSlotRef = TSharedRef<FSliceSlot, ESPMode::ThreadSafe>;
+		FSliceSlotRef Staging[NumSliceStaging] = { MakeShared<FSliceSlot, ESPMode::ThreadSafe>(), MakeShared<FSliceSlot, ESPMode::ThreadSafe>() };
+
+		const UINT NumTotal = (UINT)Ply.Header.NumVertices;
+		SliceSize = Align(FMath::Max<UINT>(SliceSize, ActivationTileSize), ActivationTileSize);
+
+		auto GetStagingBytes = [&Staging]()
+			{
+				uint64 Bytes = 0;
+				for (const FSliceSlotRef& Slot : Staging) {
+					const FGaussSplatVertex& Slice = Slot->GSData;
+					Bytes += Slice.posrot.GetAllocatedSize() + Slice.scl.GetAllocatedSize() + Slice.sh0.GetAllocatedSize();
+					for (int i = 0; i < 3; ++i) {
+						Bytes += Slice.r_sh1_4[i].GetAllocatedSize() + Slice.g_sh1_4[i].GetAllocatedSize() + Slice.b_sh1_4[i].GetAllocatedSize();
+					}
+				}
+				return Bytes;
+			};
+
+		FSliceStats Stats;
+		bool bDelivered = true;
+		for (UINT Begin = 0, SliceIdx = 0; Begin < NumTotal && bDelivered; Begin += SliceSize, ++SliceIdx) {
+			const FSliceSlotRef& Slot = Staging[SliceIdx % NumSliceStaging];
+
+			// still being uploaded : wait for its last reference to go, or for the load to be canceled
+			if (Slot->bInFlight) {
+				while (!Slot->Released->Wait(10)) {
+					if (Canceled && *Canceled) {
+						return false;
+					}
+				}
+				Slot->bInFlight = false;
+			}
+
+			const uint32 SliceStartAllocations = LoadScope.GetNumAllocations();
+			const UINT Num = FMath::Min(SliceSize, NumTotal - Begin);
+			const uint8* VertexData = Ply.MapVertices(Begin, Num);
+			if (!VertexData) {
+				return false;
+			}
+			DecodeVertexBlock(Ply.Layout, VertexData, nullptr, 0, Num, ShDegree, Slot->GSData);
+			Stats.PeakStagingBytes = FMath::Max(Stats.PeakStagingBytes, GetStagingBytes());
+
+			Slot->bInFlight = true;
+			const FSplatChunkRef Slice(&Slot->GSData, [SlotRef = FSliceSlotRef(Slot)](FGaussSplatVertex*) { SlotRef->Released->Trigger(); });
+			if (SliceIdx >= NumSliceStaging) {
+				Stats.MaxSliceAllocations = FMath::Max(Stats.MaxSliceAllocations, LoadScope.GetNumAllocations() - SliceStartAllocations);
+			}
+			bDelivered = OnSlice(Slice, NumTotal) && !(Canceled && *Canceled);
+		}
+
+		if (OutStats) {
+			Stats.NumAllocations = LoadScope.GetNumAllocations();
+			*OutStats = Stats;
+		}
+		return bDelivered;
+	}
+
+	bool LoadPlyFileStream(const FString& Filename, FGaussSplatVertex& GSData, int32 ShDegree)
+	{
+		std::ifstream stream(*Filename, std::ios::in | std::ios::binary);
+		if (!stream.is_open()) {
+			return false;
+		}
+
+		// read the header text only to resolve attribute offsets, FAttributeCollection re-reads it
+		std::string HeaderText;
+		for (std::string Line; std::getline(stream, Line); ) {
+			HeaderText += Line;
+			HeaderText += '\n';
+			if (Line.rfind("end_header", 0) == 0) {
+				break;
+			}
+		}
+
+		FPlyHeader Header;
+		FVertexLayout Layout;
+		if (!Header.Parse(reinterpret_cast<const uint8*>(HeaderText.data()), HeaderText.size()) || !Layout.Resolve(Header, GetNumShRest(ShDegree))) {
+			return false;
+		}
+
+		stream.clear();
+		stream.seekg(0);
+
+		Ply3DGS::FAttributeCollection collection;
+		Ply3DGS::EPlyErrorCode error = collection.LoadFromStream(stream);
+		if (error != Ply3DGS::EPlyErrorCode::PLY_OK || collection.GetParticleCount() != Header.NumVertices) {
+			return false;
+		}
+
+		DecodeVertexBlock(Layout, reinterpret_cast<const uint8*>(collection.GetData()), nullptr, 0, (UINT)Header.NumVertices, ShDegree, GSData);
+		return true;
+	}
+
+	/*
+	*  FPagedPlyFile
+	*/
+	struct FPagedPlyFile::FImpl
+	{
+		FMappedPly Ply;
+	};
+
+	FPagedPlyFile::FPagedPlyFile() = default;
+	FPagedPlyFile::~FPagedPlyFile() = default;
+
+	bool FPagedPlyFile::Open(const FString& Filename, UINT InPageSize, int32 InShDegree)
+	{
+		GSLoadArena::FLoadScope LoadScope(Filename);
+		Impl = MakeUnique<FImpl>();
+		if (!Impl->Ply.Open(Filename, InShDegree)) {
+			Impl.Reset();
+			return false;
+		}
+
+		const FVertexLayout& Layout = Impl->Ply.Layout;
+		const uint8* VertexData = Impl->Ply.VertexData;
+		auto GetPos = [&](UINT i)
+			{
+				const uint8* Record = VertexData + (int64)i * Layout.Stride;
+				return FVector3f(ReadFloat(Record, Layout.PosRot[0]), ReadFloat(Record, Layout.PosRot[1]), ReadFloat(Record, Layout.PosRot[2]));
+			};
+
+		NumParticles = (UINT)Impl->Ply.Header.NumVertices;
+		PageSize = Align(FMath::Max<UINT>(InPageSize, ActivationTileSize), ActivationTileSize);
+		ShDegree = InShDegree;
+
+		FBox3f Bounds(ForceInit);
+		for (UINT i = 0; i < NumParticles; ++i) {
+			Bounds += GetPos(i);
+		}
+		const FVector3f Extent = Bounds.GetSize().ComponentMax(FVector3f(UE_SMALL_NUMBER));
+
+		const GSLoadArena::FScratchRef Scratch = GSLoadArena::Acquire();
+		const TArrayView64<uint64> Keys = Scratch->Arena.AllocArray<uint64>(NumParticles);
+		ParallelFor(NumParticles, [&](int32 i)
+			{
+				const FVector3f T = (GetPos(i) - Bounds.Min) / Extent * 1023.f;
+				const uint32 Code = Part1By2((uint32)T.X) | (Part1By2((uint32)T.Y) << 1) | (Part1By2((uint32)T.Z) << 2);
+				Keys[i] = ((uint64)Code << 32) | (uint32)i;
+			});
+		Algo::Sort(Keys);
+
+		const int32 NumPages = FMath::DivideAndRoundUp<int32>(NumParticles, PageSize);
+		Order.SetNumUninitialized(NumPages * PageSize);
+		for (UINT i = 0; i < NumParticles; ++i) {
+			Order[i] = (uint32)Keys[i];
+		}
+		for (int32 i = (int32)NumParticles; i < Order.Num(); ++i) {
+			Order[i] = Order[NumParticles - 1];
+		}
+
+		// raw positions as DecodePage uploads them, grown by the 3 sigma extent of every splat as the culling chunks
+		PageBounds.SetNumUninitialized(NumPages);
+		ParallelFor(NumPages, [&](int32 Page)
+			{
+				FBox3f PageBox(ForceInit);
+				const UINT End = FMath::Min<UINT>((Page + 1) * PageSize, NumParticles);
+				for (UINT i = Page * PageSize; i < End; ++i) {
+					const uint8* Record = VertexData + (int64)Order[i] * Layout.Stride;
+					const FVector3f LogScale(ReadFloat(Record, Layout.Scale[0]), ReadFloat(Record, Layout.Scale[1]), ReadFloat(Record, Layout.Scale[2]));
+					const FVector3f Extent(GSCull::GetRotatedSplatExtent(FVector3f(FMath::Exp(LogScale.GetMax()))));
+					const FVector3f P = GetPos(Order[i]);
+					PageBox += P - Extent;
+					PageBox += P + Extent;
+				}
+				PageBounds[Page] = PageBox;
+			});
+
+		return true;
+	}
+
+	void FPagedPlyFile::DecodePage(int32 Page, FGaussSplatVertex& GSData) const
+	{
+		check(Impl && Page >= 0 && Page < GetNumPages());
+
+		const UINT Begin = Page * PageSize;
+		DecodeVertexBlock(Impl->Ply.Layout, Impl->Ply.VertexData, Order.GetData(), Begin, PageSize, ShDegree, GSData);
+
+		// padding of the last page
+		for (UINT i = NumParticles; i < Begin + PageSize; ++i) {
+			GSData.scl[i - Begin].W = 0.f;
+		}
+	}
+
+
+	void AllocateStreams(FGaussSplatVertex& GSData, UINT NumParticles, int32 ShDegree)
+	{
+		check(ShDegree >= 0 && ShDegree <= MaxShDegree);
+
+		GSData.NumParticles = NumParticles;
+		GSData.ShDegree = ShDegree;
+		GSData.bCovariance = false;
+
+		auto Allocate = [](auto& Stream, UINT Num)
+			{
+				if ((UINT)Stream.Max() < Num) {
+					Stream.Reserve(Num);	// exact, no growth slack on buffers this size
+				}
+				Stream.SetNumUninitialized(Num, false);
+				Stream.SetAllowCPUAccess(true);
+			};
+
+		Allocate(GSData.posrot, NumParticles * 7);
+		Allocate(GSData.scl, NumParticles);
+		Allocate(GSData.sh0, NumParticles * 3);
+
+		const int32 NumBandStreams = GetNumShBandStreams(ShDegree);
+		for (int i = 0; i < 3; ++i) {
+			const UINT Num = i < NumBandStreams ? NumParticles : 0;
+			Allocate(GSData.r_sh1_4[i], Num);
+			Allocate(GSData.g_sh1_4[i], Num);
+			Allocate(GSData.b_sh1_4[i], Num);
+		}
+	}
+
+	FSplatStreams GetStreams(FGaussSplatVertex& GSData)
+	{
+		FSplatStreams Result;
+		Result.NumParticles = GSData.NumParticles;
+		Result.ShDegree = GSData.ShDegree;
+		Result.bCovariance = GSData.bCovariance;
+		Result.Streams[SplatStream_PosRot] = &GSData.posrot;
+		Result.Streams[SplatStream_Scale] = &GSData.scl;
+		Result.Streams[SplatStream_Sh0] = &GSData.sh0;
+
+		for (int i = 0; i < GetNumShBandStreams(GSData.ShDegree); ++i) {
+			Result.Streams[SplatStream_Sh1_4 + i * 3 + 0] = &GSData.r_sh1_4[i];
+			Result.Streams[SplatStream_Sh1_4 + i * 3 + 1] = &GSData.g_sh1_4[i];
+			Result.Streams[SplatStream_Sh1_4 + i * 3 + 2] = &GSData.b_sh1_4[i];
+		}
+		return Result;
+	}
+
+	uint32 GetStreamStride(int32 Stream)
+	{
+		switch (Stream) {
+		case SplatStream_PosRot:	return sizeof(float) * 7;
+		case SplatStream_Sh0:		return sizeof(FVector4f) * 3;
+		default:					return sizeof(FVector4f);
+		}
+	}
+
+	void ConvertToCovariance(float* PosRot, FVector4f* Scl, UINT NumParticles)
+	{
+		const int32 NumBatches = FMath::DivideAndRoundUp<int32>(NumParticles, MinDecodeBatchSize);
+		ParallelFor(NumBatches, [&](int32 BatchIdx)
+			{
+				const UINT BatchEnd = FMath::Min<UINT>((BatchIdx + 1) * MinDecodeBatchSize, NumParticles);
+				for (UINT TileBegin = BatchIdx * MinDecodeBatchSize; TileBegin < BatchEnd; TileBegin += ActivationTileSize) {
+					const int32 TileCount = FMath::Min<UINT>(TileBegin + ActivationTileSize, BatchEnd) - TileBegin;
+
+					// rotation and scale are gathered per tile, the covariance overwrites them in place
+					alignas(32) float Tile[7][ActivationTileSize];
+					for (int32 t = 0; t < TileCount; ++t) {
+						const float* Rot = PosRot + (TileBegin + t) * 7 + 3;
+						const FVector4f& Scale = Scl[TileBegin + t];
+						Tile[0][t] = Rot[0]; Tile[1][t] = Rot[1]; Tile[2][t] = Rot[2]; Tile[3][t] = Rot[3];
+						Tile[4][t] = Scale.X; Tile[5][t] = Scale.Y; Tile[6][t] = Scale.Z;
+					}
+
+					// trained quaternions are not unit length, ComputeCovariance wants them to be
+					GSKernels::NormalizeQuaternions(Tile[1], Tile[2], Tile[3], Tile[0], TileCount);
+
+					const float* const Rot[4] = { Tile[0], Tile[1], Tile[2], Tile[3] };
+					const float* const Scale[3] = { Tile[4], Tile[5], Tile[6] };
+					float* const Cov[6] = { Tile[0], Tile[1], Tile[2], Tile[3], Tile[4], Tile[5] };
+					GSKernels::ComputeCovariance(Rot, Scale, Cov, TileCount);
+
+					for (int32 t = 0; t < TileCount; ++t) {
+						float* Out = PosRot + (TileBegin + t) * 7 + 3;
+						FVector4f& OutScl = Scl[TileBegin + t];
+						Out[0] = Tile[0][t]; Out[1] = Tile[1][t]; Out[2] = Tile[2][t]; Out[3] = Tile[3][t];
+						OutScl = FVector4f(Tile[4][t], Tile[5][t], 0.f, OutScl.W);
+					}
+				}
+			});
+	}
+
+	void ConvertToCovariance(FGaussSplatVertex& GSData)
+	{
+		if (!GSData.bCovariance) {
+			ConvertToCovariance(GSData.posrot.GetData(), GSData.scl.GetData(), GSData.NumParticles);
+			GSData.bCovariance = true;
+		}
+	}
+
+	bool IsIdentical(const FGaussSplatVertex& A, const FGaussSplatVertex& B)
+	{
+		bool bSame = A.NumParticles == B.NumParticles
+			&& A.ShDegree == B.ShDegree
+			&& A.bCovariance == B.bCovariance
+			&& IsSameStream(A.posrot, B.posrot)
+			&& IsSameStream(A.scl, B.scl)
+			&& IsSameStream(A.sh0, B.sh0);
+
+		for (int i = 0; i < 3 && bSame; ++i) {
+			bSame = IsSameStream(A.r_sh1_4[i], B.r_sh1_4[i])
+				&& IsSameStream(A.g_sh1_4[i], B.g_sh1_4[i])
+				&& IsSameStream(A.b_sh1_4[i], B.b_sh1_4[i]);
+		}
+		return bSame;
+	}
+}	// namespace PLY
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// The attribute by attribute extraction the stream loader did before the fused decode, the reference both
+	// loaders are checked against. FileDegree is the degree the file was written with.
+	bool LoadPlyFileReference(const FString& Filename, int32 FileDegree, int32 ShDegree, PLY::FGaussSplatVertex& GSData)
+	{
+		std::ifstream stream(*Filename, std::ios::in | std::ios::binary);
+		Ply3DGS::FAttributeCollection collection;
+		if (!stream.is_open() || collection.LoadFromStream(stream) != Ply3DGS::EPlyErrorCode::PLY_OK) {
+			return false;
+		}
+
+		const UINT NumParticles = collection.GetParticleCount();
+		PLY::AllocateStreams(GSData, NumParticles, ShDegree);
+
+		bool bComplete = true;
+		auto GetArray = [&](const std::string& Name)
+			{
+				std::vector<float> Values;
+				collection.GetAttributeArray<float>(Name, Values);
+				bComplete &= Values.size() == NumParticles;
+				Values.resize(NumParticles);
+				return Values;
+			};
+
+		static const char* PosRotNames[7] = { "x", "y", "z", "rot_0", "rot_1", "rot_2", "rot_3" };
+		for (int32 k = 0; k < 7; ++k) {
+			const std::vector<float> Values = GetArray(PosRotNames[k]);
+			for (UINT i = 0; i < NumParticles; ++i) {
+				GSData.posrot[i * 7 + k] = Values[i];
+			}
+		}
+
+		const std::vector<float> ScaleX = GetArray("scale_0");
+		const std::vector<float> ScaleY = GetArray("scale_1");
+		const std::vector<float> ScaleZ = GetArray("scale_2");
+		const std::vector<float> Opacity = GetArray("opacity");
+		for (UINT i = 0; i < NumParticles; ++i) {
+			GSData.scl[i] = FVector4f(FMath::Exp(ScaleX[i]), FMath::Exp(ScaleY[i]), FMath::Exp(ScaleZ[i]), 1.f / (1.f + FMath::Exp(-Opacity[i])));
+		}
+
+		// per channel, f_rest_* the file does not store or ShDegree does not use are zero
+		const int32 FileRest = PLY::GetNumShRest(FileDegree);
+		const int32 NumRest = FMath::Min(FileRest, PLY::GetNumShRest(ShDegree));
+		std::vector<float> Rest[3][15];
+		for (int32 c = 0; c < 3; ++c) {
+			for (int32 j = 0; j < 15; ++j) {
+				Rest[c][j] = j < NumRest ? GetArray(std::format("f_rest_{}", c * FileRest + j)) : std::vector<float>(NumParticles, 0.f);
+			}
+		}
+
+		for (int32 c = 0; c < 3; ++c) {
+			const std::vector<float> Dc = GetArray(std::format("f_dc_{}", c));
+			for (UINT i = 0; i < NumParticles; ++i) {
+				GSData.sh0[i * 3 + c] = FVector4f(Dc[i], Rest[c][0][i], Rest[c][1][i], Rest[c][2][i]);
+			}
+		}
+
+		for (int32 band = 0; band < PLY::GetNumShBandStreams(ShDegree); ++band) {
+			TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>* Streams[3] = { &GSData.r_sh1_4[band], &GSData.g_sh1_4[band], &GSData.b_sh1_4[band] };
+			const int32 j = 3 + band * 4;
+			for (int32 c = 0; c < 3; ++c) {
+				for (UINT i = 0; i < NumParticles; ++i) {
+					(*Streams[c])[i] = FVector4f(Rest[c][j][i], Rest[c][j + 1][i], Rest[c][j + 2][i], Rest[c][j + 3][i]);
+				}
+			}
+		}
+		return bComplete;
+	}
+
+	FORCEINLINE bool IsWithinUlp(float A, float B, int32 MaxUlp)
+	{
+		auto ToOrdered = [](float F)
+			{
+				int32 I;
+				FMemory::Memcpy(&I, &F, sizeof(float));
+				return I < 0 ? (int64)MIN_int32 - I : (int64)I;
+			};
+		return FMath::Abs(ToOrdered(A) - ToOrdered(B)) <= MaxUlp;
+	}
+
+	// bit for bit but for scale and opacity, which GSKernels activates within its ULP bounds of FMath
+	bool MatchesReference(const PLY::FGaussSplatVertex& GSData, const PLY::FGaussSplatVertex& Reference)
+	{
+		bool bSame = GSData.NumParticles == Reference.NumParticles
+			&& GSData.ShDegree == Reference.ShDegree
+			&& GSData.bCovariance == Reference.bCovariance
+			&& IsSameStream(GSData.posrot, Reference.posrot)
+			&& IsSameStream(GSData.sh0, Reference.sh0)
+			&& GSData.scl.Num() == Reference.scl.Num();
+
+		for (int i = 0; i < 3 && bSame; ++i) {
+			bSame = IsSameStream(GSData.r_sh1_4[i], Reference.r_sh1_4[i])
+				&& IsSameStream(GSData.g_sh1_4[i], Reference.g_sh1_4[i])
+				&& IsSameStream(GSData.b_sh1_4[i], Reference.b_sh1_4[i]);
+		}
+		for (int32 i = 0; i < GSData.scl.Num() && bSame; ++i) {
+			const FVector4f& A = GSData.scl[i];
+			const FVector4f& B = Reference.scl[i];
+			bSame = IsWithinUlp(A.X, B.X, GSKernels::ExpMaxUlp) && IsWithinUlp(A.Y, B.Y, GSKernels::ExpMaxUlp)
+				&& IsWithinUlp(A.Z, B.Z, GSKernels::ExpMaxUlp) && IsWithinUlp(A.W, B.W, GSKernels::SigmoidMaxUlp);
+		}
+		return bSame;
+	}
+}
+
+/*
+*  Memory-mapped and stream loads against the per-attribute reference extraction, on small synthetic files of every
+*  SH degree, loaded at their own degree and below
+*/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGSPlyMappedLoadTest, "GSRuntime.Ply.MappedLoad",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::EngineFilter)
+
+bool FGSPlyMappedLoadTest::RunTest(const FString& Parameters)
+{
+	// not a multiple of the decode batches and activation tiles
+	constexpr int32 NumSplats = 2 * MinDecodeBatchSize + ActivationTileSize / 2 + 3;
+
+	for (int32 FileDegree = 0; FileDegree <= PLY::MaxShDegree; ++FileDegree) {
+		const FString Filename = FPaths::Combine(FPaths::AutomationTransientDir(), FString::Printf(TEXT("GSPlyMappedLoad_sh%d.ply"), FileDegree));
+		if (!TestTrue(FString::Printf(TEXT("write %s"), *Filename), UGSLoaderBenchmarkCommandlet::WriteSyntheticPly(Filename, NumSplats, FileDegree, FileDegree + 1))) {
+			continue;
+		}
+
+		for (int32 ShDegree = 0; ShDegree <= FileDegree; ++ShDegree) {
+			PLY::FGaussSplatVertex Reference, Mapped, Stream;
+			const bool bReference = LoadPlyFileReference(Filename, FileDegree, ShDegree, Reference);
+			const bool bMapped = PLY::LoadPlyFileMapped(Filename, Mapped, ShDegree);
+			const bool bStream = PLY::LoadPlyFileStream(Filename, Stream, ShDegree);
+			TestTrue(FString::Printf(TEXT("SH%d file at SH%d : every path loads"), FileDegree, ShDegree), bReference && bMapped && bStream);
+			TestEqual(FString::Printf(TEXT("SH%d file at SH%d : particle count"), FileDegree, ShDegree), (int32)Reference.NumParticles, NumSplats);
+			TestTrue(FString::Printf(TEXT("SH%d file at SH%d : mapped matches the reference"), FileDegree, ShDegree), MatchesReference(Mapped, Reference));
+			TestTrue(FString::Printf(TEXT("SH%d file at SH%d : stream matches the reference"), FileDegree, ShDegree), MatchesReference(Stream, Reference));
+			TestTrue(FString::Printf(TEXT("SH%d file at SH%d : PLY::IsIdentical"), FileDegree, ShDegree), PLY::IsIdentical(Mapped, Stream));
+		}
+
+		IFileManager::Get().Delete(*Filename);
+	}
+	return true;
+}
+
+/*
+*  LoadPlyFileSliced : slices identical to the mapped load, staging within GetSliceWindowBytes while a consumer holds
+*  the previous slice (the growth of the process is only reported), and a load canceled while every slice is held
+*  returns instead of waiting forever
+*/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGSPlySlicedLoadTest, "GSRuntime.Ply.SlicedLoad",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::EngineFilter)
+
+bool FGSPlySlicedLoadTest::RunTest(const FString& Parameters)
+{
+	// a file several times larger than the bound, so a load that is not sliced cannot pass
+	constexpr int32 NumSplats = 256 * 1024;
+	constexpr UINT SliceSize = 16 * 1024;
+	constexpr int32 ShDegree = PLY::MaxShDegree;
+	constexpr uint64 SlackBytes = 16 * 1024 * 1024;
+
+	const FString Filename = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("GSPlySlicedLoad.ply"));
+	if (!TestTrue(TEXT("write the PLY"), UGSLoaderBenchmarkCommandlet::WriteSyntheticPly(Filename, NumSplats, ShDegree, 7))) {
+		return false;
+	}
+	ON_SCOPE_EXIT{ IFileManager::Get().Delete(*Filename); };
+
+	bool bIdentical = true;
+	UINT NumSliced = 0;
+	{
+		PLY::FGaussSplatVertex Reference;
+		if (!TestTrue(TEXT("mapped load"), PLY::LoadPlyFileMapped(Filename, Reference, ShDegree))) {
+			return false;
+		}
+
+		TOptional<PLY::FSplatChunkRef> Previous;
+		PLY::LoadPlyFileSliced(Filename, SliceSize, ShDegree, [&](const PLY::FSplatChunkRef& Slice, UINT NumTotal)
+			{
+				const UINT Num = Slice->NumParticles;
+				bIdentical &= NumSliced + Num <= Reference.NumParticles
+					&& FMemory::Memcmp(Slice->posrot.GetData(), &Reference.posrot[NumSliced * 7], Num * 7 * sizeof(float)) == 0
+					&& FMemory::Memcmp(Slice->scl.GetData(), &Reference.scl[NumSliced], Num * sizeof(FVector4f)) == 0
+					&& FMemory::Memcmp(Slice->sh0.GetData(), &Reference.sh0[NumSliced * 3], Num * 3 * sizeof(FVector4f)) == 0;
+				NumSliced += Num;
+				Previous = Slice;
+				return true;
+			});
+	}
+	TestEqual(TEXT("every splat delivered"), (int32)NumSliced, NumSplats);
+	TestTrue(TEXT("slices identical to the mapped load"), bIdentical);
+
+	// an upload holding the previous slice, as the actor does
+	{
+		const uint64 BaseUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		uint64 PeakUsedPhysical = BaseUsedPhysical;
+		PLY::FSliceStats Stats;
+		TOptional<PLY::FSplatChunkRef> Previous;
+		const bool bLoaded = PLY::LoadPlyFileSliced(Filename, SliceSize, ShDegree, [&](const PLY::FSplatChunkRef& Slice, UINT NumTotal)
+			{
+				PeakUsedPhysical = FMath::Max<uint64>(PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+				Previous = Slice;
+				return true;
+			}, &Stats);
+		TestTrue(TEXT("sliced load"), bLoaded);
+
+		const uint64 WindowBytes = PLY::GetSliceWindowBytes(SliceSize, ShDegree);
+		const uint64 BoundBytes = WindowBytes + (uint64)SliceSize * IFileManager::Get().FileSize(*Filename) / NumSplats + SlackBytes;
+		TestTrue(FString::Printf(TEXT("staging %llu within the %llu byte window"), Stats.PeakStagingBytes, WindowBytes), Stats.PeakStagingBytes <= WindowBytes);
+		// the process is shared with the editor and the other tests, its growth is for the record only
+		AddInfo(FString::Printf(TEXT("process grew by %llu bytes, %llu expected at most"), PeakUsedPhysical - BaseUsedPhysical, BoundBytes));
+		// the mapped range, the slice reference and the decode tasks, fewer than the streams a slice would reallocate
+		TestTrue(FString::Printf(TEXT("%u allocations, %u at most per reused slice"), Stats.NumAllocations, Stats.MaxSliceAllocations),
+			Stats.MaxSliceAllocations < PLY::SplatStream_Count);
+	}
+
+	// every slice kept : the load waits for a slot until it is canceled
+	{
+		std::atomic<bool> Canceled(false);
+		TArray<PLY::FSplatChunkRef> Held;
+		UE::Tasks::FTask Cancel = UE::Tasks::Launch(UE_SOURCE_LOCATION, [&Canceled]()
+			{
+				FPlatformProcess::Sleep(0.05f);
+				Canceled = true;
+			});
+		const bool bLoaded = PLY::LoadPlyFileSliced(Filename, SliceSize, ShDegree, [&Held](const PLY::FSplatChunkRef& Slice, UINT NumTotal)
+			{
+				Held.Add(Slice);
+				return true;
+			}, nullptr, &Canceled);
+		Cancel.Wait();
+
+		TestFalse(TEXT("canceled while waiting for a slice"), bLoaded);
+		TestEqual(TEXT("slices delivered before the wait"), Held.Num(), PLY::NumSliceStaging);
+	}
+	return true;
+}
+
+/*
+*  ConvertToCovariance against GSKernels::ComputeCovarianceReference, over a count with partial batches and tiles
+*/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGSPlyCovarianceTest, "GSRuntime.Ply.ConvertToCovariance",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::EngineFilter)
+
+bool FGSPlyCovarianceTest::RunTest(const FString& Parameters)
+{
+	constexpr UINT NumSplats = 3 * MinDecodeBatchSize + ActivationTileSize + 37;
+	FRandomStream Random(0xC0C0);
+
+	PLY::FGaussSplatVertex GSData;
+	PLY::AllocateStreams(GSData, NumSplats, 0);
+	for (UINT i = 0; i < NumSplats; ++i) {
+		float* PosRot = &GSData.posrot[i * 7];
+		const FVector3f Position = FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, 100.f);
+		// as trained : not unit length
+		const FQuat4f Rot = FQuat4f(FVector3f(Random.GetUnitVector()), Random.FRandRange(0.f, UE_TWO_PI)) * Random.FRandRange(0.2f, 5.f);
+		PosRot[0] = Position.X; PosRot[1] = Position.Y; PosRot[2] = Position.Z;
+		PosRot[3] = Rot.W; PosRot[4] = Rot.X; PosRot[5] = Rot.Y; PosRot[6] = Rot.Z;
+		GSData.scl[i] = FVector4f(FMath::Exp(Random.FRandRange(-8.f, 1.f)), FMath::Exp(Random.FRandRange(-8.f, 1.f)), FMath::Exp(Random.FRandRange(-8.f, 1.f)), Random.FRand());
+	}
+
+	PLY::FGaussSplatVertex Source;
+	PLY::AllocateStreams(Source, NumSplats, 0);
+	FMemory::Memcpy(Source.posrot.GetData(), GSData.posrot.GetData(), GSData.posrot.GetResourceDataSize());
+	FMemory::Memcpy(Source.scl.GetData(), GSData.scl.GetData(), GSData.scl.GetResourceDataSize());
+
+	PLY::ConvertToCovariance(GSData);
+	TestTrue(TEXT("flagged as covariance"), GSData.bCovariance);
+
+	float MaxError = 0.f;
+	bool bKept = true;
+	for (UINT i = 0; i < NumSplats; ++i) {
+		const float* In = &Source.posrot[i * 7];
+		const float* Out = &GSData.posrot[i * 7];
+		const FVector4f& InScl = Source.scl[i];
+		const FVector4f& OutScl = GSData.scl[i];
+
+		float Reference[6];
+		const FQuat4f Unit = FQuat4f(In[4], In[5], In[6], In[3]).GetNormalized();
+		const float Rot[4] = { Unit.W, Unit.X, Unit.Y, Unit.Z };
+		const float Scale[3] = { InScl.X, InScl.Y, InScl.Z };
+		GSKernels::ComputeCovarianceReference(Rot, Scale, Reference);
+
+		const float Cov[6] = { Out[3], Out[4], Out[5], Out[6], OutScl.X, OutScl.Y };
+		const float Variance = FMath::Max3(InScl.X * InScl.X, InScl.Y * InScl.Y, InScl.Z * InScl.Z);
+		for (int32 k = 0; k < 6; ++k) {
+			MaxError = FMath::Max(MaxError, FMath::Abs(Cov[k] - Reference[k]) / Variance);
+		}
+		bKept &= Out[0] == In[0] && Out[1] == In[1] && Out[2] == In[2] && OutScl.Z == 0.f && OutScl.W == InScl.W;
+	}
+	TestTrue(FString::Printf(TEXT("covariance within %g of the quaternion path, max %g"), GSKernels::CovarianceMaxError, MaxError), MaxError <= GSKernels::CovarianceMaxError);
+	TestTrue(TEXT("positions and opacity kept, scl.z cleared"), bKept);
+	return true;
+}
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
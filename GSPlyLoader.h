@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "Containers/DynamicRHIResourceArray.h"
+#include "Stats/Stats.h"
+#include <atomic>
+#include <string>
+
+DECLARE_LOG_CATEGORY_EXTERN(LogGSLoader, Log, All);
+DECLARE_STATS_GROUP(TEXT("GSLoader"), STATGROUP_GSLoader, STATCAT_Advanced);
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace PLY
+{
+	/*
+	*  GPU-ready splat streams, laid out exactly as AGSActor uploads them
+	*/
+	constexpr int32 MaxShDegree = 3;
+
+	struct FGaussSplatVertex
+	{
+		UINT NumParticles = 0;
+		int32 ShDegree = MaxShDegree;	// band streams above it are left empty, sh0.yzw is zero for degree 0
+		bool bCovariance = false;		// rotation and scale replaced by ConvertToCovariance
+		TResourceArray<float, VERTEXBUFFER_ALIGNMENT> posrot;		// x, y, z, rot_0 - rot_3			| x, y, z, cov xx, xy, xz, yy
+		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> scl;		// exp(scale_0 - scale_2), sigmoid(opacity)	| cov yz, zz, 0, sigmoid(opacity)
+
+		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> sh0;		// r, g, b interleaved per particle
+
+		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> r_sh1_4[3];
+		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> g_sh1_4[3];
+		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT> b_sh1_4[3];
+	};
+
+	/*
+	*  Vertex streams in upload order, shared by the PLY and the cooked (.gsplat) paths
+	*/
+	enum ESplatStream : int32
+	{
+		SplatStream_PosRot,
+		SplatStream_Scale,
+		SplatStream_Sh0,
+		SplatStream_Sh1_4,		// 9 streams : band * 3 + (r, g, b)
+		SplatStream_Count = SplatStream_Sh1_4 + 9,
+	};
+
+	struct FSplatStreams
+	{
+		UINT NumParticles = 0;
+		int32 ShDegree = MaxShDegree;
+		bool bCovariance = false;
+		FResourceArrayInterface* Streams[SplatStream_Count] = {};	// null for the bands ShDegree does not use
+	};
+
+	// higher order SH coefficients per channel for a degree : 0, 3, 8, 15
+	FORCEINLINE int32 GetNumShRest(int32 ShDegree)
+	{
+		return (ShDegree + 1) * (ShDegree + 1) - 1;
+	}
+
+	// band streams holding them, after the first 3 packed in sh0.yzw : 0, 0, 2, 3
+	FORCEINLINE int32 GetNumShBandStreams(int32 ShDegree)
+	{
+		return FMath::DivideAndRoundUp(FMath::Max(GetNumShRest(ShDegree) - 3, 0), 4);
+	}
+
+	FORCEINLINE bool IsStreamUsed(int32 Stream, int32 ShDegree)
+	{
+		return Stream < SplatStream_Sh1_4 || (Stream - SplatStream_Sh1_4) / 3 < GetNumShBandStreams(ShDegree);
+	}
+
+	// Sizes every stream ShDegree uses for NumParticles, contents uninitialized. Capacity is never given back and
+	// the streams keep their memory through the RHI upload, so a reused FGaussSplatVertex (GSLoadArena) does not
+	// reallocate for a load of the same size.
+	void AllocateStreams(FGaussSplatVertex& GSData, UINT NumParticles, int32 ShDegree = MaxShDegree);
+
+	FSplatStreams GetStreams(FGaussSplatVertex& GSData);
+
+	// bytes per particle
+	uint32 GetStreamStride(int32 Stream);
+
+	// Replaces rotation and scale by the 3D covariance R S S^T R^T, computed once with GSKernels::ComputeCovariance
+	// instead of by the VS every frame. Strides are unchanged, so every stream path and the sort key generation
+	// still apply, and scl.z is left free. The raw PLY quaternions are normalized first. Multithreaded, PosRot and
+	// Scl are updated in place.
+	void ConvertToCovariance(float* PosRot, FVector4f* Scl, UINT NumParticles);
+	void ConvertToCovariance(FGaussSplatVertex& GSData);
+
+	/*
+	*  Parsed "element vertex" description of a binary little endian PLY header
+	*/
+	struct FPlyProperty
+	{
+		std::string Name;
+		int32 Offset = 0;
+		int32 Size = 0;
+		bool bIsFloat = false;
+	};
+
+	struct FPlyHeader
+	{
+		uint64 NumVertices = 0;
+		int32 Stride = 0;
+		int64 DataOffset = 0;		// first byte of the vertex block
+		TArray<FPlyProperty> Properties;
+
+		bool Parse(const uint8* Data, int64 Size);
+		const FPlyProperty* Find(const std::string& Name) const;
+	};
+
+	// Loads Filename into GSData. A .gsplatz file is decoded by GSCompressed, a PLY uses the memory-mapped path
+	// when r.GS.Ply.MemoryMapped is set and falls back to the std::ifstream + FAttributeCollection path otherwise.
+	// Coefficients above ShDegree are neither decoded nor allocated, and need not be in the file.
+	bool LoadPlyFile(const FString& Filename, FGaussSplatVertex& GSData, int32 ShDegree = MaxShDegree);
+
+	// Maps the file and transposes the vertex records straight into GSData without intermediate copies.
+	bool LoadPlyFileMapped(const FString& Filename, FGaussSplatVertex& GSData, int32 ShDegree = MaxShDegree);
+
+	// Reads the whole file through FAttributeCollection, then decodes its vertex block.
+	bool LoadPlyFileStream(const FString& Filename, FGaussSplatVertex& GSData, int32 ShDegree = MaxShDegree);
+
+	using FSplatChunkRef = TSharedRef<FGaussSplatVertex, ESPMode::ThreadSafe>;
+
+	// Decodes a PLY in chunks of ChunkSize particles, largest and most opaque splats first, and hands each chunk
+	// to OnChunk as soon as it is ready. The ordering pass only reads scale and opacity, so the first chunk
+	// arrives long before a full LoadPlyFile would return. A .gsplatz file comes as a single chunk.
+	// OnChunk returns false to cancel. Returns true once every chunk has been delivered.
+	bool LoadPlyFileProgressive(const FString& Filename, UINT ChunkSize, int32 ShDegree, TFunctionRef<bool(const FSplatChunkRef& Chunk, UINT NumTotal)> OnChunk);
+
+	// Slices in flight of LoadPlyFileSliced : one being decoded while the previous one is uploaded
+	constexpr int32 NumSliceStaging = 2;
+
+	struct FSliceStats
+	{
+		uint64 PeakStagingBytes = 0;	// allocated by the staging slices, the only memory the load keeps besides one mapped slice
+		uint32 NumAllocations = 0;		// heap allocations of the load, see GSLoadArena
+		uint32 MaxSliceAllocations = 0;	// most heap allocations of a slice decoded into a staging slice used before
+	};
+
+	// staging memory LoadPlyFileSliced keeps at most, whatever the splat count
+	uint64 GetSliceWindowBytes(UINT SliceSize, int32 ShDegree);
+
+	// Decodes a binary PLY in file order, SliceSize particles at a time, through NumSliceStaging reused slices.
+	// A slice is decoded again only once every reference OnSlice took to it is gone, and only the records of
+	// the slice being decoded are mapped, so the load holds GetSliceWindowBytes of streams plus one slice of
+	// the file however large the file is. OnSlice returns false to cancel, Canceled stops the load too, also
+	// while it waits for a slice. Returns true once every slice has been delivered.
+	bool LoadPlyFileSliced(const FString& Filename, UINT SliceSize, int32 ShDegree, TFunctionRef<bool(const FSplatChunkRef& Slice, UINT NumTotal)> OnSlice,
+		FSliceStats* OutStats = nullptr, const std::atomic<bool>* Canceled = nullptr);
+
+	/*
+	*  PLY partitioned into spatial pages of PageSize splats along a Morton curve, decoded on demand.
+	*  Only positions are read when opening, the file stays mapped and DecodePage can run on any thread.
+	*  Every page decodes to exactly PageSize particles, the last one is padded with transparent copies.
+	*/
+	class FPagedPlyFile
+	{
+	public:
+		FPagedPlyFile();
+		~FPagedPlyFile();
+
+		bool Open(const FString& Filename, UINT InPageSize, int32 InShDegree);
+
+		int32 GetNumPages() const { return PageBounds.Num(); }
+		UINT GetPageSize() const { return PageSize; }
+		UINT GetNumParticles() const { return NumParticles; }
+		int32 GetShDegree() const { return ShDegree; }
+
+		// actor local space, the raw PLY positions DecodePage uploads, with the 3 sigma extent of every splat
+		const FBox3f& GetPageBounds(int32 Page) const { return PageBounds[Page]; }
+
+		void DecodePage(int32 Page, FGaussSplatVertex& GSData) const;
+
+	private:
+		struct FImpl;
+		TUniquePtr<FImpl> Impl;
+
+		TArray<uint32> Order;		// Morton order, padded to a whole number of pages
+		TArray<FBox3f> PageBounds;
+		UINT PageSize = 0;
+		UINT NumParticles = 0;
+		int32 ShDegree = MaxShDegree;
+	};
+
+	// Bitwise comparison of every stream, used to validate loader paths against each other.
+	bool IsIdentical(const FGaussSplatVertex& A, const FGaussSplatVertex& B);
+}	// namespace PLY
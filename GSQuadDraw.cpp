@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSQuadDraw.h"
+#include "CommonRenderResources.h"
+#include "DataDrivenShaderPlatformInfo.h"
+#include "GlobalShader.h"
+#include "PipelineStateCache.h"
+#include "RenderGraphBuilder.h"
+#include "ShaderParameterStruct.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  FGSQuadVS
+*/
+class FGSQuadVS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FGSQuadVS);
+	SHADER_USE_PARAMETER_STRUCT(FGSQuadVS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FVector2f, gViewSize2)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint4>, gProjected)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		// no geometry shader, down to the feature level of the PreprocessCS
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSQuadVS, "/GSRuntime/GaussSplatQuads.usf", "MainVS", SF_Vertex);
+
+/*
+*  FGSQuadPS
+*/
+class FGSQuadPS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FGSQuadPS);
+	SHADER_USE_PARAMETER_STRUCT(FGSQuadPS, FGlobalShader)
+
+	using FParameters = FEmptyShaderParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return FGSQuadVS::ShouldCompilePermutation(Parameters);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSQuadPS, "/GSRuntime/GaussSplatQuads.usf", "MainPS", SF_Pixel);
+
+
+BEGIN_SHADER_PARAMETER_STRUCT(FGSQuadProjectParameters, )
+	// not bound, they order the projection against the sort passes and the uploads
+	RDG_BUFFER_ACCESS(SortedIndices, ERHIAccess::SRVCompute)
+	RDG_BUFFER_ACCESS(PosRot, ERHIAccess::SRVCompute)
+	SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint4>, Projected)
+END_SHADER_PARAMETER_STRUCT()
+
+BEGIN_SHADER_PARAMETER_STRUCT(FGSQuadDrawParameters, )
+	SHADER_PARAMETER_STRUCT_INCLUDE(FGSQuadVS::FParameters, VS)
+	RENDER_TARGET_BINDING_SLOTS()
+END_SHADER_PARAMETER_STRUCT()
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSQuad
+{
+	void AddPasses(FRDGBuilder& GraphBuilder, const GSTile::FSplatSource& Source, const GSTile::FView& View,
+		FRDGBufferRef SortedIndices, FRDGBufferRef PosRot, FRHIShaderResourceView* SortedIndexSRV, uint32 NumSplats, FRDGTextureRef SceneColor)
+	{
+		check(NumSplats);
+
+		// transient, RDG hands the memory to the other passes of the frame afterwards
+		FRDGBufferRef Projected = GraphBuilder.CreateBuffer(
+			FRDGBufferDesc::CreateBufferDesc(sizeof(FUintVector4), NumSplats * sizeof(GSTile::FProjectedSplat) / sizeof(FUintVector4)),
+			TEXT("GSQuadProjected"));
+
+		FGSQuadProjectParameters* ProjectParameters = GraphBuilder.AllocParameters<FGSQuadProjectParameters>();
+		ProjectParameters->SortedIndices = SortedIndices;
+		ProjectParameters->PosRot = PosRot;
+		ProjectParameters->Projected = GraphBuilder.CreateUAV(Projected, PF_R32G32B32A32_UINT);
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Gaussian Splatting Quads Project %u", NumSplats)
+			, ProjectParameters
+			, ERDGPassFlags::Compute
+			, [Source, View, ProjectParameters, SortedIndexSRV, NumSplats](FRHIComputeCommandList& RHICmdList)
+			{
+				GSTile::Project_RenderThread(RHICmdList, Source, View, SortedIndexSRV, NumSplats, ProjectParameters->Projected->GetRHI(), nullptr);
+			});
+
+		FGSQuadDrawParameters* DrawParameters = GraphBuilder.AllocParameters<FGSQuadDrawParameters>();
+		DrawParameters->VS.gViewSize2 = FVector2f(View.ViewRect.Width(), View.ViewRect.Height());
+		DrawParameters->VS.gProjected = GraphBuilder.CreateSRV(Projected, PF_R32G32B32A32_UINT);
+		DrawParameters->RenderTargets[0] = FRenderTargetBinding(SceneColor, ERenderTargetLoadAction::ELoad);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FGSQuadVS> VertexShader(ShaderMap);
+		TShaderMapRef<FGSQuadPS> PixelShader(ShaderMap);
+		const FIntRect ViewRect = View.ViewRect;
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Gaussian Splatting Quads %u", NumSplats)
+			, DrawParameters
+			, ERDGPassFlags::Raster
+			, [VertexShader, PixelShader, DrawParameters, ViewRect, NumSplats](FRHICommandList& RHICmdList)
+			{
+				RHICmdList.SetViewport((float)ViewRect.Min.X, (float)ViewRect.Min.Y, 0.0f, (float)ViewRect.Max.X, (float)ViewRect.Max.Y, 1.0f);
+
+				// the blend and depth states of the point list draw
+				FGraphicsPipelineStateInitializer GraphicsPSOInit;
+				RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+				GraphicsPSOInit.BlendState = TStaticBlendState<CW_RGBA, BO_Add, BF_SourceAlpha, BF_InverseSourceAlpha, BO_Add, BF_Zero, BF_InverseSourceAlpha>::GetRHI();
+				GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+				GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+				GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+				GraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
+
+				SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+				SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), DrawParameters->VS);
+
+				// one strip instance per sorted entry, the instances blend in order
+				RHICmdList.DrawPrimitive(
+					/*BaseVertexIndex=*/ 0,
+					/*NumPrimitives=*/ 2,
+					/*NumInstances=*/ NumSplats);
+			});
+	}
+}	// namespace GSQuad
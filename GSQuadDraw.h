@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphDefinitions.h"
+#include "GSTileRaster.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Quad draw without geometry shader
+*
+*  For the GPUs where geometry shaders are slow, emulated or missing, see AGSActor::RenderMode. The PreprocessCS of
+*  the tile rasterizer projects every sorted entry once into a transient FProjectedSplat buffer, then an instanced
+*  draw of a 4 vertex strip per entry pulls the quad from it. Instances are blended in order, far first, as the
+*  point list draw.
+*
+*  Shaders (GaussSplatQuads.usf) :
+*    MainVS	instance k : gProjected[k], corner SV_VertexID of the Center +- Extent rect, clip position from pixels
+*		over gViewSize2, conic, opacity and color to the PS. Culled entries have a zero extent and no area.
+*    MainPS	alpha = opacity * exp(-0.5 * d.Conic.d) from the pixel offset d, discarded under 1/255, (color, alpha)
+*		to SrcAlpha / InvSrcAlpha
+*/
+namespace GSQuad
+{
+	// Projects the NumSplats entries of SortedIndexSRV and draws them over SceneColor within View.ViewRect.
+	// SortedIndices and PosRot are the RDG buffers behind SortedIndexSRV and Source, they order the passes.
+	void AddPasses(FRDGBuilder& GraphBuilder, const GSTile::FSplatSource& Source, const GSTile::FView& View,
+		FRDGBufferRef SortedIndices, FRDGBufferRef PosRot, FRHIShaderResourceView* SortedIndexSRV, uint32 NumSplats, FRDGTextureRef SceneColor);
+}	// namespace GSQuad
@@ -0,0 +1,340 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSortCpu.h"
+#include "GSSortKeys.h"
+#include "Algo/StableSort.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#include <algorithm>
+
+DEFINE_LOG_CATEGORY_STATIC(LogGSSortCpu, Log, All);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// smallest key range worth a ParallelFor task
+	constexpr int32 MinSortBlockSize = 16 * 1024;
+
+	constexpr uint32 NumRadixBuckets = 1u << GSSort::CpuRadixBits;
+
+	// a few blocks per worker, fewer for small inputs
+	int32 GetNumSortBlocks(int32 Num)
+	{
+		const int32 NumWorkers = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+		return FMath::Clamp(FMath::DivideAndRoundUp(Num, MinSortBlockSize), 1, NumWorkers * 4);
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSSort
+{
+	void AppendPositions(const float* PosRot, uint32 NumParticles, TArray<FVector3f>& Out)
+	{
+		const int32 Offset = Out.Num();
+		Out.AddUninitialized(NumParticles);
+		for (uint32 i = 0; i < NumParticles; ++i) {
+			Out[Offset + i] = FVector3f(PosRot[i * 7], PosRot[i * 7 + 1], PosRot[i * 7 + 2]);
+		}
+	}
+
+	void GenerateKeys(TConstArrayView<FVector3f> Positions, const FMatrix44f& WVP, int32 KeyBits, TArray<uint32>& OutKeys, TArray<uint32>& OutIndices)
+	{
+		const int32 Num = Positions.Num();
+		OutKeys.SetNumUninitialized(Num, false);
+		OutIndices.SetNumUninitialized(Num, false);
+
+		const int32 NumBlocks = GetNumSortBlocks(Num);
+		const int32 BlockSize = FMath::DivideAndRoundUp(FMath::Max(Num, 1), NumBlocks);
+
+		// DepthRangeCS : min and max depth of the particles in front of the camera
+		TArray<FVector2f> BlockRanges;
+		BlockRanges.Init(FVector2f(MAX_flt, -MAX_flt), NumBlocks);
+		ParallelFor(NumBlocks, [&](int32 Block)
+			{
+				FVector2f& Range = BlockRanges[Block];
+				const int32 End = FMath::Min(Num, (Block + 1) * BlockSize);
+				for (int32 i = Block * BlockSize; i < End; ++i) {
+					const float Depth = GetViewDepth(Positions[i], WVP);
+					if (Depth > 0.f) {
+						Range.X = FMath::Min(Range.X, Depth);
+						Range.Y = FMath::Max(Range.Y, Depth);
+					}
+				}
+			});
+
+		float MinDepth = MAX_flt;
+		float MaxDepth = -MAX_flt;
+		for (const FVector2f& Range : BlockRanges) {
+			MinDepth = FMath::Min(MinDepth, Range.X);
+			MaxDepth = FMath::Max(MaxDepth, Range.Y);
+		}
+
+		// SortKeysCS, nothing in front leaves every particle at the largest key
+		ParallelFor(NumBlocks, [&](int32 Block)
+			{
+				const int32 End = FMath::Min(Num, (Block + 1) * BlockSize);
+				for (int32 i = Block * BlockSize; i < End; ++i) {
+					OutKeys[i] = GetDepthKey(GetViewDepth(Positions[i], WVP), MinDepth, MaxDepth, KeyBits);
+					OutIndices[i] = i;
+				}
+			});
+	}
+
+	void RadixSort(TArray<uint32>& Keys, TArray<uint32>& Values, int32 KeyBits, TArray<uint32>& ScratchKeys, TArray<uint32>& ScratchValues)
+	{
+		check(Keys.Num() == Values.Num());
+		const int32 Num = Keys.Num();
+		ScratchKeys.SetNumUninitialized(Num, false);
+		ScratchValues.SetNumUninitialized(Num, false);
+
+		const int32 NumBlocks = GetNumSortBlocks(Num);
+		const int32 BlockSize = FMath::DivideAndRoundUp(FMath::Max(Num, 1), NumBlocks);
+
+		// bucket counts, then write offsets, of every block
+		TArray<uint32> Offsets;
+		Offsets.SetNumUninitialized(NumBlocks * NumRadixBuckets);
+
+		uint32* SrcKeys = Keys.GetData();
+		uint32* SrcValues = Values.GetData();
+		uint32* DstKeys = ScratchKeys.GetData();
+		uint32* DstValues = ScratchValues.GetData();
+
+		const int32 NumPasses = FMath::DivideAndRoundUp(FMath::Clamp(KeyBits, 1, 32), CpuRadixBits);
+		for (int32 Pass = 0; Pass < NumPasses; ++Pass) {
+			const int32 Shift = Pass * CpuRadixBits;
+
+			ParallelFor(NumBlocks, [&](int32 Block)
+				{
+					uint32* Counts = &Offsets[Block * NumRadixBuckets];
+					FMemory::Memzero(Counts, NumRadixBuckets * sizeof(uint32));
+					const int32 End = FMath::Min(Num, (Block + 1) * BlockSize);
+					for (int32 i = Block * BlockSize; i < End; ++i) {
+						++Counts[(SrcKeys[i] >> Shift) & (NumRadixBuckets - 1)];
+					}
+				});
+
+			// exclusive prefix sum, bucket major : within a bucket the blocks keep their order, which keeps the sort stable
+			uint32 Sum = 0;
+			for (uint32 Bucket = 0; Bucket < NumRadixBuckets; ++Bucket) {
+				for (int32 Block = 0; Block < NumBlocks; ++Block) {
+					uint32& Offset = Offsets[Block * NumRadixBuckets + Bucket];
+					const uint32 Count = Offset;
+					Offset = Sum;
+					Sum += Count;
+				}
+			}
+
+			ParallelFor(NumBlocks, [&](int32 Block)
+				{
+					uint32* Next = &Offsets[Block * NumRadixBuckets];
+					const int32 End = FMath::Min(Num, (Block + 1) * BlockSize);
+					for (int32 i = Block * BlockSize; i < End; ++i) {
+						const uint32 Dst = Next[(SrcKeys[i] >> Shift) & (NumRadixBuckets - 1)]++;
+						DstKeys[Dst] = SrcKeys[i];
+						DstValues[Dst] = SrcValues[i];
+					}
+				});
+
+			Swap(SrcKeys, DstKeys);
+			Swap(SrcValues, DstValues);
+		}
+
+		// an odd pass count leaves the result in the scratch arrays
+		if (NumPasses & 1) {
+			Swap(Keys, ScratchKeys);
+			Swap(Values, ScratchValues);
+		}
+	}
+}	// namespace GSSort
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// positions around the origin, some behind every view, every 16th a copy of an earlier one for equal keys
+	void MakeTestPositions(uint32 Num, FRandomStream& Random, TArray<FVector3f>& Out)
+	{
+		Out.SetNumUninitialized(Num);
+		for (uint32 i = 0; i < Num; ++i) {
+			Out[i] = (i % 16 == 15) ? Out[Random.RandHelper(i)] : FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, 100.f);
+		}
+	}
+
+	FMatrix44f MakeTestView(FRandomStream& Random)
+	{
+		const FVector Eye = Random.GetUnitVector() * Random.FRandRange(20.f, 300.f);
+		const FMatrix ViewMatrix = FLookAtMatrix(Eye, FVector(Random.GetUnitVector()) * 50.f, FVector::UpVector);
+		return FMatrix44f(ViewMatrix * FReversedZPerspectiveMatrix(UE_HALF_PI * 0.5f, 16.f, 9.f, 1.f));
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// Random splats and views : the CPU keys must be the GetDepthKey of the view depth over the range of the splats
+	// in front, the radix order the stable sort of those keys, and far splats must come first up to one key step.
+	// Check is called per view and key width for every property, and for the coverage of equal keys and of splats
+	// behind the camera.
+	void CheckCpuSort(uint32 NumSplats, TFunctionRef<void(const FString& What, bool bPassed)> Check)
+	{
+		FRandomStream Random(0x5EED);
+
+		TArray<FVector3f> Positions;
+		MakeTestPositions(NumSplats, Random, Positions);
+
+		TArray<uint32> Keys, Indices, ScratchKeys, ScratchIndices, Order;
+		TArray<float> Depths;
+		Depths.SetNumUninitialized(NumSplats);
+
+		constexpr int32 NumViews = 8;
+		for (int32 View = 0; View < NumViews; ++View) {
+			const FMatrix44f WVP = MakeTestView(Random);
+
+			float MinDepth = MAX_flt;
+			float MaxDepth = -MAX_flt;
+			int32 NumBehind = 0;
+			for (uint32 i = 0; i < NumSplats; ++i) {
+				Depths[i] = GSSort::GetViewDepth(Positions[i], WVP);
+				if (Depths[i] > 0.f) {
+					MinDepth = FMath::Min(MinDepth, Depths[i]);
+					MaxDepth = FMath::Max(MaxDepth, Depths[i]);
+				}
+				else {
+					++NumBehind;
+				}
+			}
+
+			for (const int32 KeyBits : { 16, 24 }) {
+				const FString Name = FString::Printf(TEXT("view %d, %d bit keys"), View, KeyBits);
+
+				GSSort::GenerateKeys(Positions, WVP, KeyBits, Keys, Indices);
+				bool bKeys = true;
+				for (uint32 i = 0; i < NumSplats; ++i) {
+					bKeys &= Indices[i] == i && Keys[i] == GSSort::GetDepthKey(Depths[i], MinDepth, MaxDepth, KeyBits);
+				}
+				Check(Name + TEXT(" : GenerateKeys matches GetDepthKey"), bKeys);
+
+				Order = Indices;
+				Algo::StableSort(Order, [&Keys](uint32 A, uint32 B) { return Keys[A] < Keys[B]; });
+
+				GSSort::RadixSort(Keys, Indices, KeyBits, ScratchKeys, ScratchIndices);
+				Check(Name + TEXT(" : RadixSort matches Algo::StableSort"), Indices == Order);
+
+				// far first up to the rounding of a key step, splats behind the camera with the nearest
+				const float Step = 2.f * (MaxDepth - MinDepth) / (float)GSSort::GetKeyMask(KeyBits);
+				bool bFarFirst = true;
+				int32 NumEqual = 0;
+				for (uint32 k = 1; k < NumSplats; ++k) {
+					const float Prev = Depths[Indices[k - 1]];
+					const float Depth = Depths[Indices[k]];
+					bFarFirst &= Keys[k - 1] <= Keys[k] && (Prev <= 0.f || Depth <= 0.f || Depth <= Prev + Step);
+					NumEqual += Keys[k - 1] == Keys[k] && Prev > 0.f;
+				}
+				Check(Name + TEXT(" : far splats first"), bFarFirst);
+				Check(Name + TEXT(" : equal keys in front of the camera covered"), NumEqual > 0);
+			}
+			Check(FString::Printf(TEXT("view %d : splats behind the camera covered"), View), NumBehind > 0);
+		}
+	}
+}
+
+
+/*
+*  GS.Sort.CpuTest [NumSplats]
+*
+*  CheckCpuSort from the console, on more splats than the automation test.
+*/
+static FAutoConsoleCommand GSSortCpuTestCommand(
+	TEXT("GS.Sort.CpuTest"),
+	TEXT("GS.Sort.CpuTest [NumSplats=262144] : checks the CPU keys and radix sort against the GPU key definition on random splats and views."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const uint32 NumSplats = Args.Num() > 0 ? (uint32)FMath::Max(2, FCString::Atoi(*Args[0])) : 1 << 18;
+
+			bool bPassed = true;
+			CheckCpuSort(NumSplats, [&bPassed](const FString& What, bool bCheck)
+				{
+					if (!bCheck) {
+						UE_LOG(LogGSSortCpu, Error, TEXT("GS.Sort.CpuTest : %s FAILED"), *What);
+					}
+					bPassed &= bCheck;
+				});
+
+			UE_LOG(LogGSSortCpu, Display, TEXT("GS.Sort.CpuTest %s"), bPassed ? TEXT("passed") : TEXT("FAILED"));
+		}));
+
+
+/*
+*  GS.Sort.CpuBench [NumSplats] [Iterations]
+*
+*  Key generation and radix sort of random splats for one view, against std::sort of the same keys packed with
+*  their index in 64 bits.
+*/
+static FAutoConsoleCommand GSSortCpuBenchCommand(
+	TEXT("GS.Sort.CpuBench"),
+	TEXT("GS.Sort.CpuBench [NumSplats=4000000] [Iterations=5] : CPU time of the key generation and radix sort for 16 and 24 bit keys, and of std::sort."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const uint32 NumSplats = Args.Num() > 0 ? (uint32)FMath::Max(1, FCString::Atoi(*Args[0])) : 4000000;
+			const int32 Iterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 5;
+			FRandomStream Random(NumSplats);
+
+			TArray<FVector3f> Positions;
+			MakeTestPositions(NumSplats, Random, Positions);
+			const FMatrix44f WVP = MakeTestView(Random);
+
+			TArray<uint32> Keys, Indices, ScratchKeys, ScratchIndices;
+			TArray<uint64> Pairs;
+			for (const int32 KeyBits : { 16, 24 }) {
+				double KeysMs = 0.;
+				double RadixMs = 0.;
+				double StdMs = 0.;
+				for (int32 Iteration = 0; Iteration < Iterations; ++Iteration) {
+					double Start = FPlatformTime::Seconds();
+					GSSort::GenerateKeys(Positions, WVP, KeyBits, Keys, Indices);
+					KeysMs += (FPlatformTime::Seconds() - Start) * 1000.;
+
+					Pairs.SetNumUninitialized(NumSplats, false);
+					for (uint32 i = 0; i < NumSplats; ++i) {
+						Pairs[i] = ((uint64)Keys[i] << 32) | i;
+					}
+
+					Start = FPlatformTime::Seconds();
+					GSSort::RadixSort(Keys, Indices, KeyBits, ScratchKeys, ScratchIndices);
+					RadixMs += (FPlatformTime::Seconds() - Start) * 1000.;
+
+					Start = FPlatformTime::Seconds();
+					std::sort(Pairs.GetData(), Pairs.GetData() + Pairs.Num());
+					StdMs += (FPlatformTime::Seconds() - Start) * 1000.;
+				}
+
+				KeysMs /= Iterations;
+				RadixMs /= Iterations;
+				StdMs /= Iterations;
+				UE_LOG(LogGSSortCpu, Display, TEXT("%u splats, %d bit : keys %.3f ms, radix sort %d passes %.3f ms, std::sort %.3f ms (%.2fx)"),
+					NumSplats, KeyBits, KeysMs, FMath::DivideAndRoundUp(KeyBits, GSSort::CpuRadixBits), RadixMs, StdMs, StdMs / FMath::Max(RadixMs, 1e-6));
+			}
+		}));
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGSSortCpuTest, "GSRuntime.Sort.Cpu",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::EngineFilter)
+
+bool FGSSortCpuTest::RunTest(const FString& Parameters)
+{
+	// no RHI involved, runs with -nullrhi
+	CheckCpuSort(1 << 16, [this](const FString& What, bool bPassed) { TestTrue(What, bPassed); });
+	return true;
+}
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
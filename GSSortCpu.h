@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  CPU sort
+*
+*  Reference of the GPU sort and fallback for r.GS.Sort.CPU : the keys of DepthRangeCS and SortKeysCS computed on
+*  the worker pool, then a parallel LSD radix sort of CpuRadixBits digits. Blocks of keys are counted and
+*  scattered in parallel, block order is kept, so the sort is stable like SortGPUBuffers and equal keys stay in
+*  index order. The GSRuntime.Sort.Cpu automation test and GS.Sort.CpuTest check it against GetDepthKey and
+*  Algo::StableSort, GS.Sort.CpuBench times it against std::sort.
+*/
+namespace GSSort
+{
+	constexpr int32 CpuRadixBits = 8;
+
+	// the normalized keys hold float precision, r.GS.Sort.KeyBits 32 sorts on 24 bits here
+	constexpr int32 MaxCpuKeyBits = 24;
+
+	// view depth of a local position, as DepthRangeCS : mul(float4(pos, 1), gWVP).w
+	FORCEINLINE float GetViewDepth(const FVector3f& Position, const FMatrix44f& WVP)
+	{
+		return Position.X * WVP.M[0][3] + Position.Y * WVP.M[1][3] + Position.Z * WVP.M[2][3] + WVP.M[3][3];
+	}
+
+	// positions of NumParticles PosRot records (7 floats) appended to Out
+	void AppendPositions(const float* PosRot, uint32 NumParticles, TArray<FVector3f>& Out);
+
+	// keys of every position for WVP and identity indices, the depth range over the positions in front of the camera
+	void GenerateKeys(TConstArrayView<FVector3f> Positions, const FMatrix44f& WVP, int32 KeyBits, TArray<uint32>& OutKeys, TArray<uint32>& OutIndices);
+
+	// Stable sort of Keys and Values by the KeyBits low bits of the keys, ascending. The scratch arrays are only
+	// resized, keep them around between sorts.
+	void RadixSort(TArray<uint32>& Keys, TArray<uint32>& Values, int32 KeyBits, TArray<uint32>& ScratchKeys, TArray<uint32>& ScratchValues);
+}	// namespace GSSort
@@ -0,0 +1,477 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSortKeys.h"
+#include "GSBufferPool.h"
+#include "GSSplatCulling.h"
+#include "DataDrivenShaderPlatformInfo.h"
+#include "GlobalShader.h"
+#include "GPUSort.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "RenderingThread.h"
+#include "RenderUtils.h"
+#include "ShaderParameterStruct.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogGSSort, Log, All);
+
+static TAutoConsoleVariable<int32> CVarSortKeyBits(
+	TEXT("r.GS.Sort.KeyBits"),
+	16,
+	TEXT("Width of the depth sort keys. 16 or 24 : keys normalized to the visible depth range, only the radix passes\n")
+	TEXT("those bits need run. 32 : full float keys, all eight passes."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarSortIncremental(
+	TEXT("r.GS.Sort.Incremental"),
+	1,
+	TEXT("Re-sort from the previous order while the view direction stays close to the one of the last full sort.\n")
+	TEXT("Needs r.GS.Sort.KeyBits below 32."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarSortIncrementalMaxAngle(
+	TEXT("r.GS.Sort.Incremental.MaxAngle"),
+	2.f,
+	TEXT("Rotation of the view since the last full sort, in degrees, above which the splats are sorted from scratch again."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarSortIncrementalPasses(
+	TEXT("r.GS.Sort.Incremental.Passes"),
+	2,
+	TEXT("Block sorts per incremental re-sort. Each moves an entry up to half a block (GSSort::LocalSortBlockSize) towards its place."),
+	ECVF_RenderThreadSafe);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  FGSDepthRangeCS, FGSSortKeysCS
+*/
+class FGSDepthRangeCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSDepthRangeCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSDepthRangeCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumParticles)
+		SHADER_PARAMETER(FMatrix44f, gWVP)
+		SHADER_PARAMETER_SRV(Buffer<float>, gPosRot)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gChunkIndices)
+		SHADER_PARAMETER_SRV(Buffer<uint4>, gVisibleChunks)
+		SHADER_PARAMETER(uint32, gNumVisibleChunks)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gDepthRange)
+	END_SHADER_PARAMETER_STRUCT()
+
+	class FChunkCullingDim : SHADER_PERMUTATION_BOOL("CHUNK_CULLING");
+	using FPermutationDomain = TShaderPermutationDomain<FChunkCullingDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSSort::ThreadGroupSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSDepthRangeCS, "/GSRuntime/GaussSplatSortKeys.usf", "DepthRangeCS", SF_Compute);
+
+class FGSSortKeysCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSSortKeysCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSSortKeysCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumParticles)
+		SHADER_PARAMETER(uint32, gKeyBits)
+		SHADER_PARAMETER(FMatrix44f, gWVP)
+		SHADER_PARAMETER_SRV(Buffer<float>, gPosRot)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gChunkIndices)
+		SHADER_PARAMETER_SRV(Buffer<uint4>, gVisibleChunks)
+		SHADER_PARAMETER(uint32, gNumVisibleChunks)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gDepthRange)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gKeys)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gIndices)
+	END_SHADER_PARAMETER_STRUCT()
+
+	using FPermutationDomain = FGSDepthRangeCS::FPermutationDomain;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSSort::ThreadGroupSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSSortKeysCS, "/GSRuntime/GaussSplatSortKeys.usf", "SortKeysCS", SF_Compute);
+
+class FGSResortKeysCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSResortKeysCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSResortKeysCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumParticles)
+		SHADER_PARAMETER(uint32, gKeyBits)
+		SHADER_PARAMETER(FMatrix44f, gWVP)
+		SHADER_PARAMETER_SRV(Buffer<float>, gPosRot)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gPrevIndices)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gDepthRange)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gKeys)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gIndices)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSSort::ThreadGroupSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSResortKeysCS, "/GSRuntime/GaussSplatSortKeys.usf", "ResortKeysCS", SF_Compute);
+
+class FGSSortBlocksCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSSortBlocksCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSSortBlocksCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumKeys)
+		SHADER_PARAMETER(uint32, gBlockOffset)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gKeys)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gIndices)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSSort::ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("LOCAL_SORT_BLOCK_SIZE"), GSSort::LocalSortBlockSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSSortBlocksCS, "/GSRuntime/GaussSplatSortKeys.usf", "SortBlocksCS", SF_Compute);
+
+static_assert(GSCull::ChunkSize == GSSort::ThreadGroupSize, "CHUNK_CULLING runs one group per chunk");
+static_assert(sizeof(GSCull::FVisibleChunk) == sizeof(FUintVector4), "gVisibleChunks is read as uint4");
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSSort
+{
+	int32 GetKeyBits()
+	{
+		const int32 KeyBits = CVarSortKeyBits.GetValueOnAnyThread();
+		return KeyBits <= 16 ? 16 : KeyBits <= 24 ? 24 : 32;
+	}
+
+	int32 GetIncrementalPasses()
+	{
+		return CVarSortIncremental.GetValueOnAnyThread() ? FMath::Max(CVarSortIncrementalPasses.GetValueOnAnyThread(), 1) : 0;
+	}
+
+	float GetIncrementalMaxAngle()
+	{
+		return FMath::Max(CVarSortIncrementalMaxAngle.GetValueOnAnyThread(), 0.f);
+	}
+
+	float GetDepthAxisAngle(const FMatrix44f& From, const FMatrix44f& To)
+	{
+		// clip w column, the z column for an orthographic projection
+		auto GetDepthAxis = [](const FMatrix44f& M)
+		{
+			const FVector3f W(M.M[0][3], M.M[1][3], M.M[2][3]);
+			return W.IsNearlyZero() ? FVector3f(M.M[0][2], M.M[1][2], M.M[2][2]).GetSafeNormal() : W.GetSafeNormal();
+		};
+
+		const float CosAngle = FVector3f::DotProduct(GetDepthAxis(From), GetDepthAxis(To));
+		return FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(CosAngle, -1.f, 1.f)));
+	}
+
+	void SortBlocks_RenderThread(FRHIComputeCommandList& RHICmdList, uint32 NumKeys, int32 NumPasses, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV)
+	{
+		TShaderMapRef<FGSSortBlocksCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		for (int32 Pass = 0; Pass < NumPasses; ++Pass) {
+			const uint32 BlockOffset = (Pass & 1) ? LocalSortBlockSize / 2 : 0;
+			if (BlockOffset >= NumKeys) {
+				continue;
+			}
+
+			FGSSortBlocksCS::FParameters Parameters;
+			Parameters.gNumKeys = NumKeys;
+			Parameters.gBlockOffset = BlockOffset;
+			Parameters.gKeys = KeyUAV;
+			Parameters.gIndices = IndexUAV;
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters,
+				FComputeShaderUtils::GetGroupCountWrapped(FMath::DivideAndRoundUp(NumKeys - BlockOffset, (uint32)LocalSortBlockSize)));
+
+			RHICmdList.Transition({
+				FRHITransitionInfo(KeyUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute),
+				FRHITransitionInfo(IndexUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute) });
+		}
+	}
+
+
+	/*
+	*  FDepthKeyGen
+	*/
+	void FDepthKeyGen::InitResources(FRHICommandListBase& RHICmdList)
+	{
+		check(IsInRenderingThread());
+
+		if (!DepthRangeBuffer) {
+			FRHIResourceCreateInfo CreateInfo(TEXT("GSSortDepthRange"));
+			DepthRangeBuffer = RHICmdList.CreateVertexBuffer(2 * sizeof(uint32), BUF_Static | BUF_UnorderedAccess, CreateInfo);
+			DepthRangeUAV = RHICmdList.CreateUnorderedAccessView(DepthRangeBuffer, PF_R32_UINT);
+		}
+	}
+
+	uint32 FDepthKeyGen::Execute_RenderThread(FRHIComputeCommandList& RHICmdList, uint32 NumParticles, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+		int32 KeyBits, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV)
+	{
+		if (NumParticles) {
+			Dispatch(RHICmdList, NumParticles, WVP, PosRotSRV, nullptr, nullptr, 0, KeyBits, KeyUAV, IndexUAV);
+		}
+		return NumParticles;
+	}
+
+	uint32 FDepthKeyGen::Execute_RenderThread(FRHIComputeCommandList& RHICmdList, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+		FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks, uint32 NumVisible,
+		int32 KeyBits, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV)
+	{
+		if (NumVisibleChunks) {
+			Dispatch(RHICmdList, NumVisible, WVP, PosRotSRV, ChunkIndicesSRV, VisibleChunksSRV, NumVisibleChunks, KeyBits, KeyUAV, IndexUAV);
+		}
+		return NumVisible;
+	}
+
+	void FDepthKeyGen::Resort_RenderThread(FRHIComputeCommandList& RHICmdList, uint32 NumSorted, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+		FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks, FRHIShaderResourceView* PrevIndexSRV,
+		int32 KeyBits, int32 NumPasses, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV)
+	{
+		if (!NumSorted) {
+			return;
+		}
+
+		DispatchDepthRange(RHICmdList, NumSorted, WVP, PosRotSRV, ChunkIndicesSRV, VisibleChunksSRV, NumVisibleChunks);
+
+		RHICmdList.Transition(FRHITransitionInfo(DepthRangeUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+
+		{
+			TShaderMapRef<FGSResortKeysCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+			FGSResortKeysCS::FParameters Parameters;
+			Parameters.gNumParticles = NumSorted;
+			Parameters.gKeyBits = KeyBits;
+			Parameters.gWVP = WVP;
+			Parameters.gPosRot = PosRotSRV;
+			Parameters.gPrevIndices = PrevIndexSRV;
+			Parameters.gDepthRange = DepthRangeUAV;
+			Parameters.gKeys = KeyUAV;
+			Parameters.gIndices = IndexUAV;
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, FComputeShaderUtils::GetGroupCountWrapped(NumSorted, ThreadGroupSize));
+		}
+
+		SortBlocks_RenderThread(RHICmdList, NumSorted, NumPasses, KeyUAV, IndexUAV);
+	}
+
+	void FDepthKeyGen::DispatchDepthRange(FRHIComputeCommandList& RHICmdList, uint32 NumParticles, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+		FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks)
+	{
+		checkf(DepthRangeUAV, TEXT("FDepthKeyGen::InitResources first"));
+
+		const bool bCulling = VisibleChunksSRV != nullptr;
+		FGSDepthRangeCS::FPermutationDomain Permutation;
+		Permutation.Set<FGSDepthRangeCS::FChunkCullingDim>(bCulling);
+
+		// both entries are minimized, the max as ~depth
+		RHICmdList.Transition(FRHITransitionInfo(DepthRangeUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+		RHICmdList.ClearUAVUint(DepthRangeUAV, FUintVector4(MAX_uint32));
+		RHICmdList.Transition(FRHITransitionInfo(DepthRangeUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+
+		{
+			TShaderMapRef<FGSDepthRangeCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), Permutation);
+			FGSDepthRangeCS::FParameters Parameters;
+			Parameters.gNumParticles = NumParticles;
+			Parameters.gWVP = WVP;
+			Parameters.gPosRot = PosRotSRV;
+			Parameters.gChunkIndices = ChunkIndicesSRV;
+			Parameters.gVisibleChunks = VisibleChunksSRV;
+			Parameters.gNumVisibleChunks = NumVisibleChunks;
+			Parameters.gDepthRange = DepthRangeUAV;
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, bCulling
+				? FComputeShaderUtils::GetGroupCountWrapped(NumVisibleChunks)
+				: FComputeShaderUtils::GetGroupCountWrapped(NumParticles, ThreadGroupSize));
+		}
+	}
+
+	void FDepthKeyGen::Dispatch(FRHIComputeCommandList& RHICmdList, uint32 NumParticles, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+		FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks,
+		int32 KeyBits, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV)
+	{
+		DispatchDepthRange(RHICmdList, NumParticles, WVP, PosRotSRV, ChunkIndicesSRV, VisibleChunksSRV, NumVisibleChunks);
+
+		const bool bCulling = VisibleChunksSRV != nullptr;
+		FGSDepthRangeCS::FPermutationDomain Permutation;
+		Permutation.Set<FGSDepthRangeCS::FChunkCullingDim>(bCulling);
+
+		RHICmdList.Transition(FRHITransitionInfo(DepthRangeUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+
+		{
+			TShaderMapRef<FGSSortKeysCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), Permutation);
+			FGSSortKeysCS::FParameters Parameters;
+			Parameters.gNumParticles = NumParticles;
+			Parameters.gKeyBits = KeyBits;
+			Parameters.gWVP = WVP;
+			Parameters.gPosRot = PosRotSRV;
+			Parameters.gChunkIndices = ChunkIndicesSRV;
+			Parameters.gVisibleChunks = VisibleChunksSRV;
+			Parameters.gNumVisibleChunks = NumVisibleChunks;
+			Parameters.gDepthRange = DepthRangeUAV;
+			Parameters.gKeys = KeyUAV;
+			Parameters.gIndices = IndexUAV;
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, bCulling
+				? FComputeShaderUtils::GetGroupCountWrapped(NumVisibleChunks)
+				: FComputeShaderUtils::GetGroupCountWrapped(NumParticles, ThreadGroupSize));
+		}
+
+		RHICmdList.Transition({
+			FRHITransitionInfo(KeyUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(IndexUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute) });
+	}
+
+	void FDepthKeyGen::Release()
+	{
+		DepthRangeUAV.SafeRelease();
+		DepthRangeBuffer.SafeRelease();
+	}
+}	// namespace GSSort
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  GS.Sort.Bench [NumKeys] [Iterations]
+*
+*  SortGPUBuffers over NumKeys random keys at every key width, then the block sorts of an incremental re-sort,
+*  GPU time from timestamp queries. Ends with a one line summary naming the adapter and the RHI.
+*/
+static FAutoConsoleCommand GSSortBenchCommand(
+	TEXT("GS.Sort.Bench"),
+	TEXT("GS.Sort.Bench [NumKeys=4000000] [Iterations=10] : GPU time of SortGPUBuffers for 16, 24 and 32 bit keys, and of an incremental re-sort."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const uint32 NumKeys = Args.Num() > 0 ? (uint32)FMath::Max(FCString::Atoi(*Args[0]), 1) : 4000000;
+			const int32 Iterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 10;
+
+			ENQUEUE_RENDER_COMMAND(GSSortBench)(
+				[NumKeys, Iterations](FRHICommandListImmediate& RHICmdList)
+				{
+					TArray<uint32> Keys;
+					TArray<uint32> Indices;
+					Keys.SetNumUninitialized(NumKeys);
+					Indices.SetNumUninitialized(NumKeys);
+
+					FRandomStream Random(NumKeys);
+					for (uint32 i = 0; i < NumKeys; ++i) {
+						Keys[i] = (uint32)Random.GetUnsignedInt();
+						Indices[i] = i;
+					}
+
+					// keys in 0 - 1, values in 2 - 3
+					FBufferRHIRef Buffers[4];
+					FShaderResourceViewRHIRef SRVs[4];
+					FUnorderedAccessViewRHIRef UAVs[4];
+					FGPUSortBuffers SortBuffers;
+					for (int32 i = 0; i < 4; ++i) {
+						Buffers[i] = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, NumKeys * sizeof(uint32), BUF_Static | BUF_ShaderResource | BUF_UnorderedAccess, TEXT("GSSortBench"));
+						SRVs[i] = RHICmdList.CreateShaderResourceView(Buffers[i], sizeof(uint32), PF_R32_UINT);
+						UAVs[i] = RHICmdList.CreateUnorderedAccessView(Buffers[i], PF_R32_UINT);
+					}
+					for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex) {
+						SortBuffers.RemoteKeySRVs[BufferIndex] = SRVs[BufferIndex];
+						SortBuffers.RemoteKeyUAVs[BufferIndex] = UAVs[BufferIndex];
+						SortBuffers.RemoteValueSRVs[BufferIndex] = SRVs[2 + BufferIndex];
+						SortBuffers.RemoteValueUAVs[BufferIndex] = UAVs[2 + BufferIndex];
+					}
+
+					auto TimeMs = [&RHICmdList](TFunctionRef<void()> Work)
+					{
+						FRenderQueryRHIRef Begin = RHICreateRenderQuery(RQT_AbsoluteTime);
+						FRenderQueryRHIRef End = RHICreateRenderQuery(RQT_AbsoluteTime);
+						RHICmdList.EndRenderQuery(Begin);
+						Work();
+						RHICmdList.EndRenderQuery(End);
+						RHICmdList.SubmitCommandsAndFlushGPU();
+
+						uint64 BeginMicroseconds = 0;
+						uint64 EndMicroseconds = 0;
+						RHIGetRenderQueryResult(Begin, BeginMicroseconds, true);
+						RHIGetRenderQueryResult(End, EndMicroseconds, true);
+						return (EndMicroseconds - BeginMicroseconds) / 1000.;
+					};
+
+					double BaselineMs = 0.;
+					double Ms = 0.;
+					FString Report = FString::Printf(TEXT("%s, %s, %u keys, %d iterations :"), *GRHIAdapterName, GDynamicRHI->GetName(), NumKeys, Iterations);
+					for (const int32 KeyBits : { 32, 24, 16 }) {
+						double TotalMs = 0.;
+						for (int32 Iteration = 0; Iteration < Iterations; ++Iteration) {
+							// unsorted input every time, the sort runs in place over the two buffers
+							for (int32 BufferIndex : { 0, 2 }) {
+								void* Dst = RHICmdList.LockBuffer(Buffers[BufferIndex], 0, NumKeys * sizeof(uint32), RLM_WriteOnly);
+								FMemory::Memcpy(Dst, BufferIndex == 0 ? Keys.GetData() : Indices.GetData(), NumKeys * sizeof(uint32));
+								RHICmdList.UnlockBuffer(Buffers[BufferIndex]);
+							}
+
+							TotalMs += TimeMs([&]() { SortGPUBuffers(RHICmdList, SortBuffers, 0, GSSort::GetKeyMask(KeyBits), NumKeys, ERHIFeatureLevel::Type::SM6); });
+						}
+
+						Ms = TotalMs / Iterations;
+						BaselineMs = KeyBits == 32 ? Ms : BaselineMs;
+						UE_LOG(LogGSSort, Display, TEXT("%u keys, %d bit : %d passes, %.3f ms, %.2fx the 32 bit sort"),
+							NumKeys, KeyBits, GSSort::GetNumRadixPasses(KeyBits), Ms, Ms / FMath::Max(BaselineMs, 1e-6));
+						Report += FString::Printf(TEXT(" %d bit %.3f ms,"), KeyBits, Ms);
+					}
+
+					// the block sorts are data independent, the re-key pass adds one read and write per key
+					const int32 NumPasses = FMath::Max(GSSort::GetIncrementalPasses(), 1);
+					RHICmdList.Transition({
+						FRHITransitionInfo(UAVs[0], ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+						FRHITransitionInfo(UAVs[2], ERHIAccess::Unknown, ERHIAccess::UAVCompute) });
+					double BlocksMs = 0.;
+					for (int32 Iteration = 0; Iteration < Iterations; ++Iteration) {
+						BlocksMs += TimeMs([&]() { GSSort::SortBlocks_RenderThread(RHICmdList, NumKeys, NumPasses, UAVs[0], UAVs[2]); });
+					}
+					BlocksMs /= Iterations;
+					UE_LOG(LogGSSort, Display, TEXT("%u keys, incremental re-sort : %d block sorts, %.3f ms, %.2fx the 16 bit sort"),
+						NumKeys, NumPasses, BlocksMs, BlocksMs / FMath::Max(Ms, 1e-6));
+
+					// one line for the record, with the adapter the numbers belong to
+					Report += FString::Printf(TEXT(" incremental (%d block sorts) %.3f ms"), NumPasses, BlocksMs);
+					UE_LOG(LogGSSort, Display, TEXT("GS.Sort.Bench : %s"), *Report);
+
+					for (int32 i = 0; i < 4; ++i) {
+						UAVs[i].SafeRelease();
+						SRVs[i].SafeRelease();
+						GSBufferPool::Release(Buffers[i]);
+					}
+				});
+		}));
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Reduced-bit sort keys
+*
+*  FGaussSplatSortKeyGen writes 32 bit keys, every re-sort then runs all eight 4 bit radix passes of SortGPUBuffers.
+*  FDepthKeyGen first reduces the view depth range of the splats on the GPU, then writes KeyBits wide keys
+*  normalized to that range, far splats first. Only the passes covering KeyBits run : 4 for 16 bit keys, 6 for 24.
+*
+*  Kernels (GaussSplatSortKeys.usf), ThreadGroupSize threads, particle index wrapped over the group grid
+*  (FComputeShaderUtils::GetGroupCountWrapped) :
+*    DepthRangeCS	view depth = mul(float4(pos, 1), gWVP).w of every particle in front of the camera,
+*			gDepthRange[0] = min asuint(depth), gDepthRange[1] = min ~asuint(depth)
+*    SortKeysCS		gKeys[i] = GetDepthKey, gIndices[i] = i. Particles behind the camera get the largest key.
+*  CHUNK_CULLING permutation : one group per entry of gVisibleChunks (GSCull::FVisibleChunk as uint4), lane j below
+*  its Num handles splat gChunkIndices[Begin + j] and writes entry OutOffset + j. The depth range only covers them.
+*    ResortKeysCS	gIndices[i] = gPrevIndices[i], gKeys[i] = its GetDepthKey : the previous order in the other buffer
+*    SortBlocksCS	one group per LocalSortBlockSize entries from gBlockOffset, bitonic sort of the block in groupshared,
+*			entries past gNumKeys padded with the largest key
+*
+*  Incremental re-sort : the keys order particles by clip w, which only depends on the depth axis of the view, so
+*  as long as that axis stays close to the one of the last full sort the previous order is nearly right. It is
+*  re-keyed in place and r.GS.Sort.Incremental.Passes block sorts at alternating half block offsets move every
+*  entry up to a block towards its place, instead of the full radix sort.
+*/
+namespace GSSort
+{
+	// bits per SortGPUBuffers pass
+	constexpr int32 RadixBits = 4;
+	constexpr int32 ThreadGroupSize = 256;
+	constexpr int32 LocalSortBlockSize = 4 * ThreadGroupSize;
+
+	// r.GS.Sort.KeyBits : 16, 24, or 32 for the full float keys of FGaussSplatSortKeyGen
+	int32 GetKeyBits();
+
+	// r.GS.Sort.Incremental.Passes, 0 when r.GS.Sort.Incremental is off
+	int32 GetIncrementalPasses();
+
+	// r.GS.Sort.Incremental.MaxAngle, in degrees
+	float GetIncrementalMaxAngle();
+
+	// angle in degrees between the depth axes (clip w) of two local-to-clip matrices
+	float GetDepthAxisAngle(const FMatrix44f& From, const FMatrix44f& To);
+
+	// NumPasses block sorts of the NumKeys first entries, alternately at offset 0 and LocalSortBlockSize / 2. KeyUAV
+	// and IndexUAV in UAVCompute.
+	void SortBlocks_RenderThread(FRHIComputeCommandList& RHICmdList, uint32 NumKeys, int32 NumPasses, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV);
+
+	FORCEINLINE uint32 GetKeyMask(int32 KeyBits)
+	{
+		return KeyBits >= 32 ? MAX_uint32 : (1u << KeyBits) - 1;
+	}
+
+	FORCEINLINE int32 GetNumRadixPasses(int32 KeyBits)
+	{
+		return FMath::DivideAndRoundUp(KeyBits, RadixBits);
+	}
+
+	// the key SortKeysCS writes for a particle at view depth Depth, CPU reference
+	FORCEINLINE uint32 GetDepthKey(float Depth, float MinDepth, float MaxDepth, int32 KeyBits)
+	{
+		const uint32 MaxKey = GetKeyMask(KeyBits);
+		if (Depth <= 0.f) {
+			return MaxKey;
+		}
+		const float Range = FMath::Max(MaxDepth - MinDepth, UE_SMALL_NUMBER);
+		const float Near = FMath::Clamp((MaxDepth - Depth) / Range, 0.f, 1.f);
+		return FMath::Min((uint32)(Near * (float)MaxKey + 0.5f), MaxKey);
+	}
+
+	// Only compute work, the Execute and Resort calls can be recorded in async compute RDG passes. KeyUAV and IndexUAV
+	// are expected in UAVCompute, as the RDG UAVs of the pass : only the depth range buffer is transitioned here.
+	class FDepthKeyGen
+	{
+	public:
+		// the depth range buffer, before recording the first key generation
+		void InitResources(FRHICommandListBase& RHICmdList);
+
+		// Keys and identity indices for NumParticles positions of PosRotSRV (7 floats per particle). Returns the
+		// number of keys to sort, the depth range never leaves the GPU.
+		uint32 Execute_RenderThread(FRHIComputeCommandList& RHICmdList, uint32 NumParticles, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+			int32 KeyBits, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV);
+
+		// Only the NumVisible splats of the NumVisibleChunks chunks of VisibleChunksSRV, see GSCull::CullChunks.
+		// Returns NumVisible.
+		uint32 Execute_RenderThread(FRHIComputeCommandList& RHICmdList, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+			FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks, uint32 NumVisible,
+			int32 KeyBits, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV);
+
+		// Incremental re-sort of the NumSorted entries the last sort left in PrevIndexSRV, for WVP, into KeyUAV and
+		// IndexUAV of the other sort buffer : the previous order stays drawable meanwhile. The culling arguments select
+		// the depth range set as above, null to take all NumSorted particles.
+		void Resort_RenderThread(FRHIComputeCommandList& RHICmdList, uint32 NumSorted, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+			FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks, FRHIShaderResourceView* PrevIndexSRV,
+			int32 KeyBits, int32 NumPasses, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV);
+
+		void Release();
+
+	private:
+		void DispatchDepthRange(FRHIComputeCommandList& RHICmdList, uint32 NumParticles, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+			FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks);
+
+		void Dispatch(FRHIComputeCommandList& RHICmdList, uint32 NumParticles, const FMatrix44f& WVP, FRHIShaderResourceView* PosRotSRV,
+			FRHIShaderResourceView* ChunkIndicesSRV, FRHIShaderResourceView* VisibleChunksSRV, uint32 NumVisibleChunks,
+			int32 KeyBits, FRHIUnorderedAccessView* KeyUAV, FRHIUnorderedAccessView* IndexUAV);
+
+		FBufferRHIRef DepthRangeBuffer;
+		FUnorderedAccessViewRHIRef DepthRangeUAV;
+	};
+}	// namespace GSSort
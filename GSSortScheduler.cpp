@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSortScheduler.h"
+#include "GSSortKeys.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderingThread.h"
+
+
+static TAutoConsoleVariable<float> CVarSortMinAngle(
+	TEXT("r.GS.Sort.MinAngle"),
+	0.1f,
+	TEXT("Rotation of the view since the last sort of an actor, in degrees, that triggers a new one."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarSortMinMove(
+	TEXT("r.GS.Sort.MinMove"),
+	0.002f,
+	TEXT("Move of the eye since the last sort of an actor, relative to the radius of its splats, that triggers a new one."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarSortMaxInterval(
+	TEXT("r.GS.Sort.MaxInterval"),
+	0.5f,
+	TEXT("Seconds after which any view change is sorted, even under r.GS.Sort.MinAngle and r.GS.Sort.MinMove. 0 never."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarSortMaxPerFrame(
+	TEXT("r.GS.Sort.MaxPerFrame"),
+	0,
+	TEXT("Actors sorted per frame at most, the others wait for the next frames. 0 for no limit."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarSortMaxPerSecond(
+	TEXT("r.GS.Sort.MaxPerSecond"),
+	0.f,
+	TEXT("Sorts per second at most, all actors together. 0 for no limit."),
+	ECVF_RenderThreadSafe);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// shared by all actors, render thread
+	struct FSortBudget
+	{
+		uint64 Frame = MAX_uint64;
+		double FrameSeconds = 0.;
+		int32 NumThisFrame = 0;
+		float Tokens = 0.f;
+		TArray<uint64> Waiting;			// WaitingSince of the actors denied last frame that have not asked yet this frame
+		TArray<uint64> DeniedThisFrame;
+
+		void BeginFrame()
+		{
+			if (Frame == GFrameCounterRenderThread) {
+				return;
+			}
+
+			const double Seconds = FPlatformTime::Seconds();
+			const float MaxPerSecond = CVarSortMaxPerSecond.GetValueOnRenderThread();
+			if (MaxPerSecond > 0.f) {
+				// a frame's worth of burst at most, so a budget saved up while idle is still spread. Without
+				// r.GS.Sort.MaxPerFrame that is what the rate grants over this frame, and never more than a second's.
+				const float FrameElapsed = (float)(Seconds - FrameSeconds);
+				const int32 MaxPerFrame = CVarSortMaxPerFrame.GetValueOnRenderThread();
+				const float FrameBurst = MaxPerFrame > 0 ? (float)MaxPerFrame : FMath::Min(FMath::CeilToFloat(MaxPerSecond * FrameElapsed), MaxPerSecond);
+				Tokens = FMath::Min(Tokens + FrameElapsed * MaxPerSecond, FMath::Max(1.f, FrameBurst));
+			}
+
+			Frame = GFrameCounterRenderThread;
+			FrameSeconds = Seconds;
+			NumThisFrame = 0;
+			Waiting = MoveTemp(DeniedThisFrame);
+			DeniedThisFrame.Reset();
+		}
+
+		// sorts left this frame
+		int32 GetAvailable() const
+		{
+			const int32 MaxPerFrame = CVarSortMaxPerFrame.GetValueOnRenderThread();
+			int32 Available = MaxPerFrame > 0 ? MaxPerFrame - NumThisFrame : MAX_int32;
+			if (CVarSortMaxPerSecond.GetValueOnRenderThread() > 0.f) {
+				Available = FMath::Min(Available, FMath::FloorToInt32(Tokens));
+			}
+			return Available;
+		}
+
+		bool TryAcquire(uint64 WaitingSince)
+		{
+			BeginFrame();
+
+			// the actors turned down last frame that waited longer go first, but only those still asking : a budget
+			// they leave, or one over what they can take, goes to the others
+			Waiting.RemoveSingleSwap(WaitingSince);
+			int32 NumAhead = 0;
+			for (const uint64 Since : Waiting) {
+				NumAhead += Since < WaitingSince ? 1 : 0;
+			}
+
+			const bool bGranted = GetAvailable() > NumAhead;
+			if (bGranted) {
+				++NumThisFrame;
+				Tokens = FMath::Max(Tokens - 1.f, 0.f);
+			}
+			else {
+				DeniedThisFrame.Add(WaitingSince);
+			}
+			return bGranted;
+		}
+	};
+
+	FSortBudget SortBudget;
+
+	// the local point projected to clip (0, 0, z, 0), none for orthographic views
+	bool GetEye(const FMatrix44f& LocalToClip, FVector3f& OutEye)
+	{
+		const FVector4f Eye = LocalToClip.Inverse().TransformFVector4(FVector4f(0.f, 0.f, 1.f, 0.f));
+		if (FMath::Abs(Eye.W) <= UE_SMALL_NUMBER) {
+			return false;
+		}
+		OutEye = FVector3f(Eye.X, Eye.Y, Eye.Z) / Eye.W;
+		return true;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSSort
+{
+	FViewDelta GetViewDelta(const FMatrix44f& From, const FMatrix44f& To)
+	{
+		FViewDelta Delta;
+		Delta.AngleDegrees = GetDepthAxisAngle(From, To);
+
+		FVector3f FromEye, ToEye;
+		if (GetEye(From, FromEye) && GetEye(To, ToEye)) {
+			Delta.Move = FVector3f::Distance(FromEye, ToEye);
+		}
+		return Delta;
+	}
+
+
+	/*
+	*  FSortSchedule
+	*/
+	bool FSortSchedule::Update(const FMatrix44f& WVP, const FBox3f& Bounds)
+	{
+		check(IsInRenderingThread());
+
+		if (!bRequested && WVP.Equals(SortedWVP, 0.f)) {
+			return false;
+		}
+
+		const double Seconds = FPlatformTime::Seconds();
+		if (!bRequested) {
+			const FViewDelta Delta = GetViewDelta(SortedWVP, WVP);
+
+			// eye distance to the actor origin when the splat bounds are unknown
+			float Radius = Bounds.IsValid ? Bounds.GetExtent().Size() : 0.f;
+			FVector3f Eye;
+			if (Radius <= 0.f && GetEye(WVP, Eye)) {
+				Radius = Eye.Size();
+			}
+
+			const float MaxInterval = CVarSortMaxInterval.GetValueOnRenderThread();
+			const bool bOverThreshold = Delta.AngleDegrees >= CVarSortMinAngle.GetValueOnRenderThread()
+				|| Delta.Move >= CVarSortMinMove.GetValueOnRenderThread() * FMath::Max(Radius, 1.f)
+				|| (MaxInterval > 0.f && Seconds - SortedSeconds >= MaxInterval);
+			if (!bOverThreshold) {
+				++Stats.NumSkipped;
+				return false;
+			}
+		}
+
+		WaitingSince = FMath::Min(WaitingSince, GFrameCounterRenderThread);
+		if (!SortBudget.TryAcquire(WaitingSince)) {
+			++Stats.NumDeferred;
+			return false;
+		}
+
+		SortedWVP = WVP;
+		SortedSeconds = Seconds;
+		WaitingSince = MAX_uint64;
+		bRequested = false;
+		++Stats.NumSorts;
+		return true;
+	}
+}	// namespace GSSort
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Sort scheduling
+*
+*  An actor re-sorts when its view turned by r.GS.Sort.MinAngle or its eye moved by r.GS.Sort.MinMove of the splat
+*  bounds since the last sort, both in the actor's local space, so a moving actor in front of a still camera counts
+*  too. Smaller changes are caught up after r.GS.Sort.MaxInterval. Sorts of all actors share a budget of
+*  r.GS.Sort.MaxPerFrame and r.GS.Sort.MaxPerSecond : an actor over budget waits, and the actors that have waited
+*  longest go first on the next frames. The budget is only held for them while they still ask, one that is not
+*  drawn any more leaves it to the others. Render thread only, see GS.Sort.Stats.
+*/
+namespace GSSort
+{
+	// how far the view moved between two local-to-clip matrices
+	struct FViewDelta
+	{
+		float AngleDegrees = 0.f;	// between the depth axes, see GetDepthAxisAngle
+		float Move = 0.f;		// of the eye, in local units. 0 for orthographic views, whose order ignores the eye.
+	};
+
+	FViewDelta GetViewDelta(const FMatrix44f& From, const FMatrix44f& To);
+
+	struct FSortStats
+	{
+		uint32 NumSorts = 0;
+		uint32 NumIncremental = 0;	// of NumSorts, re-sorts from the previous order
+		uint32 NumSkipped = 0;		// view changes under the thresholds, not sorted
+		uint32 NumDeferred = 0;		// sorts over budget, postponed to a later frame
+	};
+
+	class FSortSchedule
+	{
+	public:
+		// the splats changed : sort on the next Update regardless of the view
+		void RequestSort() { bRequested = true; }
+
+		// Once per view drawn. Bounds : local splat bounds, invalid when unknown. Returns whether to sort for WVP,
+		// which then becomes the reference of the thresholds.
+		bool Update(const FMatrix44f& WVP, const FBox3f& Bounds);
+
+		FSortStats Stats;
+
+	private:
+		FMatrix44f SortedWVP = FMatrix44f::Identity;
+		double SortedSeconds = 0.;
+		uint64 WaitingSince = MAX_uint64;	// frame of the first sort denied by the budget
+		bool bRequested = true;
+	};
+}	// namespace GSSort
@@ -0,0 +1,625 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSplatCompressed.h"
+#include "GSSplatKernels.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarCompactValidate(
+	TEXT("r.GS.Compact.Validate"),
+	0,
+	TEXT("When set, every compact VRAM load is decoded again on the CPU and checked against the quantization error bounds."),
+	ECVF_Default);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	using namespace GSCompressed;
+
+	constexpr float RotationRange = UE_INV_SQRT_2;
+
+	/*
+	*  compressed data, either owned by FCompressedSplats or mapped from disk
+	*/
+	struct FCompressedView
+	{
+		UINT NumParticles = 0;
+		uint32 NumChunks = 0;
+		const FChunkHeader* Chunks = nullptr;
+		const FPackedSplat* Splats = nullptr;
+		const uint8* ShRest = nullptr;
+	};
+
+	FORCEINLINE uint32 Quantize(float Value, float Min, float Max, int32 Bits)
+	{
+		const float Range = Max - Min;
+		const float T = Range > 0.f ? FMath::Clamp((Value - Min) / Range, 0.f, 1.f) : 0.f;
+		return (uint32)FMath::RoundToInt(T * (float)((1u << Bits) - 1));
+	}
+
+	FORCEINLINE float Dequantize(uint32 Quantized, float Min, float Max, int32 Bits)
+	{
+		return Min + (Max - Min) * ((float)Quantized / (float)((1u << Bits) - 1));
+	}
+
+	FORCEINLINE uint32 Pack111011(const FVector3f& Value, const FVector3f& Min, const FVector3f& Max)
+	{
+		return (Quantize(Value.X, Min.X, Max.X, 11) << 21) | (Quantize(Value.Y, Min.Y, Max.Y, 10) << 11) | Quantize(Value.Z, Min.Z, Max.Z, 11);
+	}
+
+	FORCEINLINE FVector3f Unpack111011(uint32 Packed, const FVector3f& Min, const FVector3f& Max)
+	{
+		return FVector3f(
+			Dequantize(Packed >> 21, Min.X, Max.X, 11),
+			Dequantize((Packed >> 11) & 0x3FF, Min.Y, Max.Y, 10),
+			Dequantize(Packed & 0x7FF, Min.Z, Max.Z, 11));
+	}
+
+	// largest component index in the top 2 bits, the other three as 10 bit values in [-1/sqrt2, 1/sqrt2]
+	uint32 PackRotation(const float* Rot)
+	{
+		FVector4f Q(Rot[0], Rot[1], Rot[2], Rot[3]);
+		const float Len = Q.Size();
+		Q = Len > 0.f ? Q / Len : FVector4f(1.f, 0.f, 0.f, 0.f);
+
+		int32 Largest = 0;
+		for (int32 c = 1; c < 4; ++c) {
+			if (FMath::Abs(Q[c]) > FMath::Abs(Q[Largest])) {
+				Largest = c;
+			}
+		}
+		const float Sign = Q[Largest] < 0.f ? -1.f : 1.f;
+
+		uint32 Packed = (uint32)Largest << 30;
+		int32 Shift = 20;
+		for (int32 c = 0; c < 4; ++c) {
+			if (c != Largest) {
+				Packed |= Quantize(Q[c] * Sign, -RotationRange, RotationRange, 10) << Shift;
+				Shift -= 10;
+			}
+		}
+		return Packed;
+	}
+
+	void UnpackRotation(uint32 Packed, float* OutRot)
+	{
+		const int32 Largest = Packed >> 30;
+		float SumSq = 0.f;
+		int32 Shift = 20;
+		for (int32 c = 0; c < 4; ++c) {
+			if (c != Largest) {
+				OutRot[c] = Dequantize((Packed >> Shift) & 0x3FF, -RotationRange, RotationRange, 10);
+				SumSq += OutRot[c] * OutRot[c];
+				Shift -= 10;
+			}
+		}
+		OutRot[Largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSq));
+	}
+
+	// rest coefficient k of a splat : 15 per channel, the first 3 live in sh0.yzw, the others in the band streams
+	FORCEINLINE float GetShRest(const PLY::FGaussSplatVertex& GSData, UINT i, int32 k)
+	{
+		const int32 Channel = k / 15;
+		const int32 j = k % 15;
+		if (j >= PLY::GetNumShRest(GSData.ShDegree)) {
+			return 0.f;		// not loaded
+		}
+		if (j < 3) {
+			return GSData.sh0[i * 3 + Channel][1 + j];
+		}
+		const int32 Band = (j - 3) / 4;
+		const TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>* Streams[3] = { &GSData.r_sh1_4[Band], &GSData.g_sh1_4[Band], &GSData.b_sh1_4[Band] };
+		return (*Streams[Channel])[i][(j - 3) % 4];
+	}
+
+	FORCEINLINE void SetShRest(PLY::FGaussSplatVertex& GSData, UINT i, int32 k, float Value)
+	{
+		const int32 Channel = k / 15;
+		const int32 j = k % 15;
+		if (j < 3) {
+			GSData.sh0[i * 3 + Channel][1 + j] = Value;
+			return;
+		}
+		const int32 Band = (j - 3) / 4;
+		TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>* Streams[3] = { &GSData.r_sh1_4[Band], &GSData.g_sh1_4[Band], &GSData.b_sh1_4[Band] };
+		(*Streams[Channel])[i][(j - 3) % 4] = Value;
+	}
+
+	FORCEINLINE uint32 Part1By2(uint32 X)
+	{
+		X &= 0x3FF;
+		X = (X | (X << 16)) & 0x30000FF;
+		X = (X | (X << 8)) & 0x300F00F;
+		X = (X | (X << 4)) & 0x30C30C3;
+		X = (X | (X << 2)) & 0x9249249;
+		return X;
+	}
+
+	void DecodeView(const FCompressedView& In, PLY::FGaussSplatVertex& GSData, int32 ShDegree)
+	{
+		PLY::AllocateStreams(GSData, In.NumParticles, ShDegree);
+		const int32 NumRest = PLY::GetNumShRest(ShDegree);
+		const int32 NumBandStreams = PLY::GetNumShBandStreams(ShDegree);
+
+		ParallelFor(In.NumChunks, [&](int32 ChunkIdx)
+			{
+				const FChunkHeader& Chunk = In.Chunks[ChunkIdx];
+				const UINT Begin = ChunkIdx * ChunkSize;
+				const UINT End = FMath::Min<UINT>(Begin + ChunkSize, In.NumParticles);
+
+				alignas(32) float ScaleX[ChunkSize];
+				alignas(32) float ScaleY[ChunkSize];
+				alignas(32) float ScaleZ[ChunkSize];
+
+				for (UINT i = Begin; i < End; ++i) {
+					const FPackedSplat& Splat = In.Splats[i];
+					const FVector3f Pos = Unpack111011(Splat.Position, Chunk.PosMin, Chunk.PosMax);
+					GSData.posrot[i * 7 + 0] = Pos.X;
+					GSData.posrot[i * 7 + 1] = Pos.Y;
+					GSData.posrot[i * 7 + 2] = Pos.Z;
+					UnpackRotation(Splat.Rotation, &GSData.posrot[i * 7 + 3]);
+
+					const FVector3f LogScale = Unpack111011(Splat.Scale, Chunk.LogScaleMin, Chunk.LogScaleMax);
+					ScaleX[i - Begin] = LogScale.X;
+					ScaleY[i - Begin] = LogScale.Y;
+					ScaleZ[i - Begin] = LogScale.Z;
+
+					for (int32 c = 0; c < 3; ++c) {
+						GSData.sh0[i * 3 + c].X = Dequantize(Splat.Color[c], Chunk.DcMin[c], Chunk.DcMax[c], 8);
+					}
+
+					const uint8* Rest = In.ShRest + (int64)i * NumShRest;
+					for (int32 k = 0; k < NumShRest; ++k) {
+						const int32 j = k % 15;
+						if (j < NumRest) {
+							SetShRest(GSData, i, k, Dequantize(Rest[k], Chunk.ShMin[k], Chunk.ShMax[k], 8));
+						}
+						else if (j < 3 || (j - 3) / 4 < NumBandStreams) {
+							SetShRest(GSData, i, k, 0.f);	// unused slot of an allocated stream
+						}
+					}
+				}
+
+				const int32 Count = End - Begin;
+				GSKernels::ActivateScale(ScaleX, ScaleX, Count);
+				GSKernels::ActivateScale(ScaleY, ScaleY, Count);
+				GSKernels::ActivateScale(ScaleZ, ScaleZ, Count);
+
+				for (UINT i = Begin; i < End; ++i) {
+					GSData.scl[i] = FVector4f(ScaleX[i - Begin], ScaleY[i - Begin], ScaleZ[i - Begin], In.Splats[i].Color[3] / 255.f);
+				}
+			});
+	}
+
+	/*
+	*  running squared error and source range of one attribute group
+	*/
+	struct FPsnrAccumulator
+	{
+		double SqError = 0.;
+		double Min = DBL_MAX;
+		double Max = -DBL_MAX;
+		uint64 Count = 0;
+
+		FORCEINLINE void Add(double Source, double Decoded)
+		{
+			SqError += (Source - Decoded) * (Source - Decoded);
+			Min = FMath::Min(Min, Source);
+			Max = FMath::Max(Max, Source);
+			++Count;
+		}
+
+		double Psnr() const
+		{
+			const double Mse = Count ? SqError / Count : 0.;
+			const double Peak = Max - Min;
+			return Mse > 0. ? 10. * FMath::LogX(10., Peak * Peak / Mse) : INFINITY;
+		}
+	};
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSCompressed
+{
+	void Encode(const PLY::FGaussSplatVertex& GSData, FCompressedSplats& Out, TArray<uint32>* OutOrder)
+	{
+		const UINT NumParticles = GSData.NumParticles;
+		auto GetPos = [&GSData](UINT i) { return FVector3f(GSData.posrot[i * 7 + 0], GSData.posrot[i * 7 + 1], GSData.posrot[i * 7 + 2]); };
+
+		// Morton order keeps chunks spatially tight, which is what makes 11-10-11 positions usable
+		FBox3f Bounds(ForceInit);
+		for (UINT i = 0; i < NumParticles; ++i) {
+			Bounds += GetPos(i);
+		}
+		const FVector3f Extent = Bounds.GetSize().ComponentMax(FVector3f(UE_SMALL_NUMBER));
+
+		TArray<uint64> Keys;
+		Keys.SetNumUninitialized(NumParticles);
+		ParallelFor(NumParticles, [&](int32 i)
+			{
+				const FVector3f T = (GetPos(i) - Bounds.Min) / Extent * 1023.f;
+				const uint32 Code = Part1By2((uint32)T.X) | (Part1By2((uint32)T.Y) << 1) | (Part1By2((uint32)T.Z) << 2);
+				Keys[i] = ((uint64)Code << 32) | (uint32)i;
+			});
+		Algo::Sort(Keys);
+
+		TArray<uint32> Order;
+		Order.SetNumUninitialized(NumParticles);
+		for (UINT i = 0; i < NumParticles; ++i) {
+			Order[i] = (uint32)Keys[i];
+		}
+
+		const int32 NumChunks = FMath::DivideAndRoundUp<int32>(NumParticles, ChunkSize);
+		Out.NumParticles = NumParticles;
+		Out.Chunks.SetNumUninitialized(NumChunks);
+		Out.Splats.SetNumUninitialized(NumParticles);
+		Out.ShRest.SetNumUninitialized((int64)NumParticles * NumShRest);
+
+		ParallelFor(NumChunks, [&](int32 ChunkIdx)
+			{
+				const UINT Begin = ChunkIdx * ChunkSize;
+				const UINT End = FMath::Min<UINT>(Begin + ChunkSize, NumParticles);
+
+				FChunkHeader& Chunk = Out.Chunks[ChunkIdx];
+				Chunk.PosMin = Chunk.LogScaleMin = Chunk.DcMin = FVector3f(UE_BIG_NUMBER);
+				Chunk.PosMax = Chunk.LogScaleMax = Chunk.DcMax = FVector3f(-UE_BIG_NUMBER);
+				for (int32 k = 0; k < NumShRest; ++k) {
+					Chunk.ShMin[k] = UE_BIG_NUMBER;
+					Chunk.ShMax[k] = -UE_BIG_NUMBER;
+				}
+
+				auto GetLogScale = [&GSData](UINT Src) { const FVector4f& S = GSData.scl[Src]; return FVector3f(FMath::Loge(S.X), FMath::Loge(S.Y), FMath::Loge(S.Z)); };
+				auto GetDc = [&GSData](UINT Src) { return FVector3f(GSData.sh0[Src * 3 + 0].X, GSData.sh0[Src * 3 + 1].X, GSData.sh0[Src * 3 + 2].X); };
+
+				for (UINT i = Begin; i < End; ++i) {
+					const UINT Src = Order[i];
+					Chunk.PosMin = Chunk.PosMin.ComponentMin(GetPos(Src));
+					Chunk.PosMax = Chunk.PosMax.ComponentMax(GetPos(Src));
+					Chunk.LogScaleMin = Chunk.LogScaleMin.ComponentMin(GetLogScale(Src));
+					Chunk.LogScaleMax = Chunk.LogScaleMax.ComponentMax(GetLogScale(Src));
+					Chunk.DcMin = Chunk.DcMin.ComponentMin(GetDc(Src));
+					Chunk.DcMax = Chunk.DcMax.ComponentMax(GetDc(Src));
+					for (int32 k = 0; k < NumShRest; ++k) {
+						const float Value = GetShRest(GSData, Src, k);
+						Chunk.ShMin[k] = FMath::Min(Chunk.ShMin[k], Value);
+						Chunk.ShMax[k] = FMath::Max(Chunk.ShMax[k], Value);
+					}
+				}
+
+				for (UINT i = Begin; i < End; ++i) {
+					const UINT Src = Order[i];
+					FPackedSplat& Splat = Out.Splats[i];
+					Splat.Position = Pack111011(GetPos(Src), Chunk.PosMin, Chunk.PosMax);
+					Splat.Rotation = PackRotation(&GSData.posrot[Src * 7 + 3]);
+					Splat.Scale = Pack111011(GetLogScale(Src), Chunk.LogScaleMin, Chunk.LogScaleMax);
+
+					const FVector3f Dc = GetDc(Src);
+					for (int32 c = 0; c < 3; ++c) {
+						Splat.Color[c] = (uint8)Quantize(Dc[c], Chunk.DcMin[c], Chunk.DcMax[c], 8);
+					}
+					Splat.Color[3] = (uint8)Quantize(GSData.scl[Src].W, 0.f, 1.f, 8);
+
+					uint8* Rest = &Out.ShRest[(int64)i * NumShRest];
+					for (int32 k = 0; k < NumShRest; ++k) {
+						Rest[k] = (uint8)Quantize(GetShRest(GSData, Src, k), Chunk.ShMin[k], Chunk.ShMax[k], 8);
+					}
+				}
+			});
+
+		if (OutOrder) {
+			*OutOrder = MoveTemp(Order);
+		}
+	}
+
+	void Decode(const FCompressedSplats& In, PLY::FGaussSplatVertex& GSData)
+	{
+		FCompressedView View;
+		View.NumParticles = In.NumParticles;
+		View.NumChunks = In.Chunks.Num();
+		View.Chunks = In.Chunks.GetData();
+		View.Splats = In.Splats.GetData();
+		View.ShRest = In.ShRest.GetData();
+		DecodeView(View, GSData, PLY::MaxShDegree);
+	}
+
+	FErrorReport Measure(const PLY::FGaussSplatVertex& Source, const FCompressedSplats& Compressed, const TArray<uint32>& Order)
+	{
+		PLY::FGaussSplatVertex Decoded;
+		Decode(Compressed, Decoded);
+
+		FPsnrAccumulator Position, Rotation, Scale, Opacity, ShDc, ShRest;
+		for (UINT i = 0; i < Decoded.NumParticles; ++i) {
+			const UINT Src = Order[i];
+
+			for (int32 c = 0; c < 3; ++c) {
+				Position.Add(Source.posrot[Src * 7 + c], Decoded.posrot[i * 7 + c]);
+				Scale.Add(FMath::Loge(Source.scl[Src][c]), FMath::Loge(Decoded.scl[i][c]));
+				ShDc.Add(Source.sh0[Src * 3 + c].X, Decoded.sh0[i * 3 + c].X);
+			}
+			Opacity.Add(Source.scl[Src].W, Decoded.scl[i].W);
+
+			// q and -q are the same rotation
+			FVector4f SrcRot(Source.posrot[Src * 7 + 3], Source.posrot[Src * 7 + 4], Source.posrot[Src * 7 + 5], Source.posrot[Src * 7 + 6]);
+			FVector4f DecRot(Decoded.posrot[i * 7 + 3], Decoded.posrot[i * 7 + 4], Decoded.posrot[i * 7 + 5], Decoded.posrot[i * 7 + 6]);
+			SrcRot /= FMath::Max(SrcRot.Size(), UE_SMALL_NUMBER);
+			if (Dot4(SrcRot, DecRot) < 0.f) {
+				DecRot = -DecRot;
+			}
+			for (int32 c = 0; c < 4; ++c) {
+				Rotation.Add(SrcRot[c], DecRot[c]);
+			}
+
+			for (int32 k = 0; k < NumShRest; ++k) {
+				ShRest.Add(GetShRest(Source, Src, k), GetShRest(Decoded, i, k));
+			}
+		}
+
+		FErrorReport Report;
+		Report.PositionPsnr = Position.Psnr();
+		Report.RotationPsnr = Rotation.Psnr();
+		Report.ScalePsnr = Scale.Psnr();
+		Report.OpacityPsnr = Opacity.Psnr();
+		Report.ShDcPsnr = ShDc.Psnr();
+		Report.ShRestPsnr = ShRest.Psnr();
+		Report.SourceBytes = (uint64)Source.NumParticles * 62 * sizeof(float);
+		Report.CompressedBytes = sizeof(FFileHeader) + Compressed.Chunks.Num() * sizeof(FChunkHeader)
+			+ Compressed.Splats.Num() * sizeof(FPackedSplat) + Compressed.ShRest.Num();
+		return Report;
+	}
+
+	void FErrorReport::Log(const FString& Name) const
+	{
+		UE_LOG(LogGSLoader, Display, TEXT("%s : %.1f MB -> %.1f MB (%.2fx)"), *Name,
+			SourceBytes / (1024. * 1024.), CompressedBytes / (1024. * 1024.), (double)SourceBytes / FMath::Max<uint64>(CompressedBytes, 1));
+		UE_LOG(LogGSLoader, Display, TEXT("  PSNR dB : position %.2f  rotation %.2f  log scale %.2f  opacity %.2f  sh dc %.2f  sh rest %.2f"),
+			PositionPsnr, RotationPsnr, ScalePsnr, OpacityPsnr, ShDcPsnr, ShRestPsnr);
+	}
+
+	bool WriteFile(const FString& Filename, const FCompressedSplats& Compressed)
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+		if (!Writer) {
+			UE_LOG(LogGSLoader, Error, TEXT("could not create \"%s\""), *Filename);
+			return false;
+		}
+
+		FFileHeader Header;
+		Header.Magic = FileMagic;
+		Header.Version = FileVersion;
+		Header.NumParticles = Compressed.NumParticles;
+		Header.NumChunks = Compressed.Chunks.Num();
+
+		Writer->Serialize(&Header, sizeof(Header));
+		Writer->Serialize(const_cast<FChunkHeader*>(Compressed.Chunks.GetData()), Compressed.Chunks.Num() * sizeof(FChunkHeader));
+		Writer->Serialize(const_cast<FPackedSplat*>(Compressed.Splats.GetData()), Compressed.Splats.Num() * sizeof(FPackedSplat));
+		Writer->Serialize(const_cast<uint8*>(Compressed.ShRest.GetData()), Compressed.ShRest.Num());
+
+		return Writer->Close() && !Writer->IsError();
+	}
+
+	bool LoadFile(const FString& Filename, PLY::FGaussSplatVertex& GSData, int32 ShDegree)
+	{
+		// region before handle
+		TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+		if (!MappedFile) {
+			return false;
+		}
+		TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (!MappedRegion || MappedRegion->GetMappedSize() < (int64)sizeof(FFileHeader)) {
+			return false;
+		}
+
+		const uint8* Data = MappedRegion->GetMappedPtr();
+		FFileHeader Header;
+		FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+		const uint64 ExpectedSize = sizeof(FFileHeader) + (uint64)Header.NumChunks * sizeof(FChunkHeader)
+			+ (uint64)Header.NumParticles * (sizeof(FPackedSplat) + NumShRest);
+		if (Header.Magic != FileMagic || Header.Version != FileVersion
+			|| Header.NumChunks != (uint32)FMath::DivideAndRoundUp<uint64>(Header.NumParticles, ChunkSize)
+			|| (uint64)MappedRegion->GetMappedSize() < ExpectedSize) {
+			UE_LOG(LogGSLoader, Warning, TEXT("\"%s\" is not a valid version %u compressed splat file"), *Filename, FileVersion);
+			return false;
+		}
+
+		FCompressedView View;
+		View.NumParticles = Header.NumParticles;
+		View.NumChunks = Header.NumChunks;
+		View.Chunks = reinterpret_cast<const FChunkHeader*>(Data + sizeof(FFileHeader));
+		View.Splats = reinterpret_cast<const FPackedSplat*>(View.Chunks + Header.NumChunks);
+		View.ShRest = reinterpret_cast<const uint8*>(View.Splats + Header.NumParticles);
+		DecodeView(View, GSData, ShDegree);
+		return true;
+	}
+
+	bool CompressPlyFile(const FString& PlyFilename, const FString& CompressedFilename, FErrorReport* OutReport)
+	{
+		PLY::FGaussSplatVertex GSData;
+		if (!PLY::LoadPlyFile(PlyFilename, GSData)) {
+			UE_LOG(LogGSLoader, Error, TEXT("could not load \"%s\""), *PlyFilename);
+			return false;
+		}
+
+		FCompressedSplats Compressed;
+		TArray<uint32> Order;
+		Encode(GSData, Compressed, &Order);
+
+		if (OutReport) {
+			*OutReport = Measure(GSData, Compressed, Order);
+		}
+		return WriteFile(CompressedFilename, Compressed);
+	}
+
+	FString GetCompressedFilename(const FString& SourceFilename)
+	{
+		return FPaths::ChangeExtension(SourceFilename, TEXT("gsplatz"));
+	}
+
+	bool IsCompressedFile(const FString& Filename)
+	{
+		return FPaths::GetExtension(Filename).Equals(TEXT("gsplatz"), ESearchCase::IgnoreCase);
+	}
+
+
+	/*
+	*  FGpuSplats
+	*/
+	uint64 FGpuSplats::GetVramBytes() const
+	{
+		return (uint64)Chunks.GetResourceDataSize() + Splats.GetResourceDataSize() + ShRest.GetResourceDataSize() + posrot.GetResourceDataSize();
+	}
+
+	void BuildGpuSplats(const PLY::FGaussSplatVertex& Source, int32 ShDegree, FGpuSplats& Out)
+	{
+		FCompressedSplats Compressed;
+		TArray<uint32> Order;
+		Encode(Source, Compressed, &Order);
+
+		const UINT NumParticles = Compressed.NumParticles;
+		const int32 NumRest = PLY::GetNumShRest(ShDegree);
+		const uint32 ShRestStride = GetShRestStride(ShDegree);
+
+		Out.NumParticles = NumParticles;
+		Out.ShDegree = ShDegree;
+		Out.Chunks.Reset(Compressed.Chunks.Num());
+		Out.Chunks.Append(Compressed.Chunks);
+		Out.Splats.Reset(Compressed.Splats.Num());
+		Out.Splats.Append(Compressed.Splats);
+		Out.ShRest.SetNumZeroed(NumParticles * ShRestStride);
+		Out.posrot.SetNumUninitialized(NumParticles * 7);
+
+		ParallelFor(Compressed.Chunks.Num(), [&](int32 ChunkIdx)
+			{
+				const FChunkHeader& Chunk = Compressed.Chunks[ChunkIdx];
+				const UINT Begin = ChunkIdx * ChunkSize;
+				const UINT End = FMath::Min<UINT>(Begin + ChunkSize, NumParticles);
+
+				for (UINT i = Begin; i < End; ++i) {
+					// sort keys see the positions the vertex stage decodes
+					const FVector3f Pos = Unpack111011(Compressed.Splats[i].Position, Chunk.PosMin, Chunk.PosMax);
+					Out.posrot[i * 7 + 0] = Pos.X;
+					Out.posrot[i * 7 + 1] = Pos.Y;
+					Out.posrot[i * 7 + 2] = Pos.Z;
+					UnpackRotation(Compressed.Splats[i].Rotation, &Out.posrot[i * 7 + 3]);
+
+					const uint8* Src = &Compressed.ShRest[(int64)i * NumShRest];
+					uint8* Dst = reinterpret_cast<uint8*>(&Out.ShRest[i * ShRestStride]);
+					for (int32 c = 0; c < 3; ++c) {
+						FMemory::Memcpy(Dst + c * NumRest, Src + c * 15, NumRest);
+					}
+				}
+			});
+
+		if (CVarCompactValidate.GetValueOnAnyThread() != 0) {
+			MeasureGpu(Source, Out, Order).Log(FString::Printf(TEXT("compact %u splats, SH degree %d"), NumParticles, ShDegree));
+		}
+	}
+
+	void DecodeGpu(const FGpuSplats& In, PLY::FGaussSplatVertex& GSData)
+	{
+		PLY::AllocateStreams(GSData, In.NumParticles, In.ShDegree);
+		const int32 NumRest = PLY::GetNumShRest(In.ShDegree);
+		const int32 NumBandStreams = PLY::GetNumShBandStreams(In.ShDegree);
+		const uint32 ShRestStride = GetShRestStride(In.ShDegree);
+
+		ParallelFor(In.Chunks.Num(), [&](int32 ChunkIdx)
+			{
+				const FChunkHeader& Chunk = In.Chunks[ChunkIdx];
+				const UINT Begin = ChunkIdx * ChunkSize;
+				const UINT End = FMath::Min<UINT>(Begin + ChunkSize, In.NumParticles);
+
+				for (UINT i = Begin; i < End; ++i) {
+					const FPackedSplat& Splat = In.Splats[i];
+					const FVector3f Pos = Unpack111011(Splat.Position, Chunk.PosMin, Chunk.PosMax);
+					GSData.posrot[i * 7 + 0] = Pos.X;
+					GSData.posrot[i * 7 + 1] = Pos.Y;
+					GSData.posrot[i * 7 + 2] = Pos.Z;
+					UnpackRotation(Splat.Rotation, &GSData.posrot[i * 7 + 3]);
+
+					const FVector3f LogScale = Unpack111011(Splat.Scale, Chunk.LogScaleMin, Chunk.LogScaleMax);
+					GSData.scl[i] = FVector4f(FMath::Exp(LogScale.X), FMath::Exp(LogScale.Y), FMath::Exp(LogScale.Z), Splat.Color[3] / 255.f);
+
+					for (int32 c = 0; c < 3; ++c) {
+						GSData.sh0[i * 3 + c].X = Dequantize(Splat.Color[c], Chunk.DcMin[c], Chunk.DcMax[c], 8);
+					}
+
+					const uint8* Rest = reinterpret_cast<const uint8*>(&In.ShRest[i * ShRestStride]);
+					for (int32 c = 0; c < 3; ++c) {
+						for (int32 j = 0; j < 15; ++j) {
+							if (j < NumRest) {
+								SetShRest(GSData, i, c * 15 + j, Dequantize(Rest[c * NumRest + j], Chunk.ShMin[c * 15 + j], Chunk.ShMax[c * 15 + j], 8));
+							}
+							else if (j < 3 || (j - 3) / 4 < NumBandStreams) {
+								SetShRest(GSData, i, c * 15 + j, 0.f);	// unused slot of an allocated stream
+							}
+						}
+					}
+				}
+			});
+	}
+
+	FErrorBounds MeasureGpu(const PLY::FGaussSplatVertex& Source, const FGpuSplats& Gpu, const TArray<uint32>& Order)
+	{
+		PLY::FGaussSplatVertex Decoded;
+		DecodeGpu(Gpu, Decoded);
+		const int32 NumRest = PLY::GetNumShRest(FMath::Min(Gpu.ShDegree, Source.ShDegree));
+
+		// |error| / step of a Bits wide range, a flat range decodes exactly
+		auto Steps = [](float Error, float Min, float Max, int32 Bits)
+			{
+				const float Step = (Max - Min) / (float)((1u << Bits) - 1);
+				return Step > 0.f ? FMath::Abs(Error) / Step : 0.f;
+			};
+
+		FErrorBounds Bounds;
+		for (UINT i = 0; i < Decoded.NumParticles; ++i) {
+			const FChunkHeader& Chunk = Gpu.Chunks[i / ChunkSize];
+			const UINT Src = Order[i];
+			const int32 Bits[3] = { 11, 10, 11 };
+
+			for (int32 c = 0; c < 3; ++c) {
+				Bounds.Position = FMath::Max(Bounds.Position, Steps(Source.posrot[Src * 7 + c] - Decoded.posrot[i * 7 + c], Chunk.PosMin[c], Chunk.PosMax[c], Bits[c]));
+				Bounds.Scale = FMath::Max(Bounds.Scale, Steps(FMath::Loge(Source.scl[Src][c]) - FMath::Loge(Decoded.scl[i][c]), Chunk.LogScaleMin[c], Chunk.LogScaleMax[c], Bits[c]));
+				Bounds.ShDc = FMath::Max(Bounds.ShDc, Steps(Source.sh0[Src * 3 + c].X - Decoded.sh0[i * 3 + c].X, Chunk.DcMin[c], Chunk.DcMax[c], 8));
+				for (int32 j = 0; j < NumRest; ++j) {
+					const int32 k = c * 15 + j;
+					Bounds.ShRest = FMath::Max(Bounds.ShRest, Steps(GetShRest(Source, Src, k) - GetShRest(Decoded, i, k), Chunk.ShMin[k], Chunk.ShMax[k], 8));
+				}
+			}
+			Bounds.Opacity = FMath::Max(Bounds.Opacity, Steps(Source.scl[Src].W - Decoded.scl[i].W, 0.f, 1.f, 8));
+
+			// q and -q are the same rotation
+			FVector4f SrcRot(Source.posrot[Src * 7 + 3], Source.posrot[Src * 7 + 4], Source.posrot[Src * 7 + 5], Source.posrot[Src * 7 + 6]);
+			FVector4f DecRot(Decoded.posrot[i * 7 + 3], Decoded.posrot[i * 7 + 4], Decoded.posrot[i * 7 + 5], Decoded.posrot[i * 7 + 6]);
+			SrcRot /= FMath::Max(SrcRot.Size(), UE_SMALL_NUMBER);
+			if (Dot4(SrcRot, DecRot) < 0.f) {
+				DecRot = -DecRot;
+			}
+			for (int32 c = 0; c < 4; ++c) {
+				Bounds.Rotation = FMath::Max(Bounds.Rotation, Steps(SrcRot[c] - DecRot[c], -RotationRange, RotationRange, 10));
+			}
+		}
+		return Bounds;
+	}
+
+	bool FErrorBounds::IsWithinBounds() const
+	{
+		return Position <= MaxSteps && Scale <= MaxSteps && Opacity <= MaxSteps && ShDc <= MaxSteps && ShRest <= MaxSteps
+			&& Rotation <= MaxRotationSteps;
+	}
+
+	void FErrorBounds::Log(const FString& Name) const
+	{
+		UE_LOG(LogGSLoader, Display, TEXT("%s : max error in steps : position %.3f  rotation %.3f  log scale %.3f  opacity %.3f  sh dc %.3f  sh rest %.3f  %s"),
+			*Name, Position, Rotation, Scale, Opacity, ShDc, ShRest, IsWithinBounds() ? TEXT("ok") : TEXT("OUT OF BOUNDS"));
+	}
+}	// namespace GSCompressed
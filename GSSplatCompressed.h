@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GSPlyLoader.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Chunk-quantized splat storage (.gsplatz)
+*
+*  Splats are reordered along a Morton curve and grouped in chunks of ChunkSize. Each chunk stores its own
+*  bounds, and every splat is quantized against them :
+*    position	11-10-11 bits within the chunk box
+*    rotation	2 + 3 x 10 bits, "smallest three"
+*    scale		11-10-11 bits of log(scale) within the chunk range
+*    color		8 bit SH DC per channel within the chunk range, 8 bit opacity
+*    SH rest	8 bit per coefficient within the chunk range
+*  That is 61 bytes per splat plus about 2 bytes of chunk bounds, against 248 for a degree 3 PLY.
+*/
+namespace GSCompressed
+{
+	constexpr uint32 FileMagic = 0x5A505347;	// "GSPZ"
+	constexpr uint32 FileVersion = 1;
+	constexpr int32 ChunkSize = 256;
+	constexpr int32 NumShRest = 45;
+
+	struct FFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumParticles;
+		uint32 NumChunks;
+	};
+
+	struct FChunkHeader
+	{
+		FVector3f PosMin, PosMax;
+		FVector3f LogScaleMin, LogScaleMax;
+		FVector3f DcMin, DcMax;
+		float ShMin[NumShRest];
+		float ShMax[NumShRest];
+	};
+
+	struct FPackedSplat
+	{
+		uint32 Position;
+		uint32 Rotation;
+		uint32 Scale;
+		uint8 Color[4];		// dc r, g, b, opacity
+	};
+
+	struct FCompressedSplats
+	{
+		UINT NumParticles = 0;
+		TArray<FChunkHeader> Chunks;
+		TArray<FPackedSplat> Splats;
+		TArray<uint8> ShRest;		// NumShRest per splat
+	};
+
+	// PSNR per attribute group, peak = value range of the source
+	struct FErrorReport
+	{
+		double PositionPsnr = 0.;
+		double RotationPsnr = 0.;
+		double ScalePsnr = 0.;
+		double OpacityPsnr = 0.;
+		double ShDcPsnr = 0.;
+		double ShRestPsnr = 0.;
+		uint64 SourceBytes = 0;		// 62 floats per splat, as stored in a degree 3 PLY
+		uint64 CompressedBytes = 0;
+
+		void Log(const FString& Name) const;
+	};
+
+	// Multithreaded over chunks. OutOrder[i] is the source index of compressed splat i.
+	void Encode(const PLY::FGaussSplatVertex& GSData, FCompressedSplats& Out, TArray<uint32>* OutOrder = nullptr);
+
+	// Multithreaded over chunks, writes straight into the upload streams.
+	void Decode(const FCompressedSplats& In, PLY::FGaussSplatVertex& GSData);
+
+	FErrorReport Measure(const PLY::FGaussSplatVertex& Source, const FCompressedSplats& Compressed, const TArray<uint32>& Order);
+
+	bool WriteFile(const FString& Filename, const FCompressedSplats& Compressed);
+	bool LoadFile(const FString& Filename, PLY::FGaussSplatVertex& GSData, int32 ShDegree = PLY::MaxShDegree);
+
+	// PLY::LoadPlyFile + Encode + WriteFile, optionally measuring the error against the source
+	bool CompressPlyFile(const FString& PlyFilename, const FString& CompressedFilename, FErrorReport* OutReport = nullptr);
+
+	FString GetCompressedFilename(const FString& SourceFilename);
+	bool IsCompressedFile(const FString& Filename);
+
+
+	/*
+	*  FCompressedSplats as AGSActor keeps them in VRAM with bCompactLayout, decoded by the vertex stage (COMPACT_SPLATS)
+	*    Chunks	StructuredBuffer<float>, FChunkHeader as is, ChunkStride floats per chunk
+	*    Splats	StructuredBuffer<uint4>, FPackedSplat as is, Color read as r | g << 8 | b << 16 | a << 24
+	*    ShRest	StructuredBuffer<uint>, GetShRestStride(ShDegree) per splat, byte c * GetNumShRest(ShDegree) + j
+	*		is rest coefficient j of channel c, against ShMin / ShMax [c * 15 + j] of its chunk
+	*    posrot	float positions and rotations for the sort key generation only
+	*/
+	constexpr uint32 ChunkStride = sizeof(FChunkHeader) / sizeof(float);
+
+	// uint per splat holding the SH rest bytes of ShDegree
+	FORCEINLINE uint32 GetShRestStride(int32 ShDegree)
+	{
+		return FMath::DivideAndRoundUp<uint32>(3 * PLY::GetNumShRest(ShDegree), 4);
+	}
+
+	struct FGpuSplats
+	{
+		UINT NumParticles = 0;
+		int32 ShDegree = PLY::MaxShDegree;
+		TResourceArray<FChunkHeader> Chunks;
+		TResourceArray<FPackedSplat> Splats;
+		TResourceArray<uint32> ShRest;
+		TResourceArray<float, VERTEXBUFFER_ALIGNMENT> posrot;
+
+		uint64 GetVramBytes() const;
+	};
+
+	// Largest decode error per attribute group in quantization steps of its chunk range, so 0.5 is exact rounding.
+	// Rotation is measured on the components of the unit quaternion.
+	struct FErrorBounds
+	{
+		static constexpr float MaxSteps = 0.5f + 1e-3f;
+		static constexpr float MaxRotationSteps = 3.f;	// the largest component is rebuilt from the other three
+
+		float Position = 0.f;
+		float Rotation = 0.f;
+		float Scale = 0.f;
+		float Opacity = 0.f;
+		float ShDc = 0.f;
+		float ShRest = 0.f;
+
+		bool IsWithinBounds() const;
+		void Log(const FString& Name) const;
+	};
+
+	// Encode + repack to the VRAM layout. The SH rest bytes above ShDegree are dropped.
+	// With r.GS.Compact.Validate set, DecodeGpu is checked against Source and the result logged.
+	void BuildGpuSplats(const PLY::FGaussSplatVertex& Source, int32 ShDegree, FGpuSplats& Out);
+
+	// CPU reference of the COMPACT_SPLATS vertex stage decode, into upload streams in Morton order.
+	void DecodeGpu(const FGpuSplats& In, PLY::FGaussSplatVertex& GSData);
+
+	// Decoded splat i against Source[Order[i]].
+	FErrorBounds MeasureGpu(const PLY::FGaussSplatVertex& Source, const FGpuSplats& Gpu, const TArray<uint32>& Order);
+}	// namespace GSCompressed
@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSplatCooked.h"
+#include "GSSplatDerivedData.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSCooked
+{
+	FString GetCookedFilename(const FString& SourceFilename)
+	{
+		return FPaths::ChangeExtension(SourceFilename, TEXT("gsplat"));
+	}
+
+	FString FindCookedFile(const FString& Filename)
+	{
+		if (FPaths::GetExtension(Filename).Equals(TEXT("gsplat"), ESearchCase::IgnoreCase)) {
+			return Filename;
+		}
+
+		const FString Cooked = GetCookedFilename(Filename);
+		const FDateTime CookedTime = IFileManager::Get().GetTimeStamp(*Cooked);
+		if (CookedTime == FDateTime::MinValue() || CookedTime < IFileManager::Get().GetTimeStamp(*Filename)) {
+			return FString();
+		}
+		return Cooked;
+	}
+
+	bool WriteCookedFile(const FString& Filename, PLY::FGaussSplatVertex& GSData)
+	{
+		if (GSData.ShDegree != PLY::MaxShDegree) {
+			UE_LOG(LogGSLoader, Error, TEXT("\"%s\" : cooked files hold every SH band, got degree %d"), *Filename, GSData.ShDegree);
+			return false;
+		}
+		PLY::FSplatStreams Streams = PLY::GetStreams(GSData);
+
+		FFileHeader Header;
+		FMemory::Memzero(Header);
+		Header.Magic = FileMagic;
+		Header.Version = FileVersion;
+		Header.NumParticles = GSData.NumParticles;
+		Header.NumStreams = PLY::SplatStream_Count;
+
+		uint64 Offset = Align(sizeof(FFileHeader), StreamAlignment);
+		for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+			Header.Streams[s].Offset = Offset;
+			Header.Streams[s].Size = Streams.Streams[s]->GetResourceDataSize();
+			Offset = Align(Offset + Header.Streams[s].Size, StreamAlignment);
+		}
+
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+		if (!Writer) {
+			UE_LOG(LogGSLoader, Error, TEXT("could not create \"%s\""), *Filename);
+			return false;
+		}
+
+		static const uint8 Padding[StreamAlignment] = {};
+		Writer->Serialize(&Header, sizeof(Header));
+
+		for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+			Writer->Serialize(const_cast<uint8*>(Padding), Header.Streams[s].Offset - Writer->Tell());
+			Writer->Serialize(const_cast<void*>(Streams.Streams[s]->GetResourceData()), Header.Streams[s].Size);
+		}
+		Writer->Serialize(const_cast<uint8*>(Padding), Offset - Writer->Tell());
+
+		return Writer->Close() && !Writer->IsError();
+	}
+
+	bool CookPlyFile(const FString& PlyFilename, const FString& CookedFilename)
+	{
+		PLY::FGaussSplatVertex GSData;
+		if (!PLY::LoadPlyFile(PlyFilename, GSData)) {
+			UE_LOG(LogGSLoader, Error, TEXT("could not load \"%s\""), *PlyFilename);
+			return false;
+		}
+		return WriteCookedFile(CookedFilename, GSData);
+	}
+
+
+	/*
+	*  FMappedSplatFile
+	*/
+	FMappedSplatFile::FMappedSplatFile() = default;
+
+	FMappedSplatFile::~FMappedSplatFile()
+	{
+		Close();
+	}
+
+	bool FMappedSplatFile::Open(const FString& Filename)
+	{
+		Close();
+		if (Filename.IsEmpty()) {
+			return false;
+		}
+
+		MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+		if (!MappedFile) {
+			return false;
+		}
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (!MappedRegion || MappedRegion->GetMappedSize() < (int64)sizeof(FFileHeader)) {
+			Close();
+			return false;
+		}
+
+		const uint8* Data = MappedRegion->GetMappedPtr();
+		const uint64 Size = MappedRegion->GetMappedSize();
+
+		FFileHeader Header;
+		FMemory::Memcpy(&Header, Data, sizeof(Header));
+		if (Header.Magic != FileMagic || Header.Version != FileVersion || Header.NumStreams != PLY::SplatStream_Count) {
+			UE_LOG(LogGSLoader, Warning, TEXT("\"%s\" is not a version %u cooked splat file"), *Filename, FileVersion);
+			Close();
+			return false;
+		}
+
+		for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+			const FStreamDesc& Desc = Header.Streams[s];
+			if (Desc.Size != (uint64)Header.NumParticles * PLY::GetStreamStride(s) || Desc.Offset + Desc.Size > Size || Desc.Size > MAX_uint32) {
+				UE_LOG(LogGSLoader, Warning, TEXT("\"%s\" is truncated or corrupt"), *Filename);
+				Close();
+				return false;
+			}
+			Arrays[s].Data = Data + Desc.Offset;
+			Arrays[s].Size = (uint32)Desc.Size;
+		}
+
+		NumParticles = Header.NumParticles;
+		return true;
+	}
+
+	void FMappedSplatFile::Close()
+	{
+		// region before handle
+		MappedRegion.Reset();
+		MappedFile.Reset();
+
+		for (FMappedResourceArray& Array : Arrays) {
+			Array.Data = nullptr;
+			Array.Size = 0;
+		}
+		NumParticles = 0;
+	}
+
+	PLY::FSplatStreams FMappedSplatFile::GetStreams(int32 ShDegree)
+	{
+		PLY::FSplatStreams Result;
+		Result.NumParticles = NumParticles;
+		Result.ShDegree = ShDegree;
+		for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+			Result.Streams[s] = PLY::IsStreamUsed(s, ShDegree) ? &Arrays[s] : nullptr;
+		}
+		return Result;
+	}
+
+
+	/*
+	*  FSplatPayload
+	*/
+	bool FSplatPayload::Load(const FString& Filename, int32 InShDegree, bool bInCovariance)
+	{
+		GSLoadArena::FLoadScope LoadScope(Filename);
+		ShDegree = InShDegree;
+		bCovariance = bInCovariance;
+		bCooked = CookedFile.Open(FindCookedFile(Filename));
+		if (!bCooked && !GSDerivedData::LoadPlyFileCached(Filename, GSData, ShDegree)) {
+			return false;
+		}
+
+		if (bCovariance) {
+			if (bCooked) {
+				const PLY::FSplatStreams Mapped = CookedFile.GetStreams(ShDegree);
+				GSData.NumParticles = Mapped.NumParticles;
+				GSData.posrot.SetNumUninitialized(Mapped.NumParticles * 7, false);
+				GSData.scl.SetNumUninitialized(Mapped.NumParticles, false);
+				FMemory::Memcpy(GSData.posrot.GetData(), Mapped.Streams[PLY::SplatStream_PosRot]->GetResourceData(), GSData.posrot.GetResourceDataSize());
+				FMemory::Memcpy(GSData.scl.GetData(), Mapped.Streams[PLY::SplatStream_Scale]->GetResourceData(), GSData.scl.GetResourceDataSize());
+			}
+			PLY::ConvertToCovariance(GSData.posrot.GetData(), GSData.scl.GetData(), GSData.NumParticles);
+			GSData.bCovariance = true;
+		}
+		return true;
+	}
+
+	PLY::FSplatStreams FSplatPayload::GetStreams()
+	{
+		if (!bCooked) {
+			return PLY::GetStreams(GSData);
+		}
+
+		// pages of the unused cooked bands are never touched
+		PLY::FSplatStreams Result = CookedFile.GetStreams(ShDegree);
+		if (bCovariance) {
+			Result.bCovariance = true;
+			Result.Streams[PLY::SplatStream_PosRot] = &GSData.posrot;
+			Result.Streams[PLY::SplatStream_Scale] = &GSData.scl;
+		}
+		return Result;
+	}
+}	// namespace GSCooked
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GSPlyLoader.h"
+#include "GSLoadArena.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Cooked splat container (.gsplat)
+*
+*  FFileHeader, then every PLY::ESplatStream exactly as AGSActor uploads it (activated, SH0 interleaved),
+*  each stream starting on a StreamAlignment boundary so the mapped pointers can be handed to the RHI as is.
+*/
+namespace GSCooked
+{
+	constexpr uint32 FileMagic = 0x4C505347;	// "GSPL"
+	constexpr uint32 FileVersion = 1;
+	constexpr uint32 StreamAlignment = 4096;
+
+	struct FStreamDesc
+	{
+		uint64 Offset;
+		uint64 Size;
+	};
+
+	struct FFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumParticles;
+		uint32 NumStreams;
+		FStreamDesc Streams[PLY::SplatStream_Count];
+	};
+
+	// "<dir>/<name>.gsplat" next to the source file
+	FString GetCookedFilename(const FString& SourceFilename);
+
+	// Filename itself when it is a .gsplat, otherwise the cooked sibling when it is newer than the source. Empty if none.
+	FString FindCookedFile(const FString& Filename);
+
+	bool WriteCookedFile(const FString& Filename, PLY::FGaussSplatVertex& GSData);
+
+	// PLY::LoadPlyFile + WriteCookedFile
+	bool CookPlyFile(const FString& PlyFilename, const FString& CookedFilename);
+
+	/*
+	*  Read-only mapping of a cooked file. Streams stay valid while the object is alive.
+	*/
+	class FMappedSplatFile
+	{
+	public:
+		FMappedSplatFile();
+		~FMappedSplatFile();
+
+		bool Open(const FString& Filename);
+		void Close();
+
+		// bands above ShDegree are left out
+		PLY::FSplatStreams GetStreams(int32 ShDegree = PLY::MaxShDegree);
+		UINT GetNumParticles() const { return NumParticles; }
+
+	private:
+		class FMappedResourceArray : public FResourceArrayInterface
+		{
+		public:
+			const void* Data = nullptr;
+			uint32 Size = 0;
+
+			virtual const void* GetResourceData() const override { return Data; }
+			virtual uint32 GetResourceDataSize() const override { return Size; }
+			virtual void Discard() override {}
+			virtual bool IsStatic() const override { return true; }
+			virtual bool GetAllowCPUAccess() const override { return false; }
+			virtual void SetAllowCPUAccess(bool bInNeedsCPUAccess) override {}
+		};
+
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+		FMappedResourceArray Arrays[PLY::SplatStream_Count];
+		UINT NumParticles = 0;
+	};
+
+	/*
+	*  Splats ready for upload, from a cooked mapping when there is one, from the derived-data cache or decoded
+	*  from the source otherwise.
+	*  Safe to fill on a worker thread and hand to the render thread afterwards. The decoded streams are pooled
+	*  (GSLoadArena), the next payload reuses them.
+	*/
+	struct FSplatPayload
+	{
+		GSLoadArena::FScratchRef Scratch = GSLoadArena::Acquire();
+		PLY::FGaussSplatVertex& GSData = Scratch->GSData;
+		FMappedSplatFile CookedFile;
+		bool bCooked = false;
+		bool bCovariance = false;
+		int32 ShDegree = PLY::MaxShDegree;
+
+		// bInCovariance : see PLY::ConvertToCovariance. A cooked mapping is read-only, its position-rotation and
+		// scale streams are copied into GSData and converted there.
+		bool Load(const FString& Filename, int32 InShDegree = PLY::MaxShDegree, bool bInCovariance = false);
+		PLY::FSplatStreams GetStreams();
+	};
+}	// namespace GSCooked
@@ -0,0 +1,337 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSplatCulling.h"
+#include "GSSplatCompressed.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+
+static_assert(GSCull::ChunkSize == GSCompressed::ChunkSize, "compact chunks are used as culling chunks as is");
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// splats with a 3 sigma extent above this are most likely floaters, they still get a finite box
+	constexpr float MaxSigmaExtent = 1e6f;
+
+	FORCEINLINE uint32 Part1By2(uint32 X)
+	{
+		X &= 0x3FF;
+		X = (X | (X << 16)) & 0x30000FF;
+		X = (X | (X << 8)) & 0x300F00F;
+		X = (X | (X << 4)) & 0x30C30C3;
+		X = (X | (X << 2)) & 0x9249249;
+		return X;
+	}
+
+	FORCEINLINE const float* GetPosRot(const PLY::FSplatStreams& Streams)
+	{
+		return static_cast<const float*>(Streams.Streams[PLY::SplatStream_PosRot]->GetResourceData());
+	}
+
+	FORCEINLINE const FVector4f* GetScale(const PLY::FSplatStreams& Streams)
+	{
+		return static_cast<const FVector4f*>(Streams.Streams[PLY::SplatStream_Scale]->GetResourceData());
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSCull
+{
+	void FSplatChunks::Reset()
+	{
+		Chunks.Reset();
+		Indices.Reset();
+	}
+
+	void FSplatChunks::Append(const FSplatChunks& Other)
+	{
+		const uint32 Offset = Indices.Num();
+		for (FChunk Chunk : Other.Chunks) {
+			Chunk.Begin += Offset;
+			Chunks.Add(Chunk);
+		}
+		Indices.Append(Other.Indices);
+	}
+
+	float GetRotatedSplatExtent(const FVector3f& Scale)
+	{
+		return FMath::Min(3.f * Scale.GetMax(), MaxSigmaExtent);
+	}
+
+	void GetSplatBounds(const PLY::FSplatStreams& Streams, uint32 i, FVector3f& OutCenter, FVector3f& OutExtent)
+	{
+		const float* PosRot = GetPosRot(Streams) + i * 7;
+		const FVector4f& Scale = GetScale(Streams)[i];
+		OutCenter = FVector3f(PosRot[0], PosRot[1], PosRot[2]);
+
+		if (Streams.bCovariance) {
+			// cov xx in posrot[3], yy in posrot[6], zz in scl.y
+			OutExtent = FVector3f(FMath::Sqrt(FMath::Max(PosRot[3], 0.f)), FMath::Sqrt(FMath::Max(PosRot[6], 0.f)), FMath::Sqrt(FMath::Max(Scale.Y, 0.f))) * 3.f;
+		}
+		else {
+			// any rotation of the scaled axes
+			OutExtent = FVector3f(GetRotatedSplatExtent(FVector3f(Scale.X, Scale.Y, Scale.Z)));
+		}
+		OutExtent = OutExtent.ComponentMin(FVector3f(MaxSigmaExtent));
+	}
+
+	void BuildChunks(const PLY::FSplatStreams& Streams, uint32 BaseIndex, FSplatChunks& Out)
+	{
+		const uint32 NumParticles = Streams.NumParticles;
+		if (!NumParticles) {
+			return;
+		}
+		const float* PosRot = GetPosRot(Streams);
+
+		FBox3f Box(ForceInit);
+		for (uint32 i = 0; i < NumParticles; ++i) {
+			Box += FVector3f(PosRot[i * 7], PosRot[i * 7 + 1], PosRot[i * 7 + 2]);
+		}
+		const FVector3f Scale = FVector3f(1023.f) / (Box.Max - Box.Min).ComponentMax(FVector3f(UE_SMALL_NUMBER));
+
+		TArray<uint64> Keys;
+		Keys.SetNumUninitialized(NumParticles);
+		ParallelFor(NumParticles, [&](int32 i)
+			{
+				const FVector3f T = ((FVector3f(PosRot[i * 7], PosRot[i * 7 + 1], PosRot[i * 7 + 2]) - Box.Min) * Scale).ComponentMin(FVector3f(1023.f));
+				const uint32 Code = Part1By2((uint32)T.X) | (Part1By2((uint32)T.Y) << 1) | (Part1By2((uint32)T.Z) << 2);
+				Keys[i] = ((uint64)Code << 32) | (uint32)i;
+			});
+		Algo::Sort(Keys);
+
+		const int32 FirstChunk = Out.Chunks.Num();
+		const uint32 FirstIndex = Out.Indices.Num();
+		const int32 NumChunks = FMath::DivideAndRoundUp<int32>(NumParticles, ChunkSize);
+		Out.Chunks.AddUninitialized(NumChunks);
+		Out.Indices.AddUninitialized(NumParticles);
+
+		ParallelFor(NumChunks, [&](int32 c)
+			{
+				const uint32 Begin = c * ChunkSize;
+				const uint32 End = FMath::Min<uint32>(Begin + ChunkSize, NumParticles);
+
+				FBox3f ChunkBox(ForceInit);
+				for (uint32 k = Begin; k < End; ++k) {
+					const uint32 i = (uint32)Keys[k];
+					FVector3f Center, Extent;
+					GetSplatBounds(Streams, i, Center, Extent);
+					ChunkBox += Center - Extent;
+					ChunkBox += Center + Extent;
+					Out.Indices[FirstIndex + k] = BaseIndex + i;
+				}
+
+				// a few ulps of slack, center and extent round the box inwards
+				const float Pad = 1e-6f * FMath::Max(ChunkBox.Min.GetAbs().GetMax(), ChunkBox.Max.GetAbs().GetMax());
+
+				FChunk& Chunk = Out.Chunks[FirstChunk + c];
+				Chunk.Center = ChunkBox.GetCenter();
+				Chunk.Extent = ChunkBox.GetExtent() + FVector3f(Pad);
+				Chunk.Begin = FirstIndex + Begin;
+				Chunk.Num = End - Begin;
+			});
+	}
+
+	void BuildChunks(const GSCompressed::FGpuSplats& Compact, FSplatChunks& Out)
+	{
+		const uint32 FirstIndex = Out.Indices.Num();
+
+		for (int32 c = 0; c < Compact.Chunks.Num(); ++c) {
+			const GSCompressed::FChunkHeader& Header = Compact.Chunks[c];
+			const uint32 Begin = c * ChunkSize;
+			const uint32 Num = FMath::Min<uint32>(ChunkSize, Compact.NumParticles - Begin);
+			const float Sigma = 3.f * FMath::Min(FMath::Exp(Header.LogScaleMax.GetMax()), MaxSigmaExtent);
+
+			FChunk Chunk;
+			Chunk.Center = (Header.PosMin + Header.PosMax) * 0.5f;
+			Chunk.Extent = (Header.PosMax - Header.PosMin) * 0.5f + FVector3f(Sigma);
+			Chunk.Begin = FirstIndex + Begin;
+			Chunk.Num = Num;
+			Out.Chunks.Add(Chunk);
+		}
+
+		Out.Indices.AddUninitialized(Compact.NumParticles);
+		for (uint32 i = 0; i < Compact.NumParticles; ++i) {
+			Out.Indices[FirstIndex + i] = i;
+		}
+	}
+
+
+	/*
+	*  FFrustum
+	*/
+	FFrustum::FFrustum(const FMatrix44f& LocalToClip)
+	{
+		// row vectors : clip component j is the dot product with column j
+		auto Column = [&LocalToClip](int32 j)
+			{
+				return FVector4f(LocalToClip.M[0][j], LocalToClip.M[1][j], LocalToClip.M[2][j], LocalToClip.M[3][j]);
+			};
+		const FVector4f X = Column(0);
+		const FVector4f Y = Column(1);
+		const FVector4f W = Column(3);
+
+		Planes[0] = W + X;
+		Planes[1] = W - X;
+		Planes[2] = W + Y;
+		Planes[3] = W - Y;
+		Planes[4] = W;
+	}
+
+	bool FFrustum::Intersects(const FVector3f& Center, const FVector3f& Extent) const
+	{
+		for (const FVector4f& Plane : Planes) {
+			// corner of the box the furthest along the plane normal
+			const float Distance = Center.X * Plane.X + Center.Y * Plane.Y + Center.Z * Plane.Z + Plane.W
+				+ Extent.X * FMath::Abs(Plane.X) + Extent.Y * FMath::Abs(Plane.Y) + Extent.Z * FMath::Abs(Plane.Z);
+			if (Distance < 0.f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint32 CullChunks(TConstArrayView<FChunk> Chunks, const FFrustum& Frustum, TArray<FVisibleChunk>& OutVisible)
+	{
+		OutVisible.Reset();
+		uint32 NumVisible = 0;
+		for (const FChunk& Chunk : Chunks) {
+			if (Frustum.Intersects(Chunk.Center, Chunk.Extent)) {
+				OutVisible.Add({ Chunk.Begin, Chunk.Num, NumVisible, 0 });
+				NumVisible += Chunk.Num;
+			}
+		}
+		return NumVisible;
+	}
+}	// namespace GSCull
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// Random splats and views : every splat box must be inside its chunk box, the indices must be a permutation,
+	// and no splat intersecting the frustum may be in a culled chunk. Check is called once per property and layout,
+	// returns the average fraction of the splats culled.
+	double CheckChunkCulling(uint32 NumSplats, TFunctionRef<void(const FString& What, bool bPassed)> Check)
+	{
+		FRandomStream Random(0x5EED);
+		constexpr int32 NumViews = 16;
+
+		double CulledFraction = 0.;
+		for (const bool bCovariance : { false, true }) {
+			const TCHAR* Layout = bCovariance ? TEXT("covariance") : TEXT("rotation + scale");
+
+			PLY::FGaussSplatVertex GSData;
+			PLY::AllocateStreams(GSData, NumSplats, 0);
+			for (uint32 i = 0; i < NumSplats; ++i) {
+				float* PosRot = &GSData.posrot[i * 7];
+				PosRot[0] = Random.FRandRange(-100.f, 100.f);
+				PosRot[1] = Random.FRandRange(-100.f, 100.f);
+				PosRot[2] = Random.FRandRange(-10.f, 10.f);
+				const FQuat4f Rot = FQuat4f(FVector3f(Random.GetUnitVector()), Random.FRandRange(0.f, UE_PI));
+				PosRot[3] = Rot.W; PosRot[4] = Rot.X; PosRot[5] = Rot.Y; PosRot[6] = Rot.Z;
+				GSData.scl[i] = FVector4f(Random.FRandRange(0.01f, 1.f), Random.FRandRange(0.01f, 1.f), Random.FRandRange(0.01f, 1.f), 1.f);
+			}
+			if (bCovariance) {
+				PLY::ConvertToCovariance(GSData);
+			}
+			const PLY::FSplatStreams Streams = PLY::GetStreams(GSData);
+
+			GSCull::FSplatChunks Chunks;
+			GSCull::BuildChunks(Streams, 0, Chunks);
+
+			bool bInside = true;
+			bool bUnique = true;
+			TBitArray<> Seen(false, NumSplats);
+			for (const GSCull::FChunk& Chunk : Chunks.Chunks) {
+				const FBox3f ChunkBox(Chunk.Center - Chunk.Extent, Chunk.Center + Chunk.Extent);
+				for (uint32 k = Chunk.Begin; k < Chunk.Begin + Chunk.Num; ++k) {
+					const uint32 i = Chunks.Indices[k];
+					if (i >= NumSplats) {
+						bUnique = false;
+						continue;
+					}
+					FVector3f Center, Extent;
+					GSCull::GetSplatBounds(Streams, i, Center, Extent);
+					bInside &= ChunkBox.IsInsideOrOn(Center - Extent) && ChunkBox.IsInsideOrOn(Center + Extent);
+					bUnique &= !Seen[i];
+					Seen[i] = true;
+				}
+			}
+			Check(FString::Printf(TEXT("%s : splat boxes inside their chunk box"), Layout), bInside);
+			Check(FString::Printf(TEXT("%s : chunk indices are a permutation"), Layout),
+				bUnique && Chunks.Indices.Num() == (int32)NumSplats && Seen.CountSetBits() == (int32)NumSplats);
+
+			bool bConservative = true;
+			for (int32 View = 0; View < NumViews; ++View) {
+				const FVector Eye(Random.FRandRange(-150.f, 150.f), Random.FRandRange(-150.f, 150.f), Random.FRandRange(-20.f, 20.f));
+				const FMatrix ViewMatrix = FLookAtMatrix(Eye, Eye + FVector(Random.GetUnitVector()), FVector::UpVector);
+				const FMatrix Projection = FReversedZPerspectiveMatrix(UE_HALF_PI * 0.5f, 16.f, 9.f, 1.f);
+				const GSCull::FFrustum Frustum(FMatrix44f(ViewMatrix * Projection));
+
+				TArray<GSCull::FVisibleChunk> Visible;
+				const uint32 NumVisible = GSCull::CullChunks(Chunks.Chunks, Frustum, Visible);
+
+				TBitArray<> Kept(false, NumSplats);
+				for (const GSCull::FVisibleChunk& Chunk : Visible) {
+					for (uint32 k = Chunk.Begin; k < Chunk.Begin + Chunk.Num; ++k) {
+						Kept[Chunks.Indices[k]] = true;
+					}
+				}
+				for (uint32 i = 0; i < NumSplats; ++i) {
+					FVector3f Center, Extent;
+					GSCull::GetSplatBounds(Streams, i, Center, Extent);
+					bConservative &= Kept[i] || !Frustum.Intersects(Center, Extent);
+				}
+				CulledFraction += 1. - (double)NumVisible / NumSplats;
+			}
+			Check(FString::Printf(TEXT("%s : no splat intersecting the frustum in a culled chunk"), Layout), bConservative);
+		}
+		return CulledFraction / (2 * NumViews);
+	}
+}
+
+
+/*
+*  GS.Cull.Test [NumSplats]
+*  CheckChunkCulling from the console, on more splats than the automation test.
+*/
+static FAutoConsoleCommand GSCullTestCommand(
+	TEXT("GS.Cull.Test"),
+	TEXT("Checks the chunk bounds and the chunk frustum culling against per-splat culling on random splats and views."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const uint32 NumSplats = Args.Num() > 0 ? (uint32)FMath::Max(1, FCString::Atoi(*Args[0])) : 1 << 18;
+
+			bool bPassed = true;
+			const double CulledFraction = CheckChunkCulling(NumSplats, [&bPassed](const FString& What, bool bCheck)
+				{
+					if (!bCheck) {
+						UE_LOG(LogGSLoader, Error, TEXT("GS.Cull.Test : %s FAILED"), *What);
+					}
+					bPassed &= bCheck;
+				});
+
+			UE_LOG(LogGSLoader, Display, TEXT("GS.Cull.Test %s, %.1f %% of the splats culled on average"), bPassed ? TEXT("passed") : TEXT("FAILED"), 100. * CulledFraction);
+		}));
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGSCullChunksTest, "GSRuntime.Cull.Chunks",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::EngineFilter)
+
+bool FGSCullChunksTest::RunTest(const FString& Parameters)
+{
+	CheckChunkCulling(1 << 15, [this](const FString& What, bool bPassed) { TestTrue(What, bPassed); });
+	return true;
+}
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
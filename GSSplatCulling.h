@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GSPlyLoader.h"
+
+namespace GSCompressed { struct FGpuSplats; }
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Chunk-level frustum culling
+*
+*  Splats are grouped in chunks of ChunkSize along a Morton curve, each with a conservative box : the 3 sigma
+*  extent of every splat is inside it. Before the sort keys are generated, whole chunks are tested against the
+*  frustum on the CPU and only the surviving ones are handed to GSSort::FDepthKeyGen, which compacts their splats
+*  into the key and index buffers.
+*/
+namespace GSCull
+{
+	constexpr int32 ChunkSize = 256;
+
+	struct FChunk
+	{
+		FVector3f Center;
+		FVector3f Extent;
+		uint32 Begin;		// first entry of the chunk in FSplatChunks::Indices
+		uint32 Num;
+	};
+
+	struct FSplatChunks
+	{
+		TArray<FChunk> Chunks;
+		TArray<uint32> Indices;		// splat indices, chunk by chunk
+
+		void Reset();
+		void Append(const FSplatChunks& Other);
+	};
+
+	// 3 sigma half extent of a splat of activated scale Scale under any rotation, clamped
+	float GetRotatedSplatExtent(const FVector3f& Scale);
+
+	// 3 sigma box of splat i, from rotation and scale or from the covariance diagonal
+	void GetSplatBounds(const PLY::FSplatStreams& Streams, uint32 i, FVector3f& OutCenter, FVector3f& OutExtent);
+
+	// Chunks of Streams appended to Out, splat i of Streams is BaseIndex + i in Out.Indices.
+	// Multithreaded, meant for the loading thread.
+	void BuildChunks(const PLY::FSplatStreams& Streams, uint32 BaseIndex, FSplatChunks& Out);
+
+	// Compact splats are Morton ordered chunks of ChunkSize already, the boxes come from the chunk ranges.
+	void BuildChunks(const GSCompressed::FGpuSplats& Compact, FSplatChunks& Out);
+
+	/*
+	*  Side planes of a local-to-clip matrix, plus w > 0. Near and far are left out : reversed and infinite
+	*  far depth make them of little use, and the key generation sends what is behind the camera last anyway.
+	*/
+	struct FFrustum
+	{
+		FVector4f Planes[5];	// inside where dot(xyz, p) + w >= 0
+
+		explicit FFrustum(const FMatrix44f& LocalToClip);
+		bool Intersects(const FVector3f& Center, const FVector3f& Extent) const;
+	};
+
+	// What GSSort::FDepthKeyGen gets per visible chunk : its first Indices entry, its size, and where its keys go
+	struct FVisibleChunk
+	{
+		uint32 Begin;
+		uint32 Num;
+		uint32 OutOffset;
+		uint32 Pad;
+	};
+
+	// Visible chunks in order, returns the number of splats they hold
+	uint32 CullChunks(TConstArrayView<FChunk> Chunks, const FFrustum& Frustum, TArray<FVisibleChunk>& OutVisible);
+}	// namespace GSCull
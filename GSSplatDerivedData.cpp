@@ -0,0 +1,194 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSplatDerivedData.h"
+#include "Async/MappedFileHandle.h"
+#include "Hash/xxhash.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/ScopeLock.h"
+#include "Stats/Stats.h"
+#include <atomic>
+
+#if WITH_EDITOR
+#include "DerivedDataCacheInterface.h"
+#endif
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Splat DDC hits"), STAT_GSDerivedDataHits, STATGROUP_GSLoader);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Splat DDC misses"), STAT_GSDerivedDataMisses, STATGROUP_GSLoader);
+
+static TAutoConsoleVariable<int32> CVarDerivedDataCache(
+	TEXT("r.GS.DerivedDataCache"),
+	1,
+	TEXT("0: always decode splat sources\n")
+	TEXT("1: keep decoded splat streams in the derived-data cache (editor, default)"),
+	ECVF_Default);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// bump whenever the decoded streams change for the same source
+	const TCHAR* DerivedDataVersion = TEXT("6F0C2D1A8E4B4F6B9A1D3C5E7F901234");
+
+	std::atomic<uint32> NumHits{ 0 };
+	std::atomic<uint32> NumMisses{ 0 };
+
+	struct FSourceHash
+	{
+		int64 Size = 0;
+		FDateTime TimeStamp;
+		uint64 Hash = 0;
+	};
+
+	FCriticalSection SourceHashesLock;
+	TMap<FString, FSourceHash> SourceHashes;
+
+	bool HashSourceFile(const FString& Filename, uint64& OutHash)
+	{
+		const int64 Size = IFileManager::Get().FileSize(*Filename);
+		const FDateTime TimeStamp = IFileManager::Get().GetTimeStamp(*Filename);
+		if (Size <= 0) {
+			return false;
+		}
+
+		{
+			FScopeLock Lock(&SourceHashesLock);
+			const FSourceHash* Known = SourceHashes.Find(Filename);
+			if (Known && Known->Size == Size && Known->TimeStamp == TimeStamp) {
+				OutHash = Known->Hash;
+				return true;
+			}
+		}
+
+		// region before handle
+		TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+		if (!MappedFile) {
+			return false;
+		}
+		TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (!MappedRegion) {
+			return false;
+		}
+		OutHash = FXxHash64::HashBuffer(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize()).Hash;
+
+		FScopeLock Lock(&SourceHashesLock);
+		SourceHashes.Add(Filename, { Size, TimeStamp, OutHash });
+		return true;
+	}
+
+#if WITH_EDITOR
+	FString GetStreamKey(const FString& Suffix, int32 Stream)
+	{
+		return FDerivedDataCacheInterface::BuildCacheKey(TEXT("GSSPLAT"), DerivedDataVersion, *FString::Printf(TEXT("%s_S%d"), *Suffix, Stream));
+	}
+
+	bool GetCachedStreams(const FString& Suffix, const FString& Filename, int32 ShDegree, PLY::FGaussSplatVertex& GSData)
+	{
+		TArray<uint8> Data;
+		if (!GetDerivedDataCacheRef().GetSynchronous(*GetStreamKey(Suffix, PLY::SplatStream_PosRot), Data, Filename)) {
+			return false;
+		}
+
+		const uint32 PosRotStride = PLY::GetStreamStride(PLY::SplatStream_PosRot);
+		if (Data.Num() % PosRotStride != 0) {
+			return false;
+		}
+
+		PLY::AllocateStreams(GSData, Data.Num() / PosRotStride, ShDegree);
+		PLY::FSplatStreams Streams = PLY::GetStreams(GSData);
+
+		for (int32 s = 0; s < PLY::SplatStream_Count; ++s) {
+			if (!Streams.Streams[s]) {
+				continue;
+			}
+			if (s != PLY::SplatStream_PosRot && !GetDerivedDataCacheRef().GetSynchronous(*GetStreamKey(Suffix, s), Data, Filename)) {
+				return false;
+			}
+			if ((uint32)Data.Num() != Streams.Streams[s]->GetResourceDataSize()) {
+				return false;
+			}
+			FMemory::Memcpy(const_cast<void*>(Streams.Streams[s]->GetResourceData()), Data.GetData(), Data.Num());
+		}
+		return true;
+	}
+
+	void PutCachedStreams(const FString& Suffix, const FString& Filename, PLY::FGaussSplatVertex& GSData)
+	{
+		PLY::FSplatStreams Streams = PLY::GetStreams(GSData);
+
+		// position/rotation last, it marks the entry complete for GetCachedStreams
+		for (int32 s = PLY::SplatStream_Count - 1; s >= 0; --s) {
+			if (!Streams.Streams[s]) {
+				continue;
+			}
+			const uint8* Data = static_cast<const uint8*>(Streams.Streams[s]->GetResourceData());
+			GetDerivedDataCacheRef().Put(*GetStreamKey(Suffix, s), TArrayView64<const uint8>(Data, Streams.Streams[s]->GetResourceDataSize()), Filename);
+		}
+	}
+#endif
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSDerivedData
+{
+	FString GetCacheKeySuffix(const FString& Filename, int32 ShDegree)
+	{
+		uint64 Hash = 0;
+		if (!HashSourceFile(Filename, Hash)) {
+			return FString();
+		}
+		return FString::Printf(TEXT("%016llX_SH%d"), Hash, ShDegree);
+	}
+
+	bool LoadPlyFileCached(const FString& Filename, PLY::FGaussSplatVertex& GSData, int32 ShDegree)
+	{
+#if WITH_EDITOR
+		const FString Suffix = CVarDerivedDataCache.GetValueOnAnyThread() != 0 ? GetCacheKeySuffix(Filename, ShDegree) : FString();
+		if (Suffix.IsEmpty()) {
+			return PLY::LoadPlyFile(Filename, GSData, ShDegree);
+		}
+
+		if (GetCachedStreams(Suffix, Filename, ShDegree, GSData)) {
+			++NumHits;
+			INC_DWORD_STAT(STAT_GSDerivedDataHits);
+			UE_LOG(LogGSLoader, Log, TEXT("\"%s\" : derived data cache hit (%u particles)"), *Filename, GSData.NumParticles);
+			return true;
+		}
+
+		++NumMisses;
+		INC_DWORD_STAT(STAT_GSDerivedDataMisses);
+		UE_LOG(LogGSLoader, Log, TEXT("\"%s\" : derived data cache miss"), *Filename);
+
+		if (!PLY::LoadPlyFile(Filename, GSData, ShDegree)) {
+			return false;
+		}
+		PutCachedStreams(Suffix, Filename, GSData);
+		return true;
+#else
+		return PLY::LoadPlyFile(Filename, GSData, ShDegree);
+#endif
+	}
+
+	FStats GetStats()
+	{
+		FStats Stats;
+		Stats.Hits = NumHits;
+		Stats.Misses = NumMisses;
+		return Stats;
+	}
+}	// namespace GSDerivedData
+
+
+static FAutoConsoleCommand GSDerivedDataStatsCommand(
+	TEXT("GS.DerivedData.Stats"),
+	TEXT("Logs splat derived-data cache hits and misses since startup."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const GSDerivedData::FStats Stats = GSDerivedData::GetStats();
+			const uint32 Total = Stats.Hits + Stats.Misses;
+			UE_LOG(LogGSLoader, Display, TEXT("splat derived data cache : %u hits, %u misses (%.1f%% hit rate)"),
+				Stats.Hits, Stats.Misses, Total ? 100. * Stats.Hits / Total : 0.);
+		}));
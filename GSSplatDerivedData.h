@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GSPlyLoader.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Decoded splat streams in the derived-data cache (editor only)
+*
+*  Keyed by an xxHash64 of the source file and the load settings (SH degree, DerivedDataVersion), one cache entry
+*  per used PLY::ESplatStream so no single value goes over the 2 GB TArray limit. A hit is a plain copy into the
+*  upload streams, a miss decodes the source and stores the result for the next open.
+*/
+namespace GSDerivedData
+{
+	struct FStats
+	{
+		uint32 Hits = 0;
+		uint32 Misses = 0;
+	};
+
+	// PLY::LoadPlyFile through the derived-data cache. Falls back to a plain load when the cache is disabled
+	// (r.GS.DerivedDataCache 0) or unavailable (no editor).
+	bool LoadPlyFileCached(const FString& Filename, PLY::FGaussSplatVertex& GSData, int32 ShDegree = PLY::MaxShDegree);
+
+	// "<hash>_<settings>", empty when the source cannot be read. Source hashes are memoized per path, size and time stamp.
+	FString GetCacheKeySuffix(const FString& Filename, int32 ShDegree);
+
+	FStats GetStats();
+}	// namespace GSDerivedData
@@ -0,0 +1,571 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSplatKernels.h"
+#include "Math/VectorRegister.h"
+#include "Math/RandomStream.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "GSPlyLoader.h"
+
+#if defined(PLATFORM_ALWAYS_HAS_AVX_2) && PLATFORM_ALWAYS_HAS_AVX_2
+#define GS_KERNELS_AVX2 1
+#include <immintrin.h>
+#else
+#define GS_KERNELS_AVX2 0
+#endif
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	// Cephes expf : exp(x) = 2^n * exp(r), |r| <= ln2 / 2
+	constexpr float ExpClamp = 88.3762626647949f;
+	constexpr float Log2e = 1.44269504088896341f;
+	constexpr float Ln2Hi = 0.693359375f;
+	constexpr float Ln2Lo = -2.12194440e-4f;
+	constexpr float ExpP0 = 1.9875691500e-4f;
+	constexpr float ExpP1 = 1.3981999507e-3f;
+	constexpr float ExpP2 = 8.3334519073e-3f;
+	constexpr float ExpP3 = 4.1665795894e-2f;
+	constexpr float ExpP4 = 1.6666665459e-1f;
+	constexpr float ExpP5 = 5.0000001201e-1f;
+
+	namespace Vector4
+	{
+		FORCEINLINE VectorRegister4Float Exp(VectorRegister4Float X)
+		{
+			const VectorRegister4Float One = VectorOneFloat();
+
+			X = VectorMin(VectorMax(X, VectorSetFloat1(-ExpClamp)), VectorSetFloat1(ExpClamp));
+			const VectorRegister4Float Fx = VectorFloor(VectorMultiplyAdd(X, VectorSetFloat1(Log2e), VectorSetFloat1(0.5f)));
+
+			VectorRegister4Float R = VectorSubtract(X, VectorMultiply(Fx, VectorSetFloat1(Ln2Hi)));
+			R = VectorSubtract(R, VectorMultiply(Fx, VectorSetFloat1(Ln2Lo)));
+			const VectorRegister4Float R2 = VectorMultiply(R, R);
+
+			VectorRegister4Float P = VectorSetFloat1(ExpP0);
+			P = VectorMultiplyAdd(P, R, VectorSetFloat1(ExpP1));
+			P = VectorMultiplyAdd(P, R, VectorSetFloat1(ExpP2));
+			P = VectorMultiplyAdd(P, R, VectorSetFloat1(ExpP3));
+			P = VectorMultiplyAdd(P, R, VectorSetFloat1(ExpP4));
+			P = VectorMultiplyAdd(P, R, VectorSetFloat1(ExpP5));
+			P = VectorAdd(VectorMultiplyAdd(P, R2, R), One);
+
+			VectorRegister4Int N = VectorFloatToInt(Fx);
+			N = VectorShiftLeftImm(VectorIntAdd(N, VectorIntSet1(127)), 23);
+			return VectorMultiply(P, VectorCastIntToFloat(N));
+		}
+
+		FORCEINLINE VectorRegister4Float Sigmoid(VectorRegister4Float X)
+		{
+			const VectorRegister4Float One = VectorOneFloat();
+			return VectorDivide(One, VectorAdd(One, Exp(VectorNegate(X))));
+		}
+	}
+
+#if GS_KERNELS_AVX2
+	namespace Avx2
+	{
+		FORCEINLINE __m256 Exp(__m256 X)
+		{
+			const __m256 One = _mm256_set1_ps(1.f);
+
+			X = _mm256_min_ps(_mm256_max_ps(X, _mm256_set1_ps(-ExpClamp)), _mm256_set1_ps(ExpClamp));
+			const __m256 Fx = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(X, _mm256_set1_ps(Log2e)), _mm256_set1_ps(0.5f)));
+
+			__m256 R = _mm256_sub_ps(X, _mm256_mul_ps(Fx, _mm256_set1_ps(Ln2Hi)));
+			R = _mm256_sub_ps(R, _mm256_mul_ps(Fx, _mm256_set1_ps(Ln2Lo)));
+			const __m256 R2 = _mm256_mul_ps(R, R);
+
+			__m256 P = _mm256_set1_ps(ExpP0);
+			P = _mm256_add_ps(_mm256_mul_ps(P, R), _mm256_set1_ps(ExpP1));
+			P = _mm256_add_ps(_mm256_mul_ps(P, R), _mm256_set1_ps(ExpP2));
+			P = _mm256_add_ps(_mm256_mul_ps(P, R), _mm256_set1_ps(ExpP3));
+			P = _mm256_add_ps(_mm256_mul_ps(P, R), _mm256_set1_ps(ExpP4));
+			P = _mm256_add_ps(_mm256_mul_ps(P, R), _mm256_set1_ps(ExpP5));
+			P = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(P, R2), R), One);
+
+			__m256i N = _mm256_cvttps_epi32(Fx);
+			N = _mm256_slli_epi32(_mm256_add_epi32(N, _mm256_set1_epi32(127)), 23);
+			return _mm256_mul_ps(P, _mm256_castsi256_ps(N));
+		}
+
+		FORCEINLINE __m256 Sigmoid(__m256 X)
+		{
+			const __m256 One = _mm256_set1_ps(1.f);
+			return _mm256_div_ps(One, _mm256_add_ps(One, Exp(_mm256_sub_ps(_mm256_setzero_ps(), X))));
+		}
+	}
+#endif
+
+	/*
+	*  Sigma = R S S^T R^T, written once over the arithmetic of each path. Only multiplies, adds and subtracts
+	*  in a fixed order, no fused multiply-add, so every path rounds exactly like the scalar one.
+	*/
+	struct FScalarOps
+	{
+		using Type = float;
+		static FORCEINLINE float Set1(float A) { return A; }
+		static FORCEINLINE float Mul(float A, float B) { return A * B; }
+		static FORCEINLINE float Add(float A, float B) { return A + B; }
+		static FORCEINLINE float Sub(float A, float B) { return A - B; }
+	};
+
+	struct FVector4Ops
+	{
+		using Type = VectorRegister4Float;
+		static FORCEINLINE Type Set1(float A) { return VectorSetFloat1(A); }
+		static FORCEINLINE Type Mul(Type A, Type B) { return VectorMultiply(A, B); }
+		static FORCEINLINE Type Add(Type A, Type B) { return VectorAdd(A, B); }
+		static FORCEINLINE Type Sub(Type A, Type B) { return VectorSubtract(A, B); }
+	};
+
+#if GS_KERNELS_AVX2
+	struct FAvx2Ops
+	{
+		using Type = __m256;
+		static FORCEINLINE Type Set1(float A) { return _mm256_set1_ps(A); }
+		static FORCEINLINE Type Mul(Type A, Type B) { return _mm256_mul_ps(A, B); }
+		static FORCEINLINE Type Add(Type A, Type B) { return _mm256_add_ps(A, B); }
+		static FORCEINLINE Type Sub(Type A, Type B) { return _mm256_sub_ps(A, B); }
+	};
+#endif
+
+	// Q = (w, x, y, z) unit quaternion, S = activated scale. Out = xx, xy, xz, yy, yz, zz.
+	template<typename FOps, typename T = typename FOps::Type>
+	FORCEINLINE void Covariance(const T Q[4], const T S[3], T Out[6])
+	{
+		const T One = FOps::Set1(1.f);
+		const T Two = FOps::Set1(2.f);
+		const T W = Q[0], X = Q[1], Y = Q[2], Z = Q[3];
+
+		const T XX = FOps::Mul(X, X), YY = FOps::Mul(Y, Y), ZZ = FOps::Mul(Z, Z);
+		const T XY = FOps::Mul(X, Y), XZ = FOps::Mul(X, Z), YZ = FOps::Mul(Y, Z);
+		const T WX = FOps::Mul(W, X), WY = FOps::Mul(W, Y), WZ = FOps::Mul(W, Z);
+
+		// rotation matrix of Q, column j scaled by S[j]
+		const T M[3][3] = {
+			{ FOps::Mul(FOps::Sub(One, FOps::Mul(Two, FOps::Add(YY, ZZ))), S[0]), FOps::Mul(FOps::Mul(Two, FOps::Sub(XY, WZ)), S[1]), FOps::Mul(FOps::Mul(Two, FOps::Add(XZ, WY)), S[2]) },
+			{ FOps::Mul(FOps::Mul(Two, FOps::Add(XY, WZ)), S[0]), FOps::Mul(FOps::Sub(One, FOps::Mul(Two, FOps::Add(XX, ZZ))), S[1]), FOps::Mul(FOps::Mul(Two, FOps::Sub(YZ, WX)), S[2]) },
+			{ FOps::Mul(FOps::Mul(Two, FOps::Sub(XZ, WY)), S[0]), FOps::Mul(FOps::Mul(Two, FOps::Add(YZ, WX)), S[1]), FOps::Mul(FOps::Sub(One, FOps::Mul(Two, FOps::Add(XX, YY))), S[2]) },
+		};
+
+		auto Dot = [&M](int32 I, int32 J)
+			{
+				return FOps::Add(FOps::Add(FOps::Mul(M[I][0], M[J][0]), FOps::Mul(M[I][1], M[J][1])), FOps::Mul(M[I][2], M[J][2]));
+			};
+		Out[0] = Dot(0, 0);
+		Out[1] = Dot(0, 1);
+		Out[2] = Dot(0, 2);
+		Out[3] = Dot(1, 1);
+		Out[4] = Dot(1, 2);
+		Out[5] = Dot(2, 2);
+	}
+
+	GSKernels::EPath ResolvePath(GSKernels::EPath Path)
+	{
+		if (Path == GSKernels::EPath::Best) {
+			return GS_KERNELS_AVX2 ? GSKernels::EPath::Avx2 : GSKernels::EPath::Vector4;
+		}
+		return GSKernels::IsPathSupported(Path) ? Path : GSKernels::EPath::Vector4;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSKernels
+{
+	void ActivateScale(const float* In, float* Out, int32 Count, EPath Path)
+	{
+		Path = ResolvePath(Path);
+		int32 i = 0;
+#if GS_KERNELS_AVX2
+		if (Path == EPath::Avx2) {
+			for (; i + 8 <= Count; i += 8) {
+				_mm256_storeu_ps(Out + i, Avx2::Exp(_mm256_loadu_ps(In + i)));
+			}
+		}
+#endif
+		if (Path != EPath::Scalar) {
+			for (; i + 4 <= Count; i += 4) {
+				VectorStore(Vector4::Exp(VectorLoad(In + i)), Out + i);
+			}
+		}
+		for (; i < Count; ++i) {
+			Out[i] = FMath::Exp(In[i]);
+		}
+	}
+
+	void ActivateOpacity(const float* In, float* Out, int32 Count, EPath Path)
+	{
+		Path = ResolvePath(Path);
+		int32 i = 0;
+#if GS_KERNELS_AVX2
+		if (Path == EPath::Avx2) {
+			for (; i + 8 <= Count; i += 8) {
+				_mm256_storeu_ps(Out + i, Avx2::Sigmoid(_mm256_loadu_ps(In + i)));
+			}
+		}
+#endif
+		if (Path != EPath::Scalar) {
+			for (; i + 4 <= Count; i += 4) {
+				VectorStore(Vector4::Sigmoid(VectorLoad(In + i)), Out + i);
+			}
+		}
+		for (; i < Count; ++i) {
+			Out[i] = 1.f / (1.f + FMath::Exp(-In[i]));
+		}
+	}
+
+	void NormalizeQuaternions(float* X, float* Y, float* Z, float* W, int32 Count, EPath Path)
+	{
+		// no fused multiply-add here, the sum has to round exactly like FVector4f::Size()
+		Path = ResolvePath(Path);
+		int32 i = 0;
+#if GS_KERNELS_AVX2
+		if (Path == EPath::Avx2) {
+			for (; i + 8 <= Count; i += 8) {
+				const __m256 Qx = _mm256_loadu_ps(X + i);
+				const __m256 Qy = _mm256_loadu_ps(Y + i);
+				const __m256 Qz = _mm256_loadu_ps(Z + i);
+				const __m256 Qw = _mm256_loadu_ps(W + i);
+				__m256 Len = _mm256_mul_ps(Qx, Qx);
+				Len = _mm256_add_ps(Len, _mm256_mul_ps(Qy, Qy));
+				Len = _mm256_add_ps(Len, _mm256_mul_ps(Qz, Qz));
+				Len = _mm256_add_ps(Len, _mm256_mul_ps(Qw, Qw));
+				Len = _mm256_sqrt_ps(Len);
+				_mm256_storeu_ps(X + i, _mm256_div_ps(Qx, Len));
+				_mm256_storeu_ps(Y + i, _mm256_div_ps(Qy, Len));
+				_mm256_storeu_ps(Z + i, _mm256_div_ps(Qz, Len));
+				_mm256_storeu_ps(W + i, _mm256_div_ps(Qw, Len));
+			}
+		}
+#endif
+		if (Path != EPath::Scalar) {
+			for (; i + 4 <= Count; i += 4) {
+				const VectorRegister4Float Qx = VectorLoad(X + i);
+				const VectorRegister4Float Qy = VectorLoad(Y + i);
+				const VectorRegister4Float Qz = VectorLoad(Z + i);
+				const VectorRegister4Float Qw = VectorLoad(W + i);
+				VectorRegister4Float Len = VectorMultiply(Qx, Qx);
+				Len = VectorAdd(Len, VectorMultiply(Qy, Qy));
+				Len = VectorAdd(Len, VectorMultiply(Qz, Qz));
+				Len = VectorAdd(Len, VectorMultiply(Qw, Qw));
+				Len = VectorSqrt(Len);
+				VectorStore(VectorDivide(Qx, Len), X + i);
+				VectorStore(VectorDivide(Qy, Len), Y + i);
+				VectorStore(VectorDivide(Qz, Len), Z + i);
+				VectorStore(VectorDivide(Qw, Len), W + i);
+			}
+		}
+		for (; i < Count; ++i) {
+			FVector4f rot(X[i], Y[i], Z[i], W[i]);
+			rot /= rot.Size();
+			X[i] = rot.X; Y[i] = rot.Y; Z[i] = rot.Z; W[i] = rot.W;
+		}
+	}
+
+	void ConvertPositions(float* X, float* Y, float* Z, int32 Count, EPath Path)
+	{
+		Path = ResolvePath(Path);
+		int32 i = 0;
+#if GS_KERNELS_AVX2
+		if (Path == EPath::Avx2) {
+			const __m256 Scale = _mm256_set1_ps(100.f);
+			const __m256 NegScale = _mm256_set1_ps(-100.f);
+			for (; i + 8 <= Count; i += 8) {
+				const __m256 Py = _mm256_loadu_ps(Y + i);
+				const __m256 Pz = _mm256_loadu_ps(Z + i);
+				_mm256_storeu_ps(X + i, _mm256_mul_ps(_mm256_loadu_ps(X + i), Scale));
+				_mm256_storeu_ps(Y + i, _mm256_mul_ps(Pz, NegScale));
+				_mm256_storeu_ps(Z + i, _mm256_mul_ps(Py, NegScale));
+			}
+		}
+#endif
+		if (Path != EPath::Scalar) {
+			const VectorRegister4Float Scale = VectorSetFloat1(100.f);
+			const VectorRegister4Float NegScale = VectorSetFloat1(-100.f);
+			for (; i + 4 <= Count; i += 4) {
+				const VectorRegister4Float Py = VectorLoad(Y + i);
+				const VectorRegister4Float Pz = VectorLoad(Z + i);
+				VectorStore(VectorMultiply(VectorLoad(X + i), Scale), X + i);
+				VectorStore(VectorMultiply(Pz, NegScale), Y + i);
+				VectorStore(VectorMultiply(Py, NegScale), Z + i);
+			}
+		}
+		for (; i < Count; ++i) {
+			const float Py = Y[i];
+			X[i] = X[i] * 100.f;	// m -> cm
+			Y[i] = -Z[i] * 100.f;
+			Z[i] = -Py * 100.f;
+		}
+	}
+
+	void ComputeCovariance(const float* const Rot[4], const float* const Scale[3], float* const Cov[6], int32 Count, EPath Path)
+	{
+		// every input of a lane is loaded before its outputs are stored, so Cov may alias Rot and Scale
+		Path = ResolvePath(Path);
+		int32 i = 0;
+#if GS_KERNELS_AVX2
+		if (Path == EPath::Avx2) {
+			for (; i + 8 <= Count; i += 8) {
+				const __m256 Q[4] = { _mm256_loadu_ps(Rot[0] + i), _mm256_loadu_ps(Rot[1] + i), _mm256_loadu_ps(Rot[2] + i), _mm256_loadu_ps(Rot[3] + i) };
+				const __m256 S[3] = { _mm256_loadu_ps(Scale[0] + i), _mm256_loadu_ps(Scale[1] + i), _mm256_loadu_ps(Scale[2] + i) };
+				__m256 C[6];
+				Covariance<FAvx2Ops>(Q, S, C);
+				for (int32 k = 0; k < 6; ++k) {
+					_mm256_storeu_ps(Cov[k] + i, C[k]);
+				}
+			}
+		}
+#endif
+		if (Path != EPath::Scalar) {
+			for (; i + 4 <= Count; i += 4) {
+				const VectorRegister4Float Q[4] = { VectorLoad(Rot[0] + i), VectorLoad(Rot[1] + i), VectorLoad(Rot[2] + i), VectorLoad(Rot[3] + i) };
+				const VectorRegister4Float S[3] = { VectorLoad(Scale[0] + i), VectorLoad(Scale[1] + i), VectorLoad(Scale[2] + i) };
+				VectorRegister4Float C[6];
+				Covariance<FVector4Ops>(Q, S, C);
+				for (int32 k = 0; k < 6; ++k) {
+					VectorStore(C[k], Cov[k] + i);
+				}
+			}
+		}
+		for (; i < Count; ++i) {
+			const float Q[4] = { Rot[0][i], Rot[1][i], Rot[2][i], Rot[3][i] };
+			const float S[3] = { Scale[0][i], Scale[1][i], Scale[2][i] };
+			float C[6];
+			Covariance<FScalarOps>(Q, S, C);
+			for (int32 k = 0; k < 6; ++k) {
+				Cov[k][i] = C[k];
+			}
+		}
+	}
+
+	void ComputeCovarianceReference(const float Rot[4], const float Scale[3], float OutCov[6])
+	{
+		// ToMatrix is row-vector, M = R^T and Sigma = M^T S^2 M
+		const FMatrix44f M = FQuat4f(Rot[1], Rot[2], Rot[3], Rot[0]).ToMatrix();
+		const FMatrix44f S2 = FScaleMatrix44f(FVector3f(Scale[0] * Scale[0], Scale[1] * Scale[1], Scale[2] * Scale[2]));
+		const FMatrix44f Sigma = M.GetTransposed() * S2 * M;
+		const int32 Upper[6][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 1 }, { 1, 2 }, { 2, 2 } };
+		for (int32 k = 0; k < 6; ++k) {
+			OutCov[k] = Sigma.M[Upper[k][0]][Upper[k][1]];
+		}
+	}
+
+	bool IsPathSupported(EPath Path)
+	{
+		return Path != EPath::Avx2 || GS_KERNELS_AVX2;
+	}
+
+	const TCHAR* GetPathName(EPath Path)
+	{
+		switch (Path) {
+		case EPath::Scalar:		return TEXT("scalar");
+		case EPath::Vector4:	return TEXT("vector4");
+		case EPath::Avx2:		return TEXT("avx2");
+		default:				return TEXT("best");
+		}
+	}
+
+	int32 UlpDistance(float A, float B)
+	{
+		auto ToOrdered = [](float F)
+			{
+				int32 I;
+				FMemory::Memcpy(&I, &F, sizeof(float));
+				return I < 0 ? (int64)MIN_int32 - I : (int64)I;
+			};
+		return (int32)FMath::Min<int64>(FMath::Abs(ToOrdered(A) - ToOrdered(B)), MAX_int32);
+	}
+}	// namespace GSKernels
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	struct FKernelResult
+	{
+		const TCHAR* Name;
+		GSKernels::EPath Path;
+		double Error;		// max ulp, relative to the largest variance for the covariance
+		double Bound;
+		double SplatsPerSecond;
+
+		bool IsWithinBound() const { return Error <= Bound; }
+	};
+
+	// Every kernel on every supported path against the scalar reference, and the covariance kernel against the
+	// quaternion path, NumIterations timed runs each. Inputs cover the documented [-80, 80], endpoints included.
+	void RunKernelChecks(int32 NumSplats, int32 NumIterations, TFunctionRef<void(const FKernelResult& Result)> OnResult)
+	{
+		using namespace GSKernels;
+
+		constexpr float InputRange = 80.f;
+		constexpr int32 NumEndpoints = 5;
+		const float Endpoints[NumEndpoints] = { -InputRange, InputRange, 0.f, -1.f, 1.f };
+		NumSplats = FMath::Max(NumSplats, NumEndpoints);
+
+		FRandomStream Random(0x3D65);
+		TArray<float> Source[4];
+		for (int32 s = 0; s < 4; ++s) {
+			TArray<float>& Array = Source[s];
+			Array.SetNumUninitialized(NumSplats);
+			for (int32 i = 0; i < NumSplats; ++i) {
+				// the endpoints on every stream, rotated so that quaternions are not all along an axis
+				Array[i] = i < NumEndpoints ? Endpoints[(i + s) % NumEndpoints] : Random.FRandRange(-InputRange, InputRange);
+			}
+		}
+
+		struct FKernel
+		{
+			const TCHAR* Name;
+			int32 MaxUlp;
+			int32 NumStreams;
+			TFunction<void(TArray<float>*, EPath)> Run;
+		};
+		const FKernel Kernels[] = {
+			{ TEXT("scale exp"), ExpMaxUlp, 1, [](TArray<float>* S, EPath P) { ActivateScale(S[0].GetData(), S[0].GetData(), S[0].Num(), P); } },
+			{ TEXT("opacity sigmoid"), SigmoidMaxUlp, 1, [](TArray<float>* S, EPath P) { ActivateOpacity(S[0].GetData(), S[0].GetData(), S[0].Num(), P); } },
+			{ TEXT("quat normalize"), NormalizeMaxUlp, 4, [](TArray<float>* S, EPath P) { NormalizeQuaternions(S[0].GetData(), S[1].GetData(), S[2].GetData(), S[3].GetData(), S[0].Num(), P); } },
+			{ TEXT("position convert"), PositionMaxUlp, 3, [](TArray<float>* S, EPath P) { ConvertPositions(S[0].GetData(), S[1].GetData(), S[2].GetData(), S[0].Num(), P); } },
+		};
+
+		for (const FKernel& Kernel : Kernels) {
+			TArray<float> Reference[4];
+			for (int32 s = 0; s < 4; ++s) {
+				Reference[s] = Source[s];
+			}
+			Kernel.Run(Reference, EPath::Scalar);
+
+			for (EPath Path : { EPath::Scalar, EPath::Vector4, EPath::Avx2 }) {
+				if (!IsPathSupported(Path)) {
+					continue;
+				}
+
+				TArray<float> Work[4];
+				double Seconds = 0.;
+				for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration) {
+					for (int32 s = 0; s < 4; ++s) {
+						Work[s] = Source[s];
+					}
+					const double Start = FPlatformTime::Seconds();
+					Kernel.Run(Work, Path);
+					Seconds += FPlatformTime::Seconds() - Start;
+				}
+
+				int32 MaxUlp = 0;
+				for (int32 s = 0; s < Kernel.NumStreams; ++s) {
+					for (int32 i = 0; i < NumSplats; ++i) {
+						MaxUlp = FMath::Max(MaxUlp, UlpDistance(Work[s][i], Reference[s][i]));
+					}
+				}
+
+				OnResult({ Kernel.Name, Path, (double)MaxUlp, (double)Kernel.MaxUlp, (double)NumSplats * NumIterations / FMath::Max(Seconds, 1e-9) });
+			}
+		}
+
+		// covariance : every path against the quaternion path on unit quaternions and activated scales
+		{
+			TArray<float> Rot[4], Scale[3], Reference[6];
+			for (TArray<float>& Array : Rot) {
+				Array.SetNumUninitialized(NumSplats);
+			}
+			for (TArray<float>& Array : Scale) {
+				Array.SetNumUninitialized(NumSplats);
+			}
+			for (TArray<float>& Array : Reference) {
+				Array.SetNumUninitialized(NumSplats);
+			}
+
+			for (int32 i = 0; i < NumSplats; ++i) {
+				FVector4f q(Source[0][i], Source[1][i], Source[2][i], Source[3][i]);
+				q /= q.Size();
+				float Q[4], S[3], C[6];
+				for (int32 k = 0; k < 4; ++k) {
+					Rot[k][i] = Q[k] = q[k];
+				}
+				for (int32 k = 0; k < 3; ++k) {
+					Scale[k][i] = S[k] = FMath::Exp(Random.FRandRange(-8.f, 1.f));
+				}
+
+				ComputeCovarianceReference(Q, S, C);
+				for (int32 k = 0; k < 6; ++k) {
+					Reference[k][i] = C[k];
+				}
+			}
+
+			for (EPath Path : { EPath::Scalar, EPath::Vector4, EPath::Avx2 }) {
+				if (!IsPathSupported(Path)) {
+					continue;
+				}
+
+				TArray<float> Cov[6];
+				float* CovPtrs[6];
+				for (int32 k = 0; k < 6; ++k) {
+					Cov[k].SetNumUninitialized(NumSplats);
+					CovPtrs[k] = Cov[k].GetData();
+				}
+				const float* RotPtrs[4] = { Rot[0].GetData(), Rot[1].GetData(), Rot[2].GetData(), Rot[3].GetData() };
+				const float* ScalePtrs[3] = { Scale[0].GetData(), Scale[1].GetData(), Scale[2].GetData() };
+
+				double Seconds = 0.;
+				for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration) {
+					const double Start = FPlatformTime::Seconds();
+					ComputeCovariance(RotPtrs, ScalePtrs, CovPtrs, NumSplats, Path);
+					Seconds += FPlatformTime::Seconds() - Start;
+				}
+
+				float MaxError = 0.f;
+				for (int32 i = 0; i < NumSplats; ++i) {
+					const float Variance = FMath::Max3(Scale[0][i] * Scale[0][i], Scale[1][i] * Scale[1][i], Scale[2][i] * Scale[2][i]);
+					for (int32 k = 0; k < 6; ++k) {
+						MaxError = FMath::Max(MaxError, FMath::Abs(Cov[k][i] - Reference[k][i]) / Variance);
+					}
+				}
+
+				OnResult({ TEXT("covariance"), Path, MaxError, CovarianceMaxError, (double)NumSplats * NumIterations / FMath::Max(Seconds, 1e-9) });
+			}
+		}
+	}
+}
+
+
+/*
+*  GS.Kernels.Bench [NumSplats]
+*  RunKernelChecks on many splats, reports splats/second per kernel and path.
+*/
+static FAutoConsoleCommand GSKernelsBenchCommand(
+	TEXT("GS.Kernels.Bench"),
+	TEXT("Validates the splat activation kernels against the scalar reference and reports splats/second per path."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const int32 NumSplats = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1 << 20;
+
+			RunKernelChecks(NumSplats, 8, [](const FKernelResult& Result)
+				{
+					UE_LOG(LogGSLoader, Display, TEXT("%-18s %-8s %8.1f Msplats/s  max %.3g (bound %.3g) %s"),
+						Result.Name, GSKernels::GetPathName(Result.Path), Result.SplatsPerSecond * 1e-6,
+						Result.Error, Result.Bound, Result.IsWithinBound() ? TEXT("ok") : TEXT("FAILED"));
+				});
+		}));
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGSKernelsTest, "GSRuntime.Kernels.Accuracy",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::CommandletContext | EAutomationTestFlags::EngineFilter)
+
+bool FGSKernelsTest::RunTest(const FString& Parameters)
+{
+	RunKernelChecks(1 << 16, 1, [this](const FKernelResult& Result)
+		{
+			TestTrue(FString::Printf(TEXT("%s, %s path : error %g within %g"), Result.Name, GSKernels::GetPathName(Result.Path), Result.Error, Result.Bound),
+				Result.IsWithinBound());
+		});
+	return true;
+}
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
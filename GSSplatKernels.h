@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Batch activation kernels applied to splat attributes at load time.
+*  Every kernel works on structure-of-arrays input and may run in place (In == Out).
+*/
+namespace GSKernels
+{
+	enum class EPath : uint8
+	{
+		Scalar,		// FMath reference
+		Vector4,	// VectorRegister4Float : SSE, NEON or the FPU emulation
+		Avx2,		// 8 wide, only when the module is built with AVX2
+		Best,
+	};
+
+	// Worst case distance from the scalar reference, in ULPs, for inputs in [-80, 80]. Checked by the
+	// GSRuntime.Kernels.Accuracy automation test, endpoints included.
+	constexpr int32 ExpMaxUlp = 2;
+	constexpr int32 SigmoidMaxUlp = 4;
+	constexpr int32 NormalizeMaxUlp = 1;
+	constexpr int32 PositionMaxUlp = 0;
+
+	// Worst case distance of ComputeCovariance from the quaternion rotation matrix path, relative to the
+	// largest variance of the splat. Every path of ComputeCovariance rounds like the scalar one.
+	constexpr float CovarianceMaxError = 1e-5f;
+
+	// scale = exp(scale)
+	void ActivateScale(const float* In, float* Out, int32 Count, EPath Path = EPath::Best);
+
+	// opacity = 1 / (1 + exp(-opacity))
+	void ActivateOpacity(const float* In, float* Out, int32 Count, EPath Path = EPath::Best);
+
+	// q = q / |q|
+	void NormalizeQuaternions(float* X, float* Y, float* Z, float* W, int32 Count, EPath Path = EPath::Best);
+
+	// PLY (right handed, meters) to UE (left handed, centimeters) : (x, y, z) -> (x, -z, -y) * 100
+	void ConvertPositions(float* X, float* Y, float* Z, int32 Count, EPath Path = EPath::Best);
+
+	// Upper triangle xx, xy, xz, yy, yz, zz of Sigma = R S S^T R^T, from a unit quaternion (rot_0 = w, rot_1 - rot_3 = x, y, z)
+	// and activated scales, in the frame of the quaternion. Cov may alias Rot and Scale.
+	void ComputeCovariance(const float* const Rot[4], const float* const Scale[3], float* const Cov[6], int32 Count, EPath Path = EPath::Best);
+
+	// The quaternion path the VS takes, FQuat4f rotation matrix and S^2, reference of ComputeCovariance within
+	// CovarianceMaxError. Rot is w, x, y, z.
+	void ComputeCovarianceReference(const float Rot[4], const float Scale[3], float OutCov[6]);
+
+	bool IsPathSupported(EPath Path);
+	const TCHAR* GetPathName(EPath Path);
+
+	int32 UlpDistance(float A, float B);
+}	// namespace GSKernels
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSSplatPacked.h"
+#include "Async/ParallelFor.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSPacked
+{
+	void Pack(const PLY::FSplatStreams& Streams, TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>& Out)
+	{
+		const UINT NumParticles = Streams.NumParticles;
+		const int32 NumRest = PLY::GetNumShRest(Streams.ShDegree);
+		const uint32 Stride4 = GetRecordStride(Streams.ShDegree) / sizeof(FVector4f);
+
+		Out.SetNumZeroed(NumParticles * Stride4);
+
+		const float* PosRot = static_cast<const float*>(Streams.Streams[PLY::SplatStream_PosRot]->GetResourceData());
+		const FVector4f* Scl = static_cast<const FVector4f*>(Streams.Streams[PLY::SplatStream_Scale]->GetResourceData());
+		const FVector4f* Sh0 = static_cast<const FVector4f*>(Streams.Streams[PLY::SplatStream_Sh0]->GetResourceData());
+		const FVector4f* Bands[9] = {};
+		for (int32 s = 0; s < 9; ++s) {
+			FResourceArrayInterface* Stream = Streams.Streams[PLY::SplatStream_Sh1_4 + s];
+			Bands[s] = Stream ? static_cast<const FVector4f*>(Stream->GetResourceData()) : nullptr;
+		}
+
+		// rest coefficient j of channel c : sh0.yzw for the first 3, band stream (j - 3) / 4 after
+		auto GetRest = [&](UINT i, int32 c, int32 j)
+			{
+				return j < 3 ? Sh0[i * 3 + c][1 + j] : Bands[((j - 3) / 4) * 3 + c][i][(j - 3) % 4];
+			};
+
+		constexpr int32 BatchSize = 16 * 1024;
+		ParallelFor(FMath::DivideAndRoundUp<int32>(NumParticles, BatchSize), [&](int32 BatchIdx)
+			{
+				const UINT Begin = BatchIdx * BatchSize;
+				const UINT End = FMath::Min<UINT>(Begin + BatchSize, NumParticles);
+				for (UINT i = Begin; i < End; ++i) {
+					float* Record = reinterpret_cast<float*>(&Out[i * Stride4]);
+					const float* P = PosRot + i * 7;
+
+					Record[0] = P[0];
+					Record[1] = P[1];
+					Record[2] = P[2];
+					Record[3] = Scl[i].W;
+					Record[4] = P[3];
+					Record[5] = P[4];
+					Record[6] = P[5];
+					Record[7] = P[6];
+					Record[8] = Scl[i].X;
+					Record[9] = Scl[i].Y;
+					Record[10] = Scl[i].Z;
+					Record[11] = Sh0[i * 3 + 0].X;
+					Record[12] = Sh0[i * 3 + 1].X;
+					Record[13] = Sh0[i * 3 + 2].X;
+
+					float* Rest = Record + NumBaseFloats;
+					for (int32 j = 0; j < NumRest; ++j) {
+						for (int32 c = 0; c < 3; ++c) {
+							Rest[j * 3 + c] = GetRest(i, c, j);
+						}
+					}
+				}
+			});
+	}
+}	// namespace GSPacked
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GSPlyLoader.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Packed splat records, one StructuredBuffer<float4> read by index in the vertex stage
+*
+*  Every splat is a single contiguous record instead of 13 vertex streams :
+*    float4	position.xyz, opacity
+*    float4	rot_0 - rot_3		| cov xx, xy, xz, yy
+*    float4	scale.xyz, dc.r		| cov yz, zz, 0, dc.r
+*    float2	dc.g, dc.b
+*    float3	rest coefficient j (r, g, b) for j < GetNumShRest(ShDegree)
+*  with the covariance layout of PLY::ConvertToCovariance when Streams.bCovariance is set,
+*  padded to a multiple of the cache line, so the vertex stage touches 1 (degree 0), 2 (degree 1),
+*  3 (degree 2) or 4 (degree 3) lines per splat and nothing else.
+*/
+namespace GSPacked
+{
+	constexpr uint32 CacheLineSize = 64;
+	constexpr uint32 NumBaseFloats = 14;
+
+	// bytes per record, a multiple of CacheLineSize
+	FORCEINLINE uint32 GetRecordStride(int32 ShDegree)
+	{
+		return Align((NumBaseFloats + 3 * PLY::GetNumShRest(ShDegree)) * (uint32)sizeof(float), CacheLineSize);
+	}
+
+	// Repacks the upload streams into records, multithreaded over particles. Out is sized by this call.
+	void Pack(const PLY::FSplatStreams& Streams, TResourceArray<FVector4f, VERTEXBUFFER_ALIGNMENT>& Out);
+}	// namespace GSPacked
@@ -0,0 +1,548 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GSTileRaster.h"
+#include "GSBufferPool.h"
+#include "GSSortKeys.h"
+#include "GSSplatCompressed.h"
+#include "DataDrivenShaderPlatformInfo.h"
+#include "GlobalShader.h"
+#include "GPUSort.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderUtils.h"
+#include "ShaderParameterStruct.h"
+#include "Stats/Stats.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogGSTile, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("GSTiles"), STATGROUP_GSTiles, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sorted tile entries"), STAT_GSTileEntries, STATGROUP_GSTiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped tile entries"), STAT_GSTileDroppedEntries, STATGROUP_GSTiles);
+
+static TAutoConsoleVariable<float> CVarTilesMinTransmittance(
+	TEXT("r.GS.Tiles.MinTransmittance"),
+	1.f / 255.f,
+	TEXT("Transmittance under which a pixel of the tile rasterizer is opaque and stops blending. A tile stops reading\n")
+	TEXT("splats once all its pixels are."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarTilesEntriesPerSplat(
+	TEXT("r.GS.Tiles.EntriesPerSplat"),
+	4.f,
+	TEXT("Tile entries per splat the tile rasterizer sorts until the count of a frame has been read back."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarTilesMaxEntries(
+	TEXT("r.GS.Tiles.MaxEntries"),
+	16 * 1024 * 1024,
+	TEXT("Tile entries the tile rasterizer sorts at most per actor and frame, 16 bytes each. Past it the farthest splats are\n")
+	TEXT("dropped from the tiles."),
+	ECVF_RenderThreadSafe);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  FGSTilePreprocessCS
+*/
+class FGSTilePreprocessCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSTilePreprocessCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSTilePreprocessCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumSplats)
+		SHADER_PARAMETER(FVector3f, gPreViewTranslation3)
+		SHADER_PARAMETER(FVector2f, gViewSize2)
+		SHADER_PARAMETER(FUintVector2, gNumTiles2)
+		SHADER_PARAMETER(FMatrix44f, gLocal2World4x4)
+		SHADER_PARAMETER(FMatrix44f, gTranslatedWorld2View4x4)
+		SHADER_PARAMETER(FMatrix44f, gView2Clip4x4)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gSortedIndices)
+		// SPLAT_LAYOUT 0, the vertex streams as raw floats
+		SHADER_PARAMETER_SRV(Buffer<float>, gPosRot)
+		SHADER_PARAMETER_SRV(Buffer<float>, gScl)
+		SHADER_PARAMETER_SRV(Buffer<float>, gSh0)
+		SHADER_PARAMETER_SRV(Buffer<float>, gR_Sh1_4_0)
+		SHADER_PARAMETER_SRV(Buffer<float>, gG_Sh1_4_0)
+		SHADER_PARAMETER_SRV(Buffer<float>, gB_Sh1_4_0)
+		SHADER_PARAMETER_SRV(Buffer<float>, gR_Sh1_4_1)
+		SHADER_PARAMETER_SRV(Buffer<float>, gG_Sh1_4_1)
+		SHADER_PARAMETER_SRV(Buffer<float>, gB_Sh1_4_1)
+		SHADER_PARAMETER_SRV(Buffer<float>, gR_Sh1_4_2)
+		SHADER_PARAMETER_SRV(Buffer<float>, gG_Sh1_4_2)
+		SHADER_PARAMETER_SRV(Buffer<float>, gB_Sh1_4_2)
+		// SPLAT_LAYOUT 1, GSPacked records
+		SHADER_PARAMETER_SRV(StructuredBuffer<float4>, gPackedSplats)
+		SHADER_PARAMETER(uint32, gSplatStride4)
+		// SPLAT_LAYOUT 2, GSCompressed chunks
+		SHADER_PARAMETER_SRV(StructuredBuffer<float>, gCompactChunks)
+		SHADER_PARAMETER_SRV(StructuredBuffer<uint4>, gCompactSplats)
+		SHADER_PARAMETER_SRV(StructuredBuffer<uint>, gCompactShRest)
+		SHADER_PARAMETER(uint32, gChunkSize)
+		SHADER_PARAMETER(uint32, gChunkStride)
+		SHADER_PARAMETER(uint32, gShRestStride)
+		SHADER_PARAMETER_UAV(RWBuffer<uint4>, gProjected)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gTileCounts)
+	END_SHADER_PARAMETER_STRUCT()
+
+	class FLayoutDim : SHADER_PERMUTATION_INT("SPLAT_LAYOUT", 3);
+	class FSHDegreeDim : SHADER_PERMUTATION_RANGE_INT("SH_DEGREE", 0, PLY::MaxShDegree + 1);
+	class FCovarianceDim : SHADER_PERMUTATION_BOOL("PRECOMPUTED_COVARIANCE");
+	class FTileCountsDim : SHADER_PERMUTATION_BOOL("TILE_COUNTS");
+	using FPermutationDomain = TShaderPermutationDomain<FLayoutDim, FSHDegreeDim, FCovarianceDim, FTileCountsDim>;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		// SM5 for the quad draw, which has no other compute. Compact splats are always rotation and scale.
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5)
+			&& !(PermutationVector.Get<FLayoutDim>() == (int32)GSTile::ESplatLayout::Compact && PermutationVector.Get<FCovarianceDim>());
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		OutEnvironment.SetDefine(TEXT("FULL_SH"), PermutationVector.Get<FSHDegreeDim>() == PLY::MaxShDegree ? 1 : 0);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSTile::ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("TILE_SIZE"), GSTile::TileSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSTilePreprocessCS, "/GSRuntime/GaussSplatTiles.usf", "PreprocessCS", SF_Compute);
+
+
+/*
+*  FGSTileScanBlocksCS, FGSTileScanBlockSumsCS
+*/
+class FGSTileScanBlocksCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSTileScanBlocksCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSTileScanBlocksCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumSplats)
+		SHADER_PARAMETER(uint32, gNumBlocks)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gTileCounts)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gBlockSums)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSTile::ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("SCAN_BLOCK_SIZE"), GSTile::ScanBlockSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSTileScanBlocksCS, "/GSRuntime/GaussSplatTiles.usf", "ScanBlocksCS", SF_Compute);
+
+class FGSTileScanBlockSumsCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSTileScanBlockSumsCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSTileScanBlockSumsCS, FGlobalShader)
+
+	using FParameters = FGSTileScanBlocksCS::FParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSTile::ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("SCAN_BLOCK_SIZE"), GSTile::ScanBlockSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSTileScanBlockSumsCS, "/GSRuntime/GaussSplatTiles.usf", "ScanBlockSumsCS", SF_Compute);
+
+
+/*
+*  FGSTileDuplicateCS, FGSTileRangesCS
+*/
+class FGSTileDuplicateCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSTileDuplicateCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSTileDuplicateCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumSplats)
+		SHADER_PARAMETER(uint32, gNumEntries)
+		SHADER_PARAMETER(FUintVector2, gNumTiles2)
+		SHADER_PARAMETER_SRV(Buffer<uint4>, gProjected)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gTileCounts)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gBlockSums)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gTileKeys)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, gTileValues)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSTile::ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("SCAN_BLOCK_SIZE"), GSTile::ScanBlockSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSTileDuplicateCS, "/GSRuntime/GaussSplatTiles.usf", "DuplicateCS", SF_Compute);
+
+class FGSTileRangesCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSTileRangesCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSTileRangesCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(uint32, gNumEntries)
+		SHADER_PARAMETER(uint32, gNumTiles)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gBlockSums)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gTileKeys)
+		SHADER_PARAMETER_UAV(RWBuffer<uint2>, gTileRanges)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSTile::ThreadGroupSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSTileRangesCS, "/GSRuntime/GaussSplatTiles.usf", "TileRangesCS", SF_Compute);
+
+
+/*
+*  FGSTileRasterCS
+*/
+class FGSTileRasterCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FGSTileRasterCS);
+	SHADER_USE_PARAMETER_STRUCT(FGSTileRasterCS, FGlobalShader)
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, gViewMin2)
+		SHADER_PARAMETER(FIntPoint, gViewMax2)
+		SHADER_PARAMETER(FUintVector2, gNumTiles2)
+		SHADER_PARAMETER(float, gMinTransmittance)
+		SHADER_PARAMETER_SRV(Buffer<uint4>, gProjected)
+		SHADER_PARAMETER_SRV(Buffer<uint2>, gTileRanges)
+		SHADER_PARAMETER_SRV(Buffer<uint>, gTileValues)
+		SHADER_PARAMETER_UAV(RWTexture2D<float4>, gSceneColor)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM6);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), GSTile::ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("TILE_SIZE"), GSTile::TileSize);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FGSTileRasterCS, "/GSRuntime/GaussSplatTiles.usf", "RasterCS", SF_Compute);
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	void ReleaseTileBuffer(FBufferRHIRef& Buffer, FShaderResourceViewRHIRef& SRV, FUnorderedAccessViewRHIRef& UAV)
+	{
+		UAV.SafeRelease();
+		SRV.SafeRelease();
+		GSBufferPool::Release(Buffer);
+	}
+
+	void AcquireTileBuffer(FRHICommandListBase& RHICmdList, uint32 Size, uint32 Stride, EPixelFormat Format, const TCHAR* Name,
+		FBufferRHIRef& Buffer, FShaderResourceViewRHIRef& SRV, FUnorderedAccessViewRHIRef& UAV)
+	{
+		ReleaseTileBuffer(Buffer, SRV, UAV);
+		Buffer = GSBufferPool::Acquire(RHICmdList, GSBufferPool::EKind::Vertex, Size, BUF_Static | BUF_ShaderResource | BUF_UnorderedAccess, Name);
+		SRV = RHICmdList.CreateShaderResourceView(Buffer, Stride, Format);
+		UAV = RHICmdList.CreateUnorderedAccessView(Buffer, Format);
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+namespace GSTile
+{
+	void Project_RenderThread(FRHIComputeCommandList& RHICmdList, const FSplatSource& Source, const FView& View,
+		FRHIShaderResourceView* SortedIndexSRV, uint32 NumSplats, FRHIUnorderedAccessView* ProjectedUAV, FRHIUnorderedAccessView* TileCountUAV)
+	{
+		const FIntPoint NumTiles = GetNumTiles(View.ViewRect);
+
+		FGSTilePreprocessCS::FPermutationDomain Permutation;
+		Permutation.Set<FGSTilePreprocessCS::FLayoutDim>((int32)Source.Layout);
+		Permutation.Set<FGSTilePreprocessCS::FSHDegreeDim>(Source.ShDegree);
+		Permutation.Set<FGSTilePreprocessCS::FCovarianceDim>(Source.Layout != ESplatLayout::Compact && Source.bCovariance);
+		Permutation.Set<FGSTilePreprocessCS::FTileCountsDim>(TileCountUAV != nullptr);
+		TShaderMapRef<FGSTilePreprocessCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), Permutation);
+
+		FGSTilePreprocessCS::FParameters Parameters;
+		Parameters.gNumSplats = NumSplats;
+		Parameters.gPreViewTranslation3 = View.PreViewTranslation;
+		Parameters.gViewSize2 = FVector2f(View.ViewRect.Width(), View.ViewRect.Height());
+		Parameters.gNumTiles2 = FUintVector2(NumTiles.X, NumTiles.Y);
+		Parameters.gLocal2World4x4 = View.Local2World;
+		Parameters.gTranslatedWorld2View4x4 = View.TranslatedWorld2View;
+		Parameters.gView2Clip4x4 = View.View2Clip;
+		Parameters.gSortedIndices = SortedIndexSRV;
+		Parameters.gPosRot = Source.Streams[PLY::SplatStream_PosRot];
+		Parameters.gScl = Source.Streams[PLY::SplatStream_Scale];
+		Parameters.gSh0 = Source.Streams[PLY::SplatStream_Sh0];
+		Parameters.gR_Sh1_4_0 = Source.Streams[PLY::SplatStream_Sh1_4 + 0];
+		Parameters.gG_Sh1_4_0 = Source.Streams[PLY::SplatStream_Sh1_4 + 1];
+		Parameters.gB_Sh1_4_0 = Source.Streams[PLY::SplatStream_Sh1_4 + 2];
+		Parameters.gR_Sh1_4_1 = Source.Streams[PLY::SplatStream_Sh1_4 + 3];
+		Parameters.gG_Sh1_4_1 = Source.Streams[PLY::SplatStream_Sh1_4 + 4];
+		Parameters.gB_Sh1_4_1 = Source.Streams[PLY::SplatStream_Sh1_4 + 5];
+		Parameters.gR_Sh1_4_2 = Source.Streams[PLY::SplatStream_Sh1_4 + 6];
+		Parameters.gG_Sh1_4_2 = Source.Streams[PLY::SplatStream_Sh1_4 + 7];
+		Parameters.gB_Sh1_4_2 = Source.Streams[PLY::SplatStream_Sh1_4 + 8];
+		Parameters.gPackedSplats = Source.PackedSplats;
+		Parameters.gSplatStride4 = Source.PackedStride4;
+		Parameters.gCompactChunks = Source.CompactChunks;
+		Parameters.gCompactSplats = Source.CompactSplats;
+		Parameters.gCompactShRest = Source.CompactShRest;
+		Parameters.gChunkSize = GSCompressed::ChunkSize;
+		Parameters.gChunkStride = GSCompressed::ChunkStride;
+		Parameters.gShRestStride = GSCompressed::GetShRestStride(Source.ShDegree);
+		Parameters.gProjected = ProjectedUAV;
+		Parameters.gTileCounts = TileCountUAV;
+		FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, FComputeShaderUtils::GetGroupCountWrapped(NumSplats, ThreadGroupSize));
+	}
+
+
+	/*
+	*  FTileRasterizer
+	*/
+	uint32 FTileRasterizer::Prepare_RenderThread(FRHICommandListBase& RHICmdList, uint32 NumSplats, const FIntRect& ViewRect)
+	{
+		const FIntPoint NumTiles = GetNumTiles(ViewRect);
+		if (!NumSplats || NumTiles.X <= 0 || NumTiles.Y <= 0) {
+			return 0;
+		}
+
+		if (bReadbackPending && TotalReadback->IsReady()) {
+			LastNumEntries = *static_cast<const uint32*>(TotalReadback->Lock(sizeof(uint32)));
+			TotalReadback->Unlock();
+			bReadbackPending = false;
+
+			// DuplicateCS kept the nearest ReadbackNumEntries
+			LastNumDropped = LastNumEntries > ReadbackNumEntries ? LastNumEntries - ReadbackNumEntries : 0;
+			if (LastNumDropped && !bOverflowLogged) {
+				UE_LOG(LogGSTile, Warning, TEXT("%u tile entries, %u sorted : the farthest splats were dropped from the tiles (r.GS.Tiles.MaxEntries %d)"),
+					LastNumEntries, ReadbackNumEntries, CVarTilesMaxEntries.GetValueOnRenderThread());
+			}
+			bOverflowLogged = LastNumDropped != 0;
+		}
+
+		// a quarter over the last count read back, which is a few frames old
+		const uint64 Wanted = LastNumEntries
+			? (uint64)LastNumEntries + LastNumEntries / 4
+			: (uint64)(NumSplats * FMath::Max(CVarTilesEntriesPerSplat.GetValueOnRenderThread(), 1.f));
+		const uint64 MaxEntries = FMath::Max(CVarTilesMaxEntries.GetValueOnRenderThread(), ScanBlockSize);
+		const uint32 NumEntries = (uint32)FMath::Min(Align(FMath::Max<uint64>(Wanted, 1), ScanBlockSize), MaxEntries);
+
+		Grow(RHICmdList, NumSplats, NumEntries, NumTiles.X * NumTiles.Y);
+
+		INC_DWORD_STAT_BY(STAT_GSTileEntries, NumEntries);
+		INC_DWORD_STAT_BY(STAT_GSTileDroppedEntries, LastNumDropped);
+		return NumEntries;
+	}
+
+	void FTileRasterizer::Grow(FRHICommandListBase& RHICmdList, uint32 NumSplats, uint32 NumEntries, uint32 NumTiles)
+	{
+		if (NumSplats > SplatCapacity) {
+			SplatCapacity = Align(NumSplats, ScanBlockSize);
+			const uint32 NumBlocks = SplatCapacity / ScanBlockSize;
+			AcquireTileBuffer(RHICmdList, SplatCapacity * sizeof(FProjectedSplat), sizeof(FUintVector4), PF_R32G32B32A32_UINT, TEXT("GSTileProjected"), ProjectedBuffer, ProjectedSRV, ProjectedUAV);
+			AcquireTileBuffer(RHICmdList, SplatCapacity * sizeof(uint32), sizeof(uint32), PF_R32_UINT, TEXT("GSTileOffsets"), TileOffsetBuffer, TileOffsetSRV, TileOffsetUAV);
+			AcquireTileBuffer(RHICmdList, (1 + NumBlocks) * sizeof(uint32), sizeof(uint32), PF_R32_UINT, TEXT("GSTileBlockSums"), BlockSumBuffer, BlockSumSRV, BlockSumUAV);
+		}
+
+		if (NumEntries > EntryCapacity) {
+			EntryCapacity = NumEntries;
+			for (int32 i = 0; i < 4; ++i) {
+				AcquireTileBuffer(RHICmdList, EntryCapacity * sizeof(uint32), sizeof(uint32), PF_R32_UINT, i < 2 ? TEXT("GSTileKeys") : TEXT("GSTileValues"), EntryBuffers[i], EntrySRVs[i], EntryUAVs[i]);
+			}
+		}
+
+		if (NumTiles > TileCapacity) {
+			TileCapacity = NumTiles;
+			AcquireTileBuffer(RHICmdList, TileCapacity * sizeof(FUintVector2), sizeof(FUintVector2), PF_R32G32_UINT, TEXT("GSTileRanges"), TileRangeBuffer, TileRangeSRV, TileRangeUAV);
+		}
+
+		if (!TotalReadback) {
+			TotalReadback = MakeUnique<FRHIGPUBufferReadback>(TEXT("GSTileTotal"));
+		}
+	}
+
+	void FTileRasterizer::Execute_RenderThread(FRHICommandList& RHICmdList, const FSplatSource& Source, const FView& View,
+		FRHIShaderResourceView* SortedIndexSRV, uint32 NumSplats, uint32 NumEntries, FRHITexture* SceneColor)
+	{
+		const FIntPoint NumTiles = GetNumTiles(View.ViewRect);
+		const uint32 NumTilesTotal = NumTiles.X * NumTiles.Y;
+		check(NumEntries && NumSplats <= SplatCapacity && NumEntries <= EntryCapacity && NumTilesTotal <= TileCapacity);
+
+		if (SceneColorTexture != SceneColor) {
+			SceneColorUAV = RHICmdList.CreateUnorderedAccessView(SceneColor, 0);
+			SceneColorTexture = SceneColor;
+		}
+
+		const uint32 NumBlocks = FMath::DivideAndRoundUp(NumSplats, (uint32)ScanBlockSize);
+		const int32 KeyBits = FMath::CeilLogTwo(NumTilesTotal + 1);
+		const int32 ResultIndex = GSSort::GetNumRadixPasses(KeyBits) & 1;	// SortGPUBuffers flips buffers once per pass
+		const FUintVector2 NumTiles2(NumTiles.X, NumTiles.Y);
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+		RHICmdList.Transition({
+			FRHITransitionInfo(ProjectedUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(TileOffsetUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(BlockSumUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(EntryUAVs[0], ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(EntryUAVs[1], ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(EntryUAVs[2], ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(EntryUAVs[3], ERHIAccess::Unknown, ERHIAccess::UAVCompute),
+			FRHITransitionInfo(TileRangeUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute) });
+		// unused entries keep the padding key, which sorts after every tile
+		RHICmdList.ClearUAVUint(EntryUAVs[0], FUintVector4(MAX_uint32));
+		RHICmdList.ClearUAVUint(TileRangeUAV, FUintVector4(0));
+
+		Project_RenderThread(RHICmdList, Source, View, SortedIndexSRV, NumSplats, ProjectedUAV, TileOffsetUAV);
+
+		// tile counts to offsets
+		{
+			FGSTileScanBlocksCS::FParameters Parameters;
+			Parameters.gNumSplats = NumSplats;
+			Parameters.gNumBlocks = NumBlocks;
+			Parameters.gTileCounts = TileOffsetUAV;
+			Parameters.gBlockSums = BlockSumUAV;
+
+			RHICmdList.Transition(FRHITransitionInfo(TileOffsetUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+			TShaderMapRef<FGSTileScanBlocksCS> ScanBlocks(ShaderMap);
+			FComputeShaderUtils::Dispatch(RHICmdList, ScanBlocks, Parameters, FComputeShaderUtils::GetGroupCountWrapped(NumBlocks));
+
+			RHICmdList.Transition(FRHITransitionInfo(BlockSumUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+			TShaderMapRef<FGSTileScanBlockSumsCS> ScanBlockSums(ShaderMap);
+			FComputeShaderUtils::Dispatch(RHICmdList, ScanBlockSums, Parameters, FIntVector(1, 1, 1));
+		}
+
+		RHICmdList.Transition({
+			FRHITransitionInfo(ProjectedBuffer, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute),
+			FRHITransitionInfo(TileOffsetBuffer, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute),
+			FRHITransitionInfo(BlockSumBuffer, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute),
+			FRHITransitionInfo(EntryUAVs[0], ERHIAccess::UAVCompute, ERHIAccess::UAVCompute) });
+
+		{
+			TShaderMapRef<FGSTileDuplicateCS> ComputeShader(ShaderMap);
+			FGSTileDuplicateCS::FParameters Parameters;
+			Parameters.gNumSplats = NumSplats;
+			Parameters.gNumEntries = NumEntries;
+			Parameters.gNumTiles2 = NumTiles2;
+			Parameters.gProjected = ProjectedSRV;
+			Parameters.gTileCounts = TileOffsetSRV;
+			Parameters.gBlockSums = BlockSumSRV;
+			Parameters.gTileKeys = EntryUAVs[0];
+			Parameters.gTileValues = EntryUAVs[2];
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, FComputeShaderUtils::GetGroupCountWrapped(NumSplats, ThreadGroupSize));
+		}
+
+		// stable : the entries of a tile stay in the actor's depth order
+		{
+			FGPUSortBuffers SortBuffers;
+			for (int32 BufferIndex = 0; BufferIndex < 2; ++BufferIndex) {
+				SortBuffers.RemoteKeySRVs[BufferIndex] = EntrySRVs[BufferIndex];
+				SortBuffers.RemoteKeyUAVs[BufferIndex] = EntryUAVs[BufferIndex];
+				SortBuffers.RemoteValueSRVs[BufferIndex] = EntrySRVs[2 + BufferIndex];
+				SortBuffers.RemoteValueUAVs[BufferIndex] = EntryUAVs[2 + BufferIndex];
+			}
+			const int32 SortedIndex = SortGPUBuffers(RHICmdList, SortBuffers, 0, GSSort::GetKeyMask(KeyBits), NumEntries, ERHIFeatureLevel::Type::SM6);
+			checkf(SortedIndex == ResultIndex, TEXT("SortGPUBuffers sorted into buffer %d, the ranges read %d"), SortedIndex, ResultIndex);
+		}
+
+		RHICmdList.Transition({
+			FRHITransitionInfo(EntryBuffers[ResultIndex], ERHIAccess::Unknown, ERHIAccess::SRVCompute),
+			FRHITransitionInfo(EntryBuffers[2 + ResultIndex], ERHIAccess::Unknown, ERHIAccess::SRVCompute) });
+
+		{
+			TShaderMapRef<FGSTileRangesCS> ComputeShader(ShaderMap);
+			FGSTileRangesCS::FParameters Parameters;
+			Parameters.gNumEntries = NumEntries;
+			Parameters.gNumTiles = NumTilesTotal;
+			Parameters.gBlockSums = BlockSumSRV;
+			Parameters.gTileKeys = EntrySRVs[ResultIndex];
+			Parameters.gTileRanges = TileRangeUAV;
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, FComputeShaderUtils::GetGroupCountWrapped(NumEntries, ThreadGroupSize));
+		}
+
+		RHICmdList.Transition(FRHITransitionInfo(TileRangeBuffer, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute));
+
+		{
+			TShaderMapRef<FGSTileRasterCS> ComputeShader(ShaderMap);
+			FGSTileRasterCS::FParameters Parameters;
+			Parameters.gViewMin2 = View.ViewRect.Min;
+			Parameters.gViewMax2 = View.ViewRect.Max;
+			Parameters.gNumTiles2 = NumTiles2;
+			Parameters.gMinTransmittance = CVarTilesMinTransmittance.GetValueOnRenderThread();
+			Parameters.gProjected = ProjectedSRV;
+			Parameters.gTileRanges = TileRangeSRV;
+			Parameters.gTileValues = EntrySRVs[2 + ResultIndex];
+			Parameters.gSceneColor = SceneColorUAV;
+			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, Parameters, FIntVector(NumTiles.X, NumTiles.Y, 1));
+		}
+
+		// one count in flight, it sizes the sorts of the frames after it lands
+		if (!bReadbackPending) {
+			RHICmdList.Transition(FRHITransitionInfo(BlockSumBuffer, ERHIAccess::SRVCompute, ERHIAccess::CopySrc));
+			TotalReadback->EnqueueCopy(RHICmdList, BlockSumBuffer, sizeof(uint32));
+			ReadbackNumEntries = NumEntries;
+			bReadbackPending = true;
+		}
+	}
+
+	void FTileRasterizer::Release()
+	{
+		ReleaseTileBuffer(ProjectedBuffer, ProjectedSRV, ProjectedUAV);
+		ReleaseTileBuffer(TileOffsetBuffer, TileOffsetSRV, TileOffsetUAV);
+		ReleaseTileBuffer(BlockSumBuffer, BlockSumSRV, BlockSumUAV);
+		for (int32 i = 0; i < 4; ++i) {
+			ReleaseTileBuffer(EntryBuffers[i], EntrySRVs[i], EntryUAVs[i]);
+		}
+		ReleaseTileBuffer(TileRangeBuffer, TileRangeSRV, TileRangeUAV);
+
+		SplatCapacity = 0;
+		EntryCapacity = 0;
+		TileCapacity = 0;
+		LastNumEntries = 0;
+		LastNumDropped = 0;
+		ReadbackNumEntries = 0;
+		bOverflowLogged = false;
+		TotalReadback.Reset();
+		bReadbackPending = false;
+		SceneColorUAV.SafeRelease();
+		SceneColorTexture = nullptr;
+	}
+}	// namespace GSTile
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHIGPUReadback.h"
+#include "GSPlyLoader.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+/*
+*  Tile-based compute rasterizer
+*
+*  Alternative to the point list / geometry shader draw for overdraw-bound views, see AGSActor::RenderMode. Splats
+*  are projected once, binned into TileSize screen tiles and blended front to back per pixel in compute, a tile
+*  stops reading splats once all its pixels are under r.GS.Tiles.MinTransmittance.
+*
+*  The depth order comes from the actor's sort : splats are binned in sorted order (far first) and the tile keys
+*  sorted by a stable SortGPUBuffers, so every tile list is already depth sorted and the tile id is the only key,
+*  CeilLogTwo(NumTiles + 1) bits wide. The raster walks a tile list from its end, nearest first.
+*
+*  Kernels (GaussSplatTiles.usf), ThreadGroupSize threads, index wrapped over the group grid :
+*    PreprocessCS	sorted entry k : splat gSortedIndices[k] projected as the VS does (SPLAT_LAYOUT, SH_DEGREE,
+*			PRECOMPUTED_COVARIANCE), gProjected[k] = FProjectedSplat, zero opacity and extent when culled.
+*			TILE_COUNTS : gTileCounts[k] = tiles of its 3 sigma rect, 0 when culled. Without it, the quad draw
+*			of GSQuadDraw.h.
+*    ScanBlocksCS	exclusive scan of gTileCounts in place, ScanBlockSize per group, block totals to gBlockSums[1 + g]
+*    ScanBlockSumsCS	one group : exclusive scan of the block totals in place, the grand total to gBlockSums[0]
+*    DuplicateCS	entries gTileCounts[k] + gBlockSums[1 + k / ScanBlockSize] on : gTileKeys = tile, gTileValues = k.
+*			When gBlockSums[0] is over gNumEntries, the first gBlockSums[0] - gNumEntries entries are dropped
+*			and the others written that much lower : entries come far first, the nearest splats are kept.
+*    TileRangesCS	over the sorted entries : gTileRanges[tile] = (first, end) of its entries
+*    RasterCS		one group of TileSize x TileSize per tile : front to back over the tile list, batches of
+*			ThreadGroupSize splats through groupshared, gSceneColor = (C + T * scene.rgb, T * scene.a) as the
+*			SrcAlpha / InvSrcAlpha draw blends
+*/
+namespace GSTile
+{
+	constexpr int32 TileSize = 16;
+	constexpr int32 ThreadGroupSize = TileSize * TileSize;
+	constexpr int32 ScanBlockSize = 4 * ThreadGroupSize;
+
+	// PreprocessCS output, 3 uint4 per sorted entry
+	struct FProjectedSplat
+	{
+		FVector2f Center;	// pixels, from the view rect origin
+		FVector3f Conic;	// inverse 2D covariance xx, xy, yy
+		float Opacity;
+		uint32 TileMin;		// x | y << 16
+		uint32 TileMax;		// inclusive
+		uint32 ColorRG;		// half2
+		uint32 ColorB;		// half, high half unused
+		FVector2f Extent;	// 3 sigma half size in pixels, along the view axes
+	};
+	static_assert(sizeof(FProjectedSplat) == 3 * sizeof(FUintVector4), "PreprocessCS writes 3 uint4");
+
+	// how the draw reads the splats, the matching FTriangle*VS of AGSActor
+	enum class ESplatLayout : uint8
+	{
+		Streams,
+		Packed,
+		Compact,
+	};
+
+	struct FSplatSource
+	{
+		ESplatLayout Layout = ESplatLayout::Streams;
+		int32 ShDegree = 0;
+		bool bCovariance = false;
+
+		// Streams : Buffer<float> views of every vertex stream, null for the bands ShDegree leaves out.
+		// Packed and Compact only read PLY::SplatStream_PosRot from it.
+		FRHIShaderResourceView* Streams[PLY::SplatStream_Count] = {};
+
+		FRHIShaderResourceView* PackedSplats = nullptr;
+		uint32 PackedStride4 = 0;
+
+		FRHIShaderResourceView* CompactChunks = nullptr;
+		FRHIShaderResourceView* CompactSplats = nullptr;
+		FRHIShaderResourceView* CompactShRest = nullptr;
+	};
+
+	struct FView
+	{
+		FMatrix44f Local2World;
+		FMatrix44f TranslatedWorld2View;
+		FMatrix44f View2Clip;
+		FVector3f PreViewTranslation;
+		FIntRect ViewRect;
+	};
+
+	// tile grid of a view rect
+	FORCEINLINE FIntPoint GetNumTiles(const FIntRect& ViewRect)
+	{
+		return FIntPoint(FMath::DivideAndRoundUp(ViewRect.Width(), TileSize), FMath::DivideAndRoundUp(ViewRect.Height(), TileSize));
+	}
+
+	// PreprocessCS alone : FProjectedSplat of the NumSplats entries of SortedIndexSRV into ProjectedUAV (Buffer<uint4>),
+	// and their tile counts into TileCountUAV when not null.
+	void Project_RenderThread(FRHIComputeCommandList& RHICmdList, const FSplatSource& Source, const FView& View,
+		FRHIShaderResourceView* SortedIndexSRV, uint32 NumSplats, FRHIUnorderedAccessView* ProjectedUAV, FRHIUnorderedAccessView* TileCountUAV);
+
+	// One per actor, render thread. Graphics queue only : the tile keys go through SortGPUBuffers.
+	class FTileRasterizer
+	{
+	public:
+		// At setup time : buffers for NumSplats splats over ViewRect. Returns the tile entries to sort this frame,
+		// sized from the counts of the frames before, 0 when there is nothing to draw. A frame with more entries
+		// drops its farthest ones, counted in STAT_GSTileDroppedEntries (stat GSTiles) and logged once per overflow.
+		uint32 Prepare_RenderThread(FRHICommandListBase& RHICmdList, uint32 NumSplats, const FIntRect& ViewRect);
+
+		// Blends the NumSplats entries of SortedIndexSRV, far first, over SceneColor within View.ViewRect.
+		// SceneColor needs TexCreate_UAV and must be in UAVCompute state.
+		void Execute_RenderThread(FRHICommandList& RHICmdList, const FSplatSource& Source, const FView& View,
+			FRHIShaderResourceView* SortedIndexSRV, uint32 NumSplats, uint32 NumEntries, FRHITexture* SceneColor);
+
+		void Release();
+
+	private:
+		void Grow(FRHICommandListBase& RHICmdList, uint32 NumSplats, uint32 NumEntries, uint32 NumTiles);
+
+		uint32 SplatCapacity = 0;
+		uint32 EntryCapacity = 0;
+		uint32 TileCapacity = 0;
+		uint32 LastNumEntries = 0;		// 0 until the first readback
+		uint32 LastNumDropped = 0;		// entries of that frame past the ones it sorted
+		uint32 ReadbackNumEntries = 0;		// sorted in the frame of the readback in flight
+		bool bOverflowLogged = false;
+
+		FBufferRHIRef ProjectedBuffer;
+		FShaderResourceViewRHIRef ProjectedSRV;
+		FUnorderedAccessViewRHIRef ProjectedUAV;
+
+		FBufferRHIRef TileOffsetBuffer;
+		FShaderResourceViewRHIRef TileOffsetSRV;
+		FUnorderedAccessViewRHIRef TileOffsetUAV;
+
+		FBufferRHIRef BlockSumBuffer;
+		FShaderResourceViewRHIRef BlockSumSRV;
+		FUnorderedAccessViewRHIRef BlockSumUAV;
+
+		// SortGPUBuffers pairs, keys in 0 - 1, values in 2 - 3
+		FBufferRHIRef EntryBuffers[4];
+		FShaderResourceViewRHIRef EntrySRVs[4];
+		FUnorderedAccessViewRHIRef EntryUAVs[4];
+
+		FBufferRHIRef TileRangeBuffer;
+		FShaderResourceViewRHIRef TileRangeSRV;
+		FUnorderedAccessViewRHIRef TileRangeUAV;
+
+		// gBlockSums[0] of a past frame, sizes the sort of the next ones
+		TUniquePtr<FRHIGPUBufferReadback> TotalReadback;
+		bool bReadbackPending = false;
+
+		// the view holds the texture, which cannot come back at the same address meanwhile
+		FRHITexture* SceneColorTexture = nullptr;
+		FUnorderedAccessViewRHIRef SceneColorUAV;
+	};
+}	// namespace GSTile